@@ -173,7 +173,7 @@ public:
         mJson["defaults"]["date"]["year"] = year;
     }
 
-    void save(void);
+    Result save(void);
 
 private:
     Configuration(void);
@@ -183,8 +183,6 @@ private:
     void operator=(Configuration const&) = delete;
 
     nlohmann::json mJson;
-
-    size_t oldSize = 0;
 };
 
 #endif
\ No newline at end of file
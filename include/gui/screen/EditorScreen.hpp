@@ -56,6 +56,7 @@ private:
     bool selectNature();
     bool selectAbility();
     bool selectItem();
+    bool toggleShiny();
     bool togglePokerus();
     void setOT();
     void setNick();
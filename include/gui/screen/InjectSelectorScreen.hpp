@@ -41,6 +41,7 @@ public:
     void draw(void) const override;
     ScreenType type() const override { return ScreenType::EVENTS; }
 private:
+    void scanQR(void);
     Hid hid;
     std::vector<MysteryGift::giftData> wondercards;
 };
@@ -30,6 +30,7 @@
 #include "Screen.hpp"
 #include "MainMenuButton.hpp"
 #include <array>
+#include <string>
 
 class MainMenu : public Screen
 {
@@ -41,6 +42,8 @@ public:
     ScreenType type() const override { return ScreenType::MAINMENU; }
 private:
     std::array<MainMenuButton*, 6> buttons = {NULL};
+    // what changed since the last backup, empty when there's nothing to compare against
+    std::string changes;
 };
 
 #endif
\ No newline at end of file
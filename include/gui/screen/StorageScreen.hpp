@@ -29,6 +29,7 @@
 
 #include "Screen.hpp"
 #include "Sav.hpp"
+#include "Bank.hpp"
 #include "PKX.hpp"
 #include "ViewerScreen.hpp"
 #include "Button.hpp"
@@ -61,7 +62,7 @@ private:
     bool showViewer();
     bool clearBox();
     bool releasePkm();
-    bool dumpPkm() { return false; }
+    bool dumpPkm();
     bool backButton();
     // Have to basically reimplement Hid because two Hids don't go well together
     bool lastBox(bool forceBottom = false);
@@ -69,14 +70,25 @@ private:
     bool clickBottomIndex(int index);
     void setBoxName(bool storage);
     void pickup();
+    // Moves the cursor to the next bank slot holding the species of the Pokémon under it, or held
+    bool findInBank();
+    // Writes the save's boxes to /3ds/PKSM/exports as CSV
+    bool exportBoxes();
+    // The Pokémon in the given slot of the current bank box, the save's empty one if there's none
+    std::shared_ptr<PKX> storagePkm(int slot) const;
+    // Reads the save box draw() shows again, whenever boxBox changes or one of its slots is written
+    void refreshBox();
 
     bool storageChosen = false;
     std::array<Button*, 9> mainButtons;
     std::array<Button*, 31> clickButtons;
     int cursorIndex = 0, storageBox = 0, boxBox = 0;
+    BoxSummary boxSummary;
+    // nullptr for empty slots
+    std::array<std::unique_ptr<PKX>, 30> boxPkm;
     std::unique_ptr<ViewerScreen> viewer;
     std::shared_ptr<PKX> moveMon = nullptr;
-    // Storage implementation
+    std::unique_ptr<Bank> bank;
 };
 
 #endif
\ No newline at end of file
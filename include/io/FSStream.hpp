@@ -29,31 +29,56 @@
 
 #include <3ds.h>
 #include <string>
+#include <vector>
 
 #define BUFFER_SIZE 0x10000
 
 class FSStream
 {
 public:
+    enum FlushPolicy
+    {
+        // unbuffered, every write is flushed to the card before it returns
+        FLUSH_EACH_WRITE,
+        // writes are coalesced in memory and flushed when the stream is closed
+        FLUSH_ON_CLOSE,
+        // writes are coalesced in memory, nothing is flushed until flush() is called
+        FLUSH_ON_DEMAND
+    };
+
     FSStream(FS_Archive archive, const std::u16string& path, u32 flags);
     FSStream(FS_Archive archive, const std::u16string& path, u32 flags, u32 size);
-    ~FSStream(void) { };
+    // writes still buffered because close() was never called are drained here
+    ~FSStream(void);
 
+    // Switches between unbuffered and coalesced writes. Call it before the first write.
+    void   buffer(FlushPolicy policy, u32 capacity = BUFFER_SIZE);
     Result close(void);
     bool   eof(void);
+    Result flush(void);
     bool   good(void);
     u32    offset(void);
     u32    read(void *buf, u32 size);
+    Result resize(u32 size);
     Result result(void);
+    void   seek(u32 offset);
     u32    size(void);
     u32    write(const void *buf, u32 size);
     
 private:
+    Result drain(void);
+
     Handle mHandle;
     u32    mSize;
     u32    mOffset;
     Result mResult;
     bool   mGood;
+
+    FlushPolicy     mPolicy;
+    std::vector<u8> mBuffer;
+    u32             mCapacity;
+    // file offset of mBuffer[0]
+    u32             mBufferOffset;
 };
 
 #endif
\ No newline at end of file
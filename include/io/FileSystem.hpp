@@ -0,0 +1,192 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef FILESYSTEM_HPP
+#define FILESYSTEM_HPP
+
+#include <3ds.h>
+#include <map>
+#include <string>
+#include "thread.hpp"
+
+namespace io
+{
+    // Everything FSStream, Directory and Archive need from the platform. The 3DS backend forwards
+    // to FSUSER/FSFILE/FSDIR, the POSIX one maps archives onto directories of the host filesystem
+    // so I/O heavy code can run and be measured off the console.
+    class FileSystem
+    {
+    public:
+        virtual ~FileSystem(void) { }
+
+        virtual Result openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path) = 0;
+        virtual Result closeArchive(FS_Archive archive) = 0;
+
+        virtual Result openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags) = 0;
+        virtual Result createFile(FS_Archive archive, const std::u16string& path, u64 size) = 0;
+        virtual Result deleteFile(FS_Archive archive, const std::u16string& path) = 0;
+        virtual Result renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to) = 0;
+        virtual Result createDirectory(FS_Archive archive, const std::u16string& path) = 0;
+
+        virtual Result read(Handle handle, u32* read, u64 offset, void* buf, u32 size) = 0;
+        virtual Result write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags) = 0;
+        virtual Result size(Handle handle, u64* size) = 0;
+        virtual Result setSize(Handle handle, u64 size) = 0;
+        virtual Result flush(Handle handle) = 0;
+        virtual Result close(Handle handle) = 0;
+
+        virtual Result openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path) = 0;
+        virtual Result readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries) = 0;
+        virtual Result closeDirectory(Handle handle) = 0;
+    };
+
+#ifdef _3DS
+    class CtrFileSystem : public FileSystem
+    {
+    public:
+        Result openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path) override;
+        Result closeArchive(FS_Archive archive) override;
+        Result openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags) override;
+        Result createFile(FS_Archive archive, const std::u16string& path, u64 size) override;
+        Result deleteFile(FS_Archive archive, const std::u16string& path) override;
+        Result renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to) override;
+        Result createDirectory(FS_Archive archive, const std::u16string& path) override;
+        Result read(Handle handle, u32* read, u64 offset, void* buf, u32 size) override;
+        Result write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags) override;
+        Result size(Handle handle, u64* size) override;
+        Result setSize(Handle handle, u64 size) override;
+        Result flush(Handle handle) override;
+        Result close(Handle handle) override;
+        Result openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path) override;
+        Result readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries) override;
+        Result closeDirectory(Handle handle) override;
+    };
+#else
+    // The SD card archive is root itself, every other archive gets its own folder below it
+    class PosixFileSystem : public FileSystem
+    {
+    public:
+        PosixFileSystem(const std::string& root);
+
+        Result openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path) override;
+        Result closeArchive(FS_Archive archive) override;
+        Result openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags) override;
+        Result createFile(FS_Archive archive, const std::u16string& path, u64 size) override;
+        Result deleteFile(FS_Archive archive, const std::u16string& path) override;
+        Result renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to) override;
+        Result createDirectory(FS_Archive archive, const std::u16string& path) override;
+        Result read(Handle handle, u32* read, u64 offset, void* buf, u32 size) override;
+        Result write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags) override;
+        Result size(Handle handle, u64* size) override;
+        Result setSize(Handle handle, u64 size) override;
+        Result flush(Handle handle) override;
+        Result close(Handle handle) override;
+        Result openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path) override;
+        Result readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries) override;
+        Result closeDirectory(Handle handle) override;
+
+    private:
+        std::string hostPath(FS_Archive archive, const std::u16string& path);
+
+        std::string mRoot;
+        std::map<FS_Archive, std::string> mArchives;
+        std::map<Handle, void*> mDirectories;
+        FS_Archive mNextArchive;
+        Handle mNextDirectory;
+        Threads::Mutex mMutex;
+    };
+#endif
+
+    // Forwards to another backend and tallies what it was asked to do, grouped by the
+    // innermost CallSite alive on the calling thread.
+    class InstrumentedFileSystem : public FileSystem
+    {
+    public:
+        struct Counters
+        {
+            u32 opens = 0;
+            u32 reads = 0;
+            u32 writes = 0;
+            u32 others = 0;
+            u64 bytesRead = 0;
+            u64 bytesWritten = 0;
+            // microseconds spent inside the backend
+            u64 openTime = 0;
+            u64 readTime = 0;
+            u64 writeTime = 0;
+            u64 otherTime = 0;
+        };
+
+        InstrumentedFileSystem(FileSystem& backend) : mBackend(backend) { }
+
+        std::map<std::string, Counters> stats(void);
+        void reset(void);
+
+        Result openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path) override;
+        Result closeArchive(FS_Archive archive) override;
+        Result openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags) override;
+        Result createFile(FS_Archive archive, const std::u16string& path, u64 size) override;
+        Result deleteFile(FS_Archive archive, const std::u16string& path) override;
+        Result renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to) override;
+        Result createDirectory(FS_Archive archive, const std::u16string& path) override;
+        Result read(Handle handle, u32* read, u64 offset, void* buf, u32 size) override;
+        Result write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags) override;
+        Result size(Handle handle, u64* size) override;
+        Result setSize(Handle handle, u64 size) override;
+        Result flush(Handle handle) override;
+        Result close(Handle handle) override;
+        Result openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path) override;
+        Result readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries) override;
+        Result closeDirectory(Handle handle) override;
+
+    private:
+        enum Kind { OPEN, READ, WRITE, OTHER };
+        void record(Kind kind, u64 start, u64 bytes);
+
+        FileSystem& mBackend;
+        std::map<std::string, Counters> mStats;
+        Threads::Mutex mMutex;
+    };
+
+    // Names the I/O issued while it is alive, e.g. io::CallSite site("TitleLoader::scan");
+    class CallSite
+    {
+    public:
+        CallSite(const char* name);
+        ~CallSite(void);
+        static const char* current(void);
+
+    private:
+        const char* mPrevious;
+    };
+
+    // Backend used by FSStream, Directory and Archive. Defaults to the native one; passing
+    // nullptr restores it. The caller keeps ownership of the backend.
+    FileSystem& fs(void);
+    void fs(FileSystem* backend);
+}
+
+#endif
\ No newline at end of file
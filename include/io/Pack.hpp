@@ -0,0 +1,109 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef PACK_HPP
+#define PACK_HPP
+
+#include <3ds.h>
+#include <string>
+#include <vector>
+#include "FSStream.hpp"
+
+// Single-file, append-only container used for save backups and pkx dumps.
+// Layout on disk: header | entry... | index | footer
+// Each entry is compressed on its own and carries a small header, the trailing
+// index lists where every entry lives so one can be extracted without reading
+// the others. A pack whose index was never written (e.g. the console lost power
+// mid-backup) is re-indexed by walking the entry headers.
+namespace Pack
+{
+    enum Method : u8
+    {
+        STORED = 0,
+        LZ     = 1
+    };
+
+    struct Entry
+    {
+        std::string name;
+        u32 offset; // of the entry header
+        u32 rawSize;
+        u32 storedSize;
+        u32 checksum;
+        u8  method;
+    };
+
+    class Writer
+    {
+    public:
+        // Opens path for appending, creating it if it doesn't exist
+        Writer(FS_Archive archive, const std::u16string& path);
+        ~Writer(void);
+
+        bool   good(void) const { return mGood; }
+        Result result(void) const { return mResult; }
+        const std::vector<Entry>& entries(void) const { return mEntries; }
+
+        // Compresses and writes data immediately; nothing is kept in memory afterwards
+        bool   add(const std::string& name, const u8* data, u32 size);
+        // Writes the index and footer
+        Result close(void);
+
+    private:
+        FSStream mStream;
+        std::vector<Entry> mEntries;
+        u32    mEnd;
+        Result mResult;
+        bool   mGood;
+        bool   mDirty;
+        bool   mClosed;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(FS_Archive archive, const std::u16string& path);
+        ~Reader(void);
+
+        bool   good(void) const { return mGood; }
+        size_t count(void) const { return mEntries.size(); }
+        const Entry& entry(size_t index) const { return mEntries[index]; }
+        // Index of the entry with the given name, or -1
+        int    find(const std::string& name) const;
+
+        // out must hold at least entry(index).rawSize bytes
+        bool   extract(size_t index, u8* out);
+        Result close(void);
+
+    private:
+        FSStream mStream;
+        std::vector<Entry> mEntries;
+        bool   mGood;
+        bool   mClosed;
+    };
+}
+
+#endif
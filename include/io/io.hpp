@@ -35,6 +35,16 @@
 namespace io
 {
     bool exists(const std::string& name);
+    // Writes data to path.tmp, then swaps it in for path, so a crash never leaves a half written file behind.
+    // The rename can't overwrite, so a crash right after path is deleted leaves only path.tmp; readers of
+    // path call recoverFile() first. Extdata can't rename files, so this is only for the SD card; use
+    // writeFile there.
+    Result replaceFile(FS_Archive archive, const std::u16string& path, const void* data, u32 size);
+    // Finishes or drops a replaceFile() a crash interrupted: a lone path.tmp takes path's place, one next to
+    // path is deleted
+    Result recoverFile(FS_Archive archive, const std::u16string& path);
+    // Overwrites path in place, recreating it first if its size changes since extdata files can't be resized
+    Result writeFile(FS_Archive archive, const std::u16string& path, const void* data, u32 size);
 }
 
 #endif
\ No newline at end of file
@@ -100,6 +100,14 @@ struct AllocNode
     struct AllocNode *NextFree;
 };
 
+/* a block of the arena heap. allocations are bumped from Top towards End */
+struct ArenaBlock
+{
+    struct ArenaBlock *Prev;
+    char *Top;
+    char *End;
+};
+
 /* whether we're running or skipping code */
 enum RunMode
 {
@@ -260,6 +268,11 @@ struct Table
     short Size;
     short OnHeap;
     struct TableEntry **HashTable;
+    short Grown;                    /* HashTable was allocated when growing and must be freed */
+    unsigned short Resizes;         /* how many times the table has grown */
+    int Entries;                    /* number of entries in all the chains */
+    unsigned long Lookups;          /* searches made, to see how long the chains get */
+    unsigned long Probes;           /* entries compared during those searches */
 };
 
 /* stack frame for function calls */
@@ -273,7 +286,57 @@ struct StackFrame
     struct Table LocalTable;                /* the local variables and parameters */
     struct TableEntry *LocalHashTable[LOCAL_TABLE_SIZE];
     struct StackFrame *PreviousStackFrame;  /* the next lower stack frame */
+    unsigned int Serial;                    /* unique per call, frames can reuse the same address */
+};
+
+#ifndef NO_BINDING_CACHE
+/* a remembered VariableGet() result. valid while the same frame is on top and nothing named Ident was defined,
+ * deleted or brought back into scope since */
+struct BindingCacheEntry
+{
+    const char *Ident;
+    unsigned int FrameSerial;
+    struct Value *Val;
+};
+#endif
+
+#ifndef NO_EXPRESSION_CACHE
+/* what a step of a compiled expression does */
+enum CompiledStepKind
+{
+    StepConstant,               /* push Int */
+    StepVariable,               /* push the variable or constant macro named Ident */
+    StepPrefix,                 /* apply the prefix operator Op to the top value */
+    StepPostfix,                /* apply the postfix operator Op to the top value */
+    StepInfix                   /* apply the infix operator Op to the top two values */
+};
+
+/* one step of a compiled expression, in the order the expression stack would have run them */
+struct CompiledStep
+{
+    unsigned char Kind;
+    unsigned char Op;
+    short int Line;             /* where its token was, for errors */
+    short int CharacterPos;
+    union
+    {
+        long Int;
+        const char *Ident;
+    } Arg;
+};
+
+/* an integer-only expression lowered to postfix steps the first time it ran. keyed on the position of its first
+ * token, so it's only good while those tokens are */
+struct CompiledExpression
+{
+    const unsigned char *Pos;       /* first token, NULL if the slot is free */
+    const unsigned char *EndPos;    /* the token after the expression */
+    short int EndLine;
+    short int EndCharacterPos;
+    int NumSteps;                   /* 0 if it can't be compiled, so it isn't tried again */
+    struct CompiledStep Step[EXPRESSION_CACHE_STEPS];
 };
+#endif
 
 /* lexer state */
 enum LexMode
@@ -383,6 +446,22 @@ struct Picoc_Struct
     
     /* the stack */
     struct StackFrame *TopStackFrame;
+    unsigned int FrameSerial;
+
+#ifndef NO_BINDING_CACHE
+    /* identifier lookups, so loops don't walk the hash tables on every access */
+    struct BindingCacheEntry BindingCache[BINDING_CACHE_SIZE];
+    unsigned long BindingCacheHits;
+    unsigned long BindingCacheMisses;
+#endif
+
+#ifndef NO_EXPRESSION_CACHE
+    /* compiled integer expressions, so loops skip the token decoding and expression stack */
+    struct CompiledExpression ExpressionCache[EXPRESSION_CACHE_SIZE];
+    int ExpressionCacheOff;             /* set to interpret everything, e.g. to compare the two */
+    unsigned long ExpressionCacheHits;
+    unsigned long ExpressionCacheMisses;
+#endif
 
     /* the value passed to exit() */
     int PicocExitValue;
@@ -414,6 +493,17 @@ struct Picoc_Struct
     struct AllocNode *FreeListBucket[FREELIST_BUCKETS];      /* we keep a pool of freelist buckets to reduce fragmentation */
     struct AllocNode *FreeListBig;                           /* free memory which doesn't fit in a bucket */
 
+#ifdef USE_MALLOC_HEAP
+    /* arena heap, used instead of malloc() for each value when ArenaSize is set */
+    int ArenaSize;                      /* size of each block the arena takes from malloc() */
+    struct ArenaBlock *Arena;           /* the block being allocated from */
+    void *ArenaLast;                    /* the latest allocation, which can still be given back */
+    int ArenaLastSize;
+    long ArenaInUse;                    /* bytes handed out */
+    long ArenaHighWater;                /* the most bytes handed out at once */
+    int ArenaBlocks;                    /* blocks taken from malloc() */
+#endif
+
     /* types */    
     struct ValueType UberType;
     struct ValueType IntType;
@@ -477,6 +567,8 @@ int TableSet(Picoc *pc, struct Table *Tbl, char *Key, struct Value *Val, const c
 int TableGet(struct Table *Tbl, const char *Key, struct Value **Val, const char **DeclFileName, int *DeclLine, int *DeclColumn);
 struct Value *TableDelete(Picoc *pc, struct Table *Tbl, const char *Key);
 char *TableSetIdentifier(Picoc *pc, struct Table *Tbl, const char *Ident, int IdentLen);
+void TableFreeBuckets(Picoc *pc, struct Table *Tbl);
+void TableStats(Picoc *pc, const char *Name, struct Table *Tbl);
 void TableStrFree(Picoc *pc);
 
 /* lex.c */
@@ -509,6 +601,7 @@ long ExpressionParseInt(struct ParseState *Parser);
 void ExpressionAssign(struct ParseState *Parser, struct Value *DestValue, struct Value *SourceValue, int Force, const char *FuncName, int ParamNo, int AllowPointerCoercion);
 long ExpressionCoerceInteger(struct Value *Val);
 unsigned long ExpressionCoerceUnsignedInteger(struct Value *Val);
+void ExpressionCacheClear(Picoc *pc);
 #ifndef NO_FP
 double ExpressionCoerceFP(struct Value *Val);
 #endif
@@ -528,7 +621,7 @@ struct ValueType *TypeCreateOpaqueStruct(Picoc *pc, struct ParseState *Parser, c
 int TypeIsForwardDeclared(struct ParseState *Parser, struct ValueType *Typ);
 
 /* heap.c */
-void HeapInit(Picoc *pc, int StackSize);
+void HeapInit(Picoc *pc, int StackSize, int ArenaSize);
 void HeapCleanup(Picoc *pc);
 void *HeapAllocStack(Picoc *pc, int Size);
 int HeapPopStack(Picoc *pc, void *Addr, int Size);
@@ -556,6 +649,7 @@ int VariableDefined(Picoc *pc, const char *Ident);
 int VariableDefinedAndOutOfScope(Picoc *pc, const char *Ident);
 void VariableRealloc(struct ParseState *Parser, struct Value *FromValue, int NewSize);
 void VariableGet(Picoc *pc, struct ParseState *Parser, const char *Ident, struct Value **LVal);
+void VariableBindingEvict(Picoc *pc, const char *Ident);
 void VariableDefinePlatformVar(Picoc *pc, struct ParseState *Parser, char *Ident, struct ValueType *Typ, union AnyValue *FromValue, int IsWritable);
 void VariableStackFrameAdd(struct ParseState *Parser, const char *FuncName, int NumParams);
 void VariableStackFramePop(struct ParseState *Parser);
@@ -600,6 +694,7 @@ void PlatformVPrintf(IOFILE *Stream, const char *Format, va_list Args);
 void PlatformExit(Picoc *pc, int ExitVal);
 char *PlatformMakeTempName(Picoc *pc, char *TempNameBuffer);
 void PlatformLibraryInit(Picoc *pc);
+void PksmLibraryInit(Picoc *pc);
 
 /* include.c */
 void IncludeInit(Picoc *pc);
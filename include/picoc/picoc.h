@@ -40,6 +40,7 @@ void PicocParseInteractive(Picoc *pc);
 /* platform.c */
 void PicocCallMain(Picoc *pc, int argc, char **argv);
 void PicocInitialise(Picoc *pc, int StackSize);
+void PicocInitialiseArena(Picoc *pc, int StackSize, int ArenaSize);
 void PicocCleanup(Picoc *pc);
 void PicocPlatformScanFile(Picoc *pc, const char *FileName);
 
@@ -27,6 +27,11 @@
 #define LINEBUFFER_MAX 256                  /* maximum number of characters on a line */
 #define LOCAL_TABLE_SIZE 11                 /* size of local variable table (can expand) */
 #define STRUCT_TABLE_SIZE 11                /* size of struct/union member table (can expand) */
+#define TABLE_MAX_LOAD 1                    /* heap tables grow once they average this many entries per bucket */
+#define TABLE_MAX_SIZE 16383                /* heap tables stop growing at this many buckets */
+#define BINDING_CACHE_SIZE 64               /* identifier lookups remembered per interpreter, a power of two. define NO_BINDING_CACHE to disable */
+#define EXPRESSION_CACHE_SIZE 128           /* compiled expressions remembered per interpreter, a power of two. define NO_EXPRESSION_CACHE to disable */
+#define EXPRESSION_CACHE_STEPS 24           /* longest expression that gets compiled, in values and operators */
 
 #define INTERACTIVE_PROMPT_START "starting picoc " PICOC_VERSION "\n"
 #define INTERACTIVE_PROMPT_STATEMENT "picoc> "
@@ -0,0 +1,64 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef BOXSUMMARY_HPP
+#define BOXSUMMARY_HPP
+
+#include "PKX.hpp"
+
+// Level, stats, shiny and hidden power type of a whole box at once, read straight from the
+// decrypted records instead of through PKX, where every stat looks up the form and level again.
+// The records are first read into one array per field along with the personal data of each
+// slot, then each value is worked out over every slot in a loop of its own.
+struct BoxSummary
+{
+    static constexpr int SLOTS = 30;
+
+    // count records of one generation from 4 to 7, stride bytes apart. Species 0 marks an
+    // empty slot, whatever else is computed for it is meaningless.
+    void compute(const u8* data, u32 stride, u8 generation, int count = SLOTS);
+
+    int  count = 0;
+    u16  species[SLOTS];
+    u16  formSpecies[SLOTS];
+    u8   level[SLOTS];
+    // HP, Atk, Def, Spe, SpA, SpD like PKX::stat
+    u16  stats[6][SLOTS];
+    u8   hpType[SLOTS];
+    bool shiny[SLOTS];
+
+private:
+    u32 experience[SLOTS];
+    u8  expType[SLOTS];
+    u8  nature[SLOTS];
+    u8  ivs[6][SLOTS];
+    u8  evs[6][SLOTS];
+    u8  base[6][SLOTS];
+    // gen 7 hyper training, one bit per stat in PKX::stat order
+    u8  hyperTrained[SLOTS];
+};
+
+#endif
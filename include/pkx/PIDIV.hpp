@@ -0,0 +1,122 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef PIDIV_HPP
+#define PIDIV_HPP
+
+#include <3ds.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "PKX.hpp"
+#include "thread.hpp"
+
+// PID/IV spreads of the gen 3/4 "method 1" generator: from a seed, four calls of the LCG behind
+// PKX::seedStep give the low and high PID halves, then HP/Atk/Def and Spe/SpA/SpD IVs.
+// Every spread the games can produce comes from one of the 2^32 seeds, so constrained
+// generation is a search over the whole seed space.
+namespace PIDIV
+{
+    constexpr u32 MULT = 0x41C64E6D;
+    constexpr u32 ADD  = 0x6073;
+
+    // The seed steps calls later, or earlier, in O(log steps)
+    u32 advance(u32 seed, u32 steps);
+    u32 reverse(u32 seed, u32 steps);
+
+    struct Spread
+    {
+        // what the first call is made on
+        u32 seed;
+        u32 PID;
+        // in PKX::iv order: HP, Atk, Def, Spe, SpA, SpD
+        u8  ivs[6];
+    };
+
+    Spread method1(u32 seed);
+    // Writes the PID and IVs, the checksum is left for the caller to refresh
+    void apply(PKX& pk, const Spread& spread);
+
+    // Every field left at ANY matches everything
+    struct Constraints
+    {
+        static constexpr int ANY = -1;
+
+        int nature  = ANY;
+        // 0 male, 1 female, checked against genderRatio as the personal tables store it
+        int gender  = ANY;
+        u8  genderRatio = 127;
+        // the PID bit picking the first or second ability
+        int ability = ANY;
+        // whether the spread is shiny for TID/SID
+        int shiny   = ANY;
+        u16 TID     = 0;
+        u16 SID     = 0;
+        int hpType  = ANY;
+        u8  minIVs[6] = { 0, 0, 0, 0, 0, 0 };
+    };
+
+    bool matches(const Constraints& constraints, const Spread& spread);
+
+    // Sweeps the seed space on the job pool, in PARTS ranges queued at low priority. Matches are
+    // collected as they're found and can be taken while the search runs; it stops by itself once
+    // limit matches are in.
+    class Search
+    {
+    public:
+        static constexpr u32 PARTS = 64;
+
+        Search(const Constraints& constraints, size_t limit = 1000);
+        // Cancels and waits, the jobs refer to the search
+        ~Search(void);
+        Search(const Search&) = delete;
+        Search& operator=(const Search&) = delete;
+
+        void start(void);
+        void cancel(void);
+        void wait(void);
+        bool done(void);
+        // Ranges swept so far, out of PARTS
+        u32  progress(void) const { return mProgress; }
+        // Moves the matches found since the last call to the end of out, returns how many
+        size_t take(std::vector<Spread>& out);
+
+    private:
+        void sweep(Threads::Job& job, u32 first, u32 count);
+
+        Constraints mConstraints;
+        std::vector<std::shared_ptr<Threads::Job>> mJobs;
+        std::vector<Spread> mFound;
+        Threads::Mutex mMutex;
+        size_t mLimit;
+        size_t mTotal;
+        // polled by the sweeps and the UI without taking mMutex
+        std::atomic<u32> mProgress;
+        std::atomic<bool> mStopped;
+    };
+}
+
+#endif
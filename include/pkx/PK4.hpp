@@ -31,7 +31,9 @@
 #include "PK5.hpp"
 #include "time.h"
 
-class PK4 : public PKX
+class PK5;
+
+class PK4 final : public PKX
 {
 friend class SavHGSS;
 friend class SavPT;
@@ -98,12 +100,12 @@ public:
     bool ribbon(u8 ribcat, u8 ribnum) const override;
     void ribbon(u8 ribcat, u8 ribnum, u8 v) override;
 
-    u16 move(u8 move) const override;
-    void move(u8 move, u16 v) override;
-    u8 PP(u8 move) const override;
-    void PP(u8 move, u8 v) override;
-    u8 PPUp(u8 move) const override;
-    void PPUp(u8 move, u8 v) override;
+    u16 move(u8 m) const override { return *(u16*)(data + 0x28 + m*2); }
+    void move(u8 m, u16 v) override { *(u16*)(data + 0x28 + m*2) = v; }
+    u8 PP(u8 m) const override { return data[0x30 + m]; }
+    void PP(u8 m, u8 v) override { data[0x30 + m] = v; }
+    u8 PPUp(u8 m) const override { return data[0x34 + m]; }
+    void PPUp(u8 m, u8 v) override { data[0x34 + m] = v; }
     u8 iv(u8 iv) const override;
     void iv(u8 iv, u8 v) override;
     bool egg(void) const override;
@@ -177,6 +179,8 @@ public:
     u16 stat(const u8 stat) const override;
     
     std::unique_ptr<PKX> next(void);
+    // Converts into out without allocating; the checksum is left for the caller to refresh
+    void next(PK5& out);
 };
 
 #endif
\ No newline at end of file
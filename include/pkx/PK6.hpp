@@ -31,8 +31,11 @@
 #include "PK7.hpp"
 #include "PK5.hpp"
 
-class PK6 : public PKX
+class PK7;
+
+class PK6 final : public PKX
 {
+friend class PK5;
 friend class SavORAS;
 friend class SavXY;
 protected:
@@ -110,12 +113,12 @@ public:
     
     std::string nickname(void) const override;
     void nickname(const char* v) override;
-    u16 move(u8 move) const override;
-    void move(u8 move, u16 v) override;
-    u8 PP(u8 move) const override;
-    void PP(u8 move, u8 v) override;
-    u8 PPUp(u8 move) const override;
-    void PPUp(u8 move, u8 v) override;
+    u16 move(u8 m) const override { return *(u16*)(data + 0x5A + m*2); }
+    void move(u8 m, u16 v) override { *(u16*)(data + 0x5A + m*2) = v; }
+    u8 PP(u8 m) const override { return data[0x62 + m]; }
+    void PP(u8 m, u8 v) override { data[0x62 + m] = v; }
+    u8 PPUp(u8 m) const override { return data[0x66 + m]; }
+    void PPUp(u8 m, u8 v) override { data[0x66 + m] = v; }
     u16 relearnMove(u8 move) const;
     void relearnMove(u8 move, u16 v);
     bool secretSuperTrainingUnlocked(void) const;
@@ -224,6 +227,8 @@ public:
     u16 stat(const u8 stat) const override;
     
     std::unique_ptr<PKX> next(void);
+    // Converts into out without allocating; the checksum is left for the caller to refresh
+    void next(PK7& out);
     std::unique_ptr<PKX> previous(void);
 };
 
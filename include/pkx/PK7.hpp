@@ -30,8 +30,9 @@
 #include "PKX.hpp"
 #include "PK6.hpp"
 
-class PK7 : public PKX
+class PK7 final : public PKX
 {
+friend class PK6;
 friend class SavUSUM;
 friend class SavSUMO;
 protected:
@@ -106,12 +107,12 @@ public:
     
     std::string nickname(void) const override;
     void nickname(const char* v) override;
-    u16 move(u8 move) const override;
-    void move(u8 move, u16 v) override;
-    u8 PP(u8 move) const override;
-    void PP(u8 move, u8 v) override;
-    u8 PPUp(u8 move) const override;
-    void PPUp(u8 move, u8 v) override;
+    u16 move(u8 m) const override { return *(u16*)(data + 0x5A + m*2); }
+    void move(u8 m, u16 v) override { *(u16*)(data + 0x5A + m*2) = v; }
+    u8 PP(u8 m) const override { return data[0x62 + m]; }
+    void PP(u8 m, u8 v) override { data[0x62 + m] = v; }
+    u8 PPUp(u8 m) const override { return data[0x66 + m]; }
+    void PPUp(u8 m, u8 v) override { data[0x66 + m] = v; }
     u16 relearnMove(u8 move) const;
     void relearnMove(u8 move, u16 v);
     u8 iv(u8 iv) const override;
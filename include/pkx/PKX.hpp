@@ -41,10 +41,10 @@ typedef uint32_t u32;
 class PKX
 {
 friend class HexEditScreen;
+friend class Transfer;
 protected:
-    u32 expTable(u8 row, u8 col) const;
+    static u32 expTable(u8 row, u8 col);
     u32 seedStep(u32 seed);
-    void reorderMoves(void);
 
     virtual void crypt(void) = 0;
     virtual void shuffleArray(void) = 0;
@@ -52,6 +52,10 @@ protected:
 
     u8 length = 0;
 public:
+    // The record as stored, for copying a Pokémon out whole
+    const u8* rawData(void) const { return const_cast<PKX*>(this)->rawData(); }
+    u8 rawLength(void) const { return length; }
+
     virtual void decrypt(void) = 0;
     virtual void encrypt(void) = 0;
     virtual std::unique_ptr<PKX> clone(void) = 0;
@@ -64,6 +68,8 @@ public:
     bool gen4(void) const;
     bool gen3(void) const;
     void fixMoves(void);
+    // Level reached with experience on growth rate expType, found by binary search
+    static u8 levelFor(u8 expType, u32 experience);
 
     // BLOCK A
     virtual u32 encryptionConstant(void) const = 0;
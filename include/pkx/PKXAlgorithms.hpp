@@ -0,0 +1,82 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef PKXALGORITHMS_HPP
+#define PKXALGORITHMS_HPP
+
+#include "PKX.hpp"
+
+// PKX algorithms written against the concrete record type. PK4 to PK7 are final, so every
+// field access below is a direct call the compiler can inline, which matters in loops over
+// whole boxes. The PKX members with the same names dispatch here on the generation and are
+// what the GUI keeps using.
+namespace PKXAlgorithms
+{
+    // Moves the known moves to the front in order, with their PP and PP ups
+    template <typename T>
+    void reorderMoves(T& pk)
+    {
+        u8 to = 0;
+        for (u8 from = 0; from < 4; from++)
+        {
+            u16 move = pk.move(from);
+            if (move != 0)
+            {
+                if (from != to)
+                {
+                    pk.move(to, move);
+                    pk.PP(to, pk.PP(from));
+                    pk.PPUp(to, pk.PPUp(from));
+                    pk.move(from, 0);
+                }
+                to++;
+            }
+        }
+    }
+
+    // Makes sure there's a first move and clears the PP of empty slots
+    template <typename T>
+    void fixMoves(T& pk)
+    {
+        reorderMoves(pk);
+
+        if (pk.move(0) == 0)
+        {
+            pk.move(0, 1);
+        }
+
+        for (u8 i = 0; i < 4; i++)
+        {
+            if (pk.move(i) == 0)
+            {
+                pk.PP(i, 0);
+                pk.PPUp(i, 0);
+            }
+        }
+    }
+}
+
+#endif
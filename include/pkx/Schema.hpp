@@ -0,0 +1,105 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef SCHEMA_HPP
+#define SCHEMA_HPP
+
+#include <string>
+#include <vector>
+#include "PKX.hpp"
+
+// Where every stored field of the PK4 to PK7 formats lives, as tables fixed at compile time
+// (offset, width, bit range, encoding), and exporters that walk them. The tables describe the
+// bytes as stored: where a PKX accessor combines several fields (gen 4 met location and ball)
+// each one is listed separately. Records are read decrypted, stride bytes apart, and a record
+// with species 0 is an empty slot the exporters skip.
+namespace Schema
+{
+    enum class Encoding : u8
+    {
+        UINT,
+        // gen 4 character table
+        TEXT4,
+        // UTF-16, ended by 0xFFFF
+        TEXT5,
+        // UTF-16, ended by 0
+        TEXT6
+    };
+
+    struct Field
+    {
+        const char* name;
+        u8 offset;
+        // bytes for numbers (1, 2 or 4), characters for text
+        u8 width;
+        // bit range inside the number, bits 0 for all of it
+        u8 shift;
+        u8 bits;
+        Encoding encoding;
+    };
+
+    struct Layout
+    {
+        const Field* fields;
+        size_t count;
+        u8 length;
+    };
+
+    // The format of a generation, an empty layout for any other
+    const Layout& layout(u8 generation);
+    const Field* find(const Layout& layout, const std::string& name);
+
+    inline u32 get(const u8* record, const Field& field)
+    {
+        u32 v = field.width == 1 ? record[field.offset] : field.width == 2 ? *(u16*)(record + field.offset) : *(u32*)(record + field.offset);
+        return field.bits ? (v >> field.shift) & ((1u << field.bits) - 1) : v;
+    }
+    void set(u8* record, const Field& field, u32 v);
+    std::string text(const u8* record, const Field& field);
+
+    // The exporters number the slots of the records from first, so a whole save can be exported
+    // a box at a time into the same output.
+
+    // Appends a JSON object per record with its slot and every field, separated by commas from
+    // whatever object out already ends with; the caller puts the list in brackets
+    void json(std::string& out, const u8* data, u32 stride, u8 generation, int count, u32 first = 0);
+    // Appends a CSV line per record starting with its slot, after the header line if asked for
+    void csv(std::string& out, const u8* data, u32 stride, u8 generation, int count, u32 first = 0, bool header = false);
+
+    // One column per field of the layout, a row per non-empty record; every call has to be for
+    // the same generation
+    struct Columns
+    {
+        std::vector<u32> slots;
+        // numbers[field][row], left empty for text fields
+        std::vector<std::vector<u32>> numbers;
+        // text[field][row], left empty for numeric fields
+        std::vector<std::vector<std::string>> text;
+    };
+    void columns(Columns& out, const u8* data, u32 stride, u8 generation, int count, u32 first = 0);
+}
+
+#endif
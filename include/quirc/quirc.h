@@ -52,6 +52,29 @@ int quirc_resize(struct quirc *q, int w, int h);
 uint8_t *quirc_begin(struct quirc *q, int *w, int *h);
 void quirc_end(struct quirc *q);
 
+/* Pixel kernels. quirc_end() thresholds the image with them and
+ * quirc_rgb565_to_luma() converts camera images. QUIRC_KERNEL_AUTO
+ * picks the fastest one the CPU supports, which is also what is used
+ * until a kernel is selected. All of them give the same output.
+ */
+typedef enum {
+	QUIRC_KERNEL_AUTO = 0,
+	QUIRC_KERNEL_SCALAR,
+	QUIRC_KERNEL_SWAR,
+	QUIRC_KERNEL_SSE2
+} quirc_kernel_t;
+
+/* Select the kernels for every recognizer in the process. Returns the
+ * kernel in use, which is unchanged if the one asked for isn't
+ * supported.
+ */
+quirc_kernel_t quirc_select_kernel(quirc_kernel_t kernel);
+
+/* Convert count RGB565 pixels to 8-bit luma, suitable for the buffer
+ * returned by quirc_begin().
+ */
+void quirc_rgb565_to_luma(uint8_t *dst, const uint16_t *src, int count);
+
 /* This structure describes a location in the input image buffer. */
 struct quirc_point {
 	int	x;
@@ -147,6 +170,15 @@ struct quirc_data {
 
 	/* ECI assignment number */
 	uint32_t		eci;
+
+	/* Structured append. A message split over several codes gives
+	 * each code its position (from 0) and the number of codes, along
+	 * with a parity byte shared by all of them. sa_size is 0 for a
+	 * code which stands alone.
+	 */
+	int			sa_index;
+	int			sa_size;
+	int			sa_parity;
 };
 
 /* Return the number of QR-codes identified in the last processed
@@ -158,8 +190,56 @@ int quirc_count(const struct quirc *q);
 void quirc_extract(const struct quirc *q, int index,
 		   struct quirc_code *code);
 
+/* Where a code sits in the image: its size and perspective transform.
+ * After a good decode, a caller following a code that holds still can
+ * save its geometry and hand it to quirc_end_with_geometry() instead of
+ * quirc_end() for the next frame. That thresholds the image and sets up
+ * a single grid in the same place, skipping the search for capstones,
+ * so the code can be extracted and decoded straight away.
+ */
+struct quirc_geometry {
+	int			grid_size;
+	double			c[8];
+};
+
+/* Returns -1 if there is no code with that index. */
+int quirc_save_geometry(const struct quirc *q, int index,
+			struct quirc_geometry *geo);
+void quirc_end_with_geometry(struct quirc *q,
+			     const struct quirc_geometry *geo);
+
 /* Decode a QR-code, returning the payload data. */
 quirc_decode_error_t quirc_decode(const struct quirc_code *code,
 				  struct quirc_data *data);
 
+/* What the decoder did, for quirc_decode_with_stats(). The counters are
+ * added to rather than reset, so one structure can cover a whole scan.
+ * Stage times are only measured if clock is set, and are in its units.
+ */
+struct quirc_decode_stats {
+	uint64_t		(*clock)(void);
+
+	/* Codes passed in, and how many of them decoded */
+	int			codes;
+	int			decoded;
+
+	/* Reed-Solomon blocks checked: clean ones skip correction */
+	int			blocks;
+	int			blocks_clean;
+	int			blocks_corrected;
+	int			blocks_failed;
+	int			bytes_corrected;
+
+	/* Format, codeword reading, error correction, payload parsing */
+	uint64_t		time_format;
+	uint64_t		time_read;
+	uint64_t		time_ecc;
+	uint64_t		time_payload;
+};
+
+/* Like quirc_decode(), also adding to stats if it isn't NULL. */
+quirc_decode_error_t quirc_decode_with_stats(const struct quirc_code *code,
+					     struct quirc_data *data,
+					     struct quirc_decode_stats *stats);
+
 #endif
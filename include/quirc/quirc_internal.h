@@ -43,6 +43,27 @@ struct quirc_region {
 	struct quirc_point	seed;
 	int			count;
 	int			capstone;
+
+	/* First span of the region, see struct quirc_run */
+	int			run;
+};
+
+/* A horizontal run of black pixels. Runs which touch are joined into
+ * regions with union-find; afterwards parent is the region's first run
+ * and next links all runs of a region in scan order.
+ */
+struct quirc_run {
+	int			y;
+	int			left;
+	int			right;
+
+	int			parent;
+	int			next;
+
+	/* Only valid on a region's first run */
+	int			count;
+	int			last;
+	int			region;
 };
 
 struct quirc_capstone {
@@ -83,6 +104,11 @@ struct quirc {
 	int			num_regions;
 	struct quirc_region	regions[QUIRC_MAX_REGIONS];
 
+	struct quirc_run	*runs;
+	int			num_runs;
+	int			runs_size;
+	int			*row_runs;
+
 	int			num_capstones;
 	struct quirc_capstone	capstones[QUIRC_MAX_CAPSTONES];
 
@@ -94,6 +120,23 @@ struct quirc {
  * QR-code version information database
  */
 
+struct quirc_kernels {
+	quirc_kernel_t	kernel;
+	void		(*rgb565_to_luma)(uint8_t *dst, const uint16_t *src,
+					  int count);
+	/* Set each pixel of a row black if (pixel + 1) * den is no more
+	 * than its row average * num, white otherwise.
+	 */
+	void		(*threshold_row)(quirc_pixel_t *row,
+					 const int *row_average, int w,
+					 int num, int den);
+};
+
+extern const struct quirc_kernels *quirc_kernels;
+
+/* Select the fastest kernels unless quirc_select_kernel() was called */
+void quirc_kernels_init(void);
+
 #define QUIRC_MAX_VERSION     40
 #define QUIRC_MAX_ALIGNMENT   7
 
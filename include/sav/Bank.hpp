@@ -0,0 +1,152 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef BANK_HPP
+#define BANK_HPP
+
+#include <3ds.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BankIndex.hpp"
+#include "FSStream.hpp"
+#include "PKX.hpp"
+#include "thread.hpp"
+
+// PKSM's own storage, independent of any save.
+// Layout on disk: header | box...
+// Every box is a fixed size page: a box header holding the name and the generation of each
+// slot, followed by 30 slots wide enough for the largest format, stored decrypted. Opening a
+// bank only reads its header, a box is read in one piece the first time it's touched. Pages
+// past the end of the file read as empty, so growing the bank doesn't touch the card at all.
+//
+// Edits never go to the bank file directly. Each one is appended to a journal next to it and
+// the journal is flushed every few edits. A checkpoint copies the changed pages into the bank
+// file on a worker and records the last edit it covers in the bank header. There are two
+// journals (path + ".journal0" and ".journal1"): a checkpoint moves new edits to the empty one,
+// and the one it covers is emptied when it completes. Opening a bank replays whatever the last
+// checkpoint missed, so an interrupted write loses at most the edits since the last flush.
+class Bank
+{
+public:
+    static constexpr u32 SLOTS     = 30;
+    static constexpr u32 SLOT_SIZE = 232;
+    static constexpr u32 NAME_SIZE = 0x40;
+
+    Bank(FS_Archive archive, const std::u16string& path, int boxes);
+    ~Bank(void);
+
+    bool   good(void) const { return mGood; }
+    Result result(void) const { return mResult; }
+    int    boxes(void) const { return mBoxes; }
+
+    // nullptr if the slot is empty
+    std::unique_ptr<PKX> pkm(int box, int slot);
+    // An empty Pokémon clears the slot
+    void   pkm(const PKX& pk, int box, int slot);
+    void   clear(int box, int slot);
+    u8     generation(int box, int slot);
+    // The slot as stored, SLOT_SIZE bytes. Only valid until another box is read
+    const u8* slotData(int box, int slot);
+    std::string boxName(int box);
+    void   boxName(int box, const std::string& name);
+
+    // Built by reading every box the first time it's asked for, then kept up to date on each write
+    const BankIndex& index(void);
+    // Slots (box * SLOTS + slot) matching the query, ascending. Only the candidates of an OT
+    // query are read, to rule out hash collisions.
+    std::vector<u32> find(const BankIndex::Query& query);
+
+    // Whether some edits aren't checkpointed into the bank file yet
+    bool   dirty(void) const;
+    // Flushes the journal, after this every edit so far survives a crash
+    Result commit(void);
+    // Starts writing the changed pages back in the background, unless a checkpoint is running
+    void   checkpoint(void);
+    // commit() followed by checkpoint()
+    Result save(void);
+    // Commits and waits for a running checkpoint, whatever is left is replayed on the next open
+    Result close(void);
+
+private:
+    struct Page
+    {
+        std::unique_ptr<u8[]> data;
+        bool dirty;
+    };
+
+    // What a checkpoint writes, copied so edits can go on while it runs
+    struct Snapshot
+    {
+        std::vector<std::pair<int, std::unique_ptr<u8[]>>> pages;
+        u32 sequence;
+        u32 boxes;
+        // stays failed if the job never ran
+        Result result = -1;
+    };
+
+    u8*    page(int box);
+    void   evict(void);
+    // Sequence number of the first edit in the journal, 0 if it's empty or unreadable
+    u32    firstSequence(int journal);
+    void   replay(int journal);
+    void   append(int box, u8 slot, u8 generation, const u8* payload);
+    // Picks up the outcome of the last checkpoint; false while it's still running
+    bool   finishCheckpoint(bool wait);
+    // Empties the journals whose edits are all checkpointed
+    void   trim(void);
+    // Runs on a worker
+    Result write(const Snapshot& snapshot);
+
+    FSStream mStream;
+    FSStream mJournal[2];
+    std::unordered_map<int, Page> mPages;
+    std::shared_ptr<Threads::Job> mCheckpoint;
+    std::shared_ptr<Snapshot> mSnapshot;
+    std::unique_ptr<BankIndex> mIndex;
+    // serializes mStream between the caller's page reads and the checkpoint's writes
+    Threads::Mutex mMutex;
+    int    mBoxes;
+    Result mResult;
+    bool   mGood;
+    bool   mHeaderDirty;
+    bool   mClosed;
+    // a failed checkpoint leaves the journal as the only complete copy, no later one may claim to cover it
+    bool   mFailed;
+    // the journal edits are appended to
+    int    mActive;
+    u32    mJournalEnd[2];
+    // sequence number of the last edit in each journal
+    u32    mJournalLast[2];
+    // edits appended since the last commit()
+    u32    mPending;
+    // sequence number of the last journaled edit, and of the last one in the bank file
+    u32    mSequence;
+    u32    mCheckpointed;
+};
+
+#endif
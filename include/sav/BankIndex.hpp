@@ -0,0 +1,112 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef BANKINDEX_HPP
+#define BANKINDEX_HPP
+
+#include <3ds.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PKX.hpp"
+
+// Secondary indices over a bank's slots, kept up to date by Bank on every write so filtering
+// doesn't have to read and parse every slot. A slot is addressed by box * Bank::SLOTS + slot.
+// Species and abilities get sorted posting lists, boolean and small valued fields get bitmaps,
+// OT name and TID share a hash.
+class BankIndex
+{
+public:
+    // Every field left at ANY matches everything
+    struct Query
+    {
+        static constexpr int ANY = -1;
+
+        int species    = ANY;
+        int ability    = ANY;
+        int ball       = ANY;
+        int gender     = ANY;
+        int generation = ANY;
+        int shiny      = ANY;
+        int egg        = ANY;
+        // both have to be set to filter by original trainer
+        std::string otName;
+        int TID        = ANY;
+    };
+
+    BankIndex(void) { }
+
+    // pk is nullptr for an empty slot
+    void update(u32 slot, PKX* pk);
+    // Matching slots, ascending
+    std::vector<u32> find(const Query& query) const;
+    size_t size(void) const { return mEntries.size(); }
+
+private:
+    class Bitmap
+    {
+    public:
+        void set(u32 bit, bool v);
+        bool test(u32 bit) const { return bit / 32 < mWords.size() && (mWords[bit / 32] >> (bit % 32)) & 1; }
+        const std::vector<u32>& words(void) const { return mWords; }
+
+    private:
+        std::vector<u32> mWords;
+    };
+
+    // What the slot was indexed as, so a write can take it out of the old lists
+    struct Entry
+    {
+        u32 trainer;
+        u16 species;
+        u16 ability;
+        u8  ball;
+        u8  gender;
+        u8  generation;
+        u8  flags;
+    };
+
+    typedef std::unordered_map<u32, std::vector<u32>> Postings;
+
+    static void insert(std::vector<u32>& list, u32 slot);
+    static void erase(std::vector<u32>& list, u32 slot);
+    static u32  trainer(const std::string& otName, u16 TID);
+    void        index(u32 slot, const Entry& entry, bool v);
+    const Bitmap* bitmap(const std::unordered_map<int, Bitmap>& bitmaps, int value) const;
+
+    std::vector<Entry> mEntries;
+    Postings mSpecies;
+    Postings mAbilities;
+    Postings mTrainers;
+    Bitmap   mOccupied;
+    Bitmap   mShiny;
+    Bitmap   mEgg;
+    std::unordered_map<int, Bitmap> mBalls;
+    std::unordered_map<int, Bitmap> mGenders;
+    std::unordered_map<int, Bitmap> mGenerations;
+};
+
+#endif
@@ -0,0 +1,58 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef BOXCHECKSUM_HPP
+#define BOXCHECKSUM_HPP
+
+#include <3ds.h>
+#include <vector>
+
+// Checksum verification for whole boxes, straight from the stored bytes. The checksum sums the
+// decrypted u16 words after the header, and shuffling the blocks doesn't change a sum, so an
+// encrypted record only needs the XOR stream taken off, not the block order. A box is scanned a
+// word position at a time across all its slots, so the LCG steps of different slots don't wait
+// on each other and the inner loop is one the compiler can vectorise.
+namespace BoxChecksum
+{
+    static constexpr int MAX_SLOTS = 30;
+
+    struct Report
+    {
+        u32 scanned = 0;
+        // records that are all zeroes, which the games use for empty encrypted slots
+        u32 empty = 0;
+        // slots whose stored checksum doesn't match, numbered from the first one scanned
+        std::vector<u32> corrupt;
+        u32 repaired = 0;
+    };
+
+    // Scans count (up to MAX_SLOTS) records of a generation from 4 to 7, stride bytes apart,
+    // encrypted as saves store them or not. With repair, a corrupt record gets the checksum of
+    // its contents, and gen 4/5 ones are encrypted again with it since it's their key.
+    void scan(Report& report, u8* data, u32 stride, u8 generation, int count, bool encrypted, bool repair, u32 first = 0);
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef PATCHPLAN_HPP
+#define PATCHPLAN_HPP
+
+#include <vector>
+#include "Sav.hpp"
+
+// A PKSMSCRIPT compiled against one save: records are bounds checked, gen 4 offsets are
+// relocated to the active partitions, repeats become a single replicated write and
+// writes that touch or overlap the previous one are folded into it.
+class PatchPlan
+{
+public:
+    enum Status
+    {
+        OK,
+        BAD_MAGIC,
+        TRUNCATED,
+        OUT_OF_BOUNDS
+    };
+
+    PatchPlan(const u8* script, size_t size, const Sav& save);
+
+    Status status(void) const { return mStatus; }
+    size_t writes(void) const { return mWrites.size(); }
+    // indices into save.blocks() whose checksum the plan invalidates
+    const std::vector<size_t>& dirtyBlocks(void) const { return mDirty; }
+    void apply(Sav& save) const;
+
+private:
+    struct Write
+    {
+        u32 offset;
+        u32 length;
+        // pattern repeated over length bytes, stored at mPool[payload]
+        u32 payload;
+        u32 pattern;
+    };
+
+    void push(u32 offset, const u8* payload, u32 length, u32 repeat);
+    void markDirty(const Sav& save);
+
+    std::vector<Write> mWrites;
+    std::vector<u8> mPool;
+    std::vector<size_t> mDirty;
+    Status mStatus;
+};
+
+#endif
\ No newline at end of file
@@ -28,7 +28,11 @@
 #define SAV_HPP
 
 #include <memory>
+#include <string>
+#include <vector>
 #include <stdint.h>
+#include "BoxChecksum.hpp"
+#include "BoxSummary.hpp"
 #include "PKX.hpp"
 #include "WCX.hpp"
 #include "utils.hpp"
@@ -36,6 +40,16 @@
 
 namespace TitleLoader {
     void backupSave();
+    bool restoreBackup(const std::string& savePath);
+}
+
+class Sav;
+
+namespace Scripting {
+    struct Timing;
+    int run(Sav& save, const std::string& file, const std::vector<std::string>& args);
+    int process(const std::string& saveFile, const std::string& file, const std::vector<std::string>& args);
+    Timing benchmark(Sav& save, const std::string& file, const std::vector<std::string>& args);
 }
 
 typedef uint8_t u8;
@@ -44,8 +58,14 @@ typedef uint32_t u32;
 
 class Sav
 {
-friend class ScriptScreen;
+friend class PatchPlan;
+friend class SaveDiff;
+friend class PksmLibrary;
 friend void TitleLoader::backupSave();
+friend bool TitleLoader::restoreBackup(const std::string& savePath);
+friend int Scripting::run(Sav& save, const std::string& file, const std::vector<std::string>& args);
+friend Scripting::Timing Scripting::benchmark(Sav& save, const std::string& file, const std::vector<std::string>& args);
+friend int Scripting::process(const std::string& saveFile, const std::string& file, const std::vector<std::string>& args);
 protected:
     static const u16 crc16[256];
     
@@ -55,11 +75,28 @@ protected:
     static bool validSequence(u8* dt, u8* pattern, int shift = 0);
 
 public:
+    // A range of the save covered by one checksum, and where that checksum is stored
+    struct Block
+    {
+        u32 offset;
+        u32 length;
+        u32 checksum;
+    };
+
     u8 boxes = 0;
     u32 length = 0;
 
     virtual ~Sav();
-    virtual void resign(void) = 0;
+    // Recomputes every checksum in blocks()
+    void resign(void);
+    // Recomputes the checksums of these indices into blocks(), then of any block holding one of them
+    void resign(const std::vector<size_t>& dirty);
+    // Recomputes exactly these checksums in order, and whatever the format derives from them
+    virtual void resignBlocks(const std::vector<size_t>& dirty) = 0;
+    virtual std::vector<Block> blocks(void) const = 0;
+    // Gen 4 keeps two copies of its general and storage partitions; these locate the active ones
+    virtual u32 generalOffset(void) const { return 0; }
+    virtual u32 storageOffset(void) const { return 0; }
 
     static bool isValidDSSave(u8* dt);
     static std::unique_ptr<Sav> getSave(u8* dt, size_t length);
@@ -100,7 +137,8 @@ public:
     
     virtual std::unique_ptr<PKX> pkm(u8 slot) const = 0;
     virtual std::unique_ptr<PKX> pkm(u8 box, u8 slot, bool ekx = false) const = 0;
-    virtual void pkm(PKX& pk, u8 box, u8 slot) = 0;
+    // false if pk can't be converted to this save's generation, in which case the slot is left alone
+    virtual bool pkm(PKX& pk, u8 box, u8 slot) = 0;
     virtual std::shared_ptr<PKX> emptyPkm() const = 0;
     
     virtual void dex(PKX& pk) = 0;
@@ -112,6 +150,13 @@ public:
     virtual void boxName(u8 box, std::string name) = 0;
     virtual u8 partyCount(void) const = 0;
 
+    // Checks every box slot as stored, so not between cryptBoxData(true) and cryptBoxData(false)
+    BoxChecksum::Report verifyBoxes(bool repair);
+    // Only between cryptBoxData(true) and cryptBoxData(false), it reads the decrypted records
+    BoxSummary boxSummary(u8 box) const;
+    // Every box slot as a CSV line of its schema fields, after a header; decrypted boxes only too
+    std::string boxesCsv(void) const;
+
     virtual int maxBoxes(void) const = 0;
     virtual size_t maxWondercards(void) const = 0;
     virtual u8 generation(void) const = 0;
@@ -101,7 +101,8 @@ public:
     SavB2W2(u8* dt);
     virtual ~SavB2W2() { };
 
-    void resign(void) override;
+    void resignBlocks(const std::vector<size_t>& dirty) override;
+    std::vector<Block> blocks(void) const override;
 
     u16 TID(void) const override;
     void TID(u16 v) override;
@@ -143,7 +144,7 @@ public:
     // NOTICE: this sets a pkx into the savefile, not a pkx
     // that's because PKSM works with decrypted boxes and
     // crypts them back during resigning
-    void pkm(PKX& pk, u8 box, u8 slot) override;
+    bool pkm(PKX& pk, u8 box, u8 slot) override;
 
     std::shared_ptr<PKX> emptyPkm() const override;
 
@@ -38,7 +38,6 @@ extern "C" {
 
 class SavHGSS : public Sav
 {
-friend class ScriptScreen;
 protected:
     int gbo = -1;
     int sbo = -1;
@@ -55,7 +54,10 @@ public:
     SavHGSS(u8* dt);
     virtual ~SavHGSS() { };
 
-    void resign(void) override;
+    void resignBlocks(const std::vector<size_t>& dirty) override;
+    std::vector<Block> blocks(void) const override;
+    u32 generalOffset(void) const override { return gbo; }
+    u32 storageOffset(void) const override { return sbo; }
 
     u16 TID(void) const override;
     void TID(u16 v) override;
@@ -97,7 +99,7 @@ public:
     // NOTICE: this sets a pkx into the savefile, not a pkx
     // that's because PKSM works with decrypted boxes and
     // crypts them back during resigning
-    void pkm(PKX& pk, u8 box, u8 slot) override;
+    bool pkm(PKX& pk, u8 box, u8 slot) override;
 
     std::shared_ptr<PKX> emptyPkm() const override;
 
@@ -102,7 +102,8 @@ public:
     virtual ~SavSUMO() { };
 
     u16 check16(u8* buf, u32 blockID, u32 len) const;
-    void resign(void) override;
+    void resignBlocks(const std::vector<size_t>& dirty) override;
+    std::vector<Block> blocks(void) const override;
 
     u16 TID(void) const override;
     void TID(u16 v) override;
@@ -144,7 +145,7 @@ public:
     // NOTICE: this sets a pkx into the savefile, not a pkx
     // that's because PKSM works with decrypted boxes and
     // crypts them back during resigning
-    void pkm(PKX& pk, u8 box, u8 slot) override;
+    bool pkm(PKX& pk, u8 box, u8 slot) override;
 
     std::shared_ptr<PKX> emptyPkm() const override;
 
@@ -0,0 +1,105 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef SAVEDIFF_HPP
+#define SAVEDIFF_HPP
+
+#include <vector>
+#include "Sav.hpp"
+
+// What changed between two saves of the same game, e.g. the loaded one and its last backup. The
+// saves' checksum blocks are paired by index rather than offset, since gen 4 keeps its active
+// partitions in either half, and compared 64 bytes at a time. The changed strides then decide
+// which box and party slots need comparing; trainer fields are compared through the accessors.
+class SaveDiff
+{
+public:
+    enum Status
+    {
+        OK,
+        MISMATCH
+    };
+
+    enum Kind : u8
+    {
+        BLOCK,
+        BOX,
+        PARTY,
+        TRAINER
+    };
+
+    enum Field : u8
+    {
+        TID,
+        SID,
+        OT_NAME,
+        GENDER,
+        VERSION,
+        LANGUAGE,
+        COUNTRY,
+        SUBREGION,
+        CONSOLE_REGION,
+        MONEY,
+        BP,
+        PLAYED_TIME,
+        CURRENT_BOX
+    };
+
+    struct Change
+    {
+        Kind kind;
+        // block index, box * 30 + slot, party slot or Field
+        u16 index;
+        // the changed bytes in the first save; whole slots for BOX and PARTY, nothing for TRAINER
+        u32 offset;
+        u32 length;
+    };
+
+    // With trustChecksums, blocks whose stored checksums match are taken as unchanged without
+    // reading them. That only holds while both saves are as they were read, i.e. signed.
+    SaveDiff(const Sav& current, const Sav& previous, bool trustChecksums);
+
+    Status status(void) const { return mStatus; }
+    // blocks first, in block order, then box slots, party slots and trainer fields
+    const std::vector<Change>& changes(void) const { return mChanges; }
+
+private:
+    void compareBlocks(const Sav& current, const Sav& previous, const std::vector<Sav::Block>& other, bool trustChecksums);
+    bool touched(u32 offset, u32 length) const;
+    void compareSlots(const Sav& current, const Sav& previous);
+    void compareTrainer(const Sav& current, const Sav& previous);
+
+    std::vector<Sav::Block> mBlocks;
+    // indices into mBlocks sorted by offset, to find the block a slot lives in
+    std::vector<size_t> mOrder;
+    // per block, where its changed-stride flags start in mStrides, or NONE if it didn't change
+    std::vector<u32> mFirstStride;
+    std::vector<u8> mStrides;
+    std::vector<Change> mChanges;
+    Status mStatus;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef TRANSFER_HPP
+#define TRANSFER_HPP
+
+#include <3ds.h>
+#include <vector>
+#include "Bank.hpp"
+#include "PK4.hpp"
+#include "PK5.hpp"
+#include "PK6.hpp"
+#include "PK7.hpp"
+
+// Moves Pokémon between generations. Upgrades go through the next() chain into output objects
+// owned by the Transfer, so converting a whole range allocates nothing per Pokémon; downgrades
+// still go through previous(). A result is only valid until the next conversion.
+class Transfer
+{
+public:
+    enum Status : u8
+    {
+        OK,
+        EMPTY,
+        UNSUPPORTED,
+        SPECIES
+    };
+
+    explicit Transfer(u8 generation) : mGeneration(generation) { }
+
+    u8 generation(void) const { return mGeneration; }
+
+    // pk itself if it's already in the target generation, nullptr if it can't be converted.
+    // Without refresh the checksum of a converted Pokémon is left stale.
+    PKX* convert(PKX& pk, Status& status, bool refresh = true);
+    // Converts the slots [first, last) of the bank in place, a slot being box * Bank::SLOTS + slot.
+    // Checksums are refreshed in one pass over the staged results before anything is written.
+    std::vector<Status> convert(Bank& bank, u32 first, u32 last);
+
+private:
+    static u8* raw(PKX& pk) { return pk.rawData(); }
+    PKX* load(const u8* data, u8 generation);
+    PKX* target(u8 generation);
+
+    PK4 mPK4;
+    PK5 mPK5;
+    PK6 mPK6;
+    PK7 mPK7;
+    u8 mGeneration;
+    std::vector<u8> mStaging;
+};
+
+#endif
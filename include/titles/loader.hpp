@@ -45,6 +45,7 @@
 #include "SavSUMO.hpp"
 #include "SavUSUM.hpp"
 #include "SavXY.hpp"
+#include "SaveDiff.hpp"
 
 namespace TitleLoader
 {
@@ -52,12 +53,20 @@ namespace TitleLoader
     void load(std::shared_ptr<Title> title);
     void load(std::string path);
     void backupSave(void);
+    // Newest backup taken of the loaded save file, nullptr if there is none
+    std::unique_ptr<Sav> latestBackup(void);
+    // Loads the save at savePath, then overwrites it with the newest backup of that same file and
+    // loads that instead. The save it replaces is backed up first.
+    bool restoreBackup(const std::string& savePath);
     void exit(void);
     
     extern std::vector<std::shared_ptr<Title>> nandTitles;
     extern std::shared_ptr<Title> cardTitle;
     extern std::unordered_map<std::string, std::vector<std::string>> sdSaves;
     extern std::shared_ptr<Sav> save;
+    // How the loaded save differs from the newest backup of its file taken before it was loaded, nullptr if
+    // there was none
+    extern std::shared_ptr<SaveDiff> sinceBackup;
 }
 
 #endif
\ No newline at end of file
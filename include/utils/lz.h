@@ -0,0 +1,54 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Byte-oriented LZ77 codec (LZ4-like sequences: token, literals, 16 bit offset, match).
+// Tuned for speed rather than ratio: save files are mostly zeroes and repeated
+// structures, so a single hash probe per position is enough.
+
+// Worst case output size for an input of len bytes
+size_t lz_compress_bound(size_t len);
+// Returns the compressed size, or 0 if dst_capacity < lz_compress_bound(src_length) or allocation failed
+size_t lz_compress(const uint8_t *src, size_t src_length, uint8_t *dst, size_t dst_capacity);
+// Returns the decompressed size, or 0 if the input is malformed or does not fit in dst
+size_t lz_decompress(const uint8_t *src, size_t src_length, uint8_t *dst, size_t dst_capacity);
+// Adler-32 of the given data, used to validate decompressed entries
+uint32_t lz_checksum(const uint8_t *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,218 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef QR_HPP
+#define QR_HPP
+
+#include <3ds.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WCX.hpp"
+#include "thread.hpp"
+
+struct quirc;
+struct quirc_code;
+struct quirc_data;
+struct quirc_decode_stats;
+struct quirc_geometry;
+
+// Wondercard import from QR codes. Frames come from a FrameSource, quirc finds
+// and decodes the codes in them, and a Reader joins the codes of a message split
+// with structured append. The message is a base64 gift, optionally behind a URL.
+// A Scanner runs a Reader off the calling thread for live camera input.
+namespace QR
+{
+    // A grayscale image, one byte per pixel, rows packed without padding
+    struct Frame
+    {
+        const u8* pixels;
+        int width;
+        int height;
+    };
+
+    class FrameSource
+    {
+    public:
+        virtual ~FrameSource(void) { }
+        // Points frame at the next image, which stays valid until the next call.
+        // Returns false once there are no more frames.
+        virtual bool next(Frame& frame) = 0;
+    };
+
+#ifdef _3DS
+    // The outer camera, at the size of the top screen
+    class CameraSource : public FrameSource
+    {
+    public:
+        static constexpr int WIDTH  = 400;
+        static constexpr int HEIGHT = 240;
+
+        CameraSource(void);
+        ~CameraSource(void);
+        CameraSource(const CameraSource&) = delete;
+        CameraSource& operator=(const CameraSource&) = delete;
+
+        bool good(void) const { return mGood; }
+        bool next(Frame& frame) override;
+
+    private:
+        std::vector<u16> mRaw;
+        std::vector<u8> mGray;
+        u32  mTransferUnit;
+        bool mGood;
+    };
+#endif
+
+    // Binary PGM (P5) images read one after the other, so the pipeline can be
+    // driven from files
+    class ImageSource : public FrameSource
+    {
+    public:
+        ImageSource(const std::vector<std::string>& files) : mFiles(files), mIndex(0) { }
+        bool next(Frame& frame) override;
+
+    private:
+        std::vector<std::string> mFiles;
+        size_t mIndex;
+        std::vector<u8> mPixels;
+    };
+
+    // A code only counts once it has been read the same way from votes frames, so
+    // a misread glimpse can't end a scan. After a frame with a single code, the
+    // next frame is first read from where that code was, skipping the search.
+    class Reader
+    {
+    public:
+        Reader(int votes = 1);
+        ~Reader(void);
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // Decodes every code in frame. Returns true once a whole message has been read
+        bool feed(const Frame& frame);
+        bool complete(void) const { return mTotal > 0 && mFound == mTotal; }
+        // Codes of the current message seen so far, and how many it has
+        int found(void) const { return mFound; }
+        int total(void) const { return mTotal; }
+        // The parts of the message joined in order
+        std::vector<u8> message(void) const;
+        // Forgets the message, the votes and where the last code was
+        void reset(void);
+        // What the decoder has done since the reader was made, timed in system ticks (microseconds off the 3DS)
+        const quirc_decode_stats& stats(void) const { return *mStats; }
+        // Frames fed, and how many of them were read without searching for codes
+        int frames(void) const { return mFrames; }
+        int trackedFrames(void) const { return mTrackedFrames; }
+
+    private:
+        struct Candidate
+        {
+            std::vector<u8> data;
+            int index;
+            int total;
+            int parity;
+            int votes;
+            int lastFrame;
+        };
+
+        int decodeAll(void);
+        void vote(void);
+        void add(const u8* data, int length, int index, int total, int parity);
+        void restart(void);
+
+        struct quirc* mQuirc;
+        std::unique_ptr<quirc_code> mCode;
+        std::unique_ptr<quirc_data> mData;
+        std::unique_ptr<quirc_decode_stats> mStats;
+        std::unique_ptr<quirc_geometry> mGeometry;
+        bool mTracking;
+        std::vector<Candidate> mCandidates;
+        std::vector<std::vector<u8>> mParts;
+        std::vector<bool> mHave;
+        int mVotes;
+        int mFrames;
+        int mTrackedFrames;
+        int mFound;
+        int mTotal;
+        int mParity;
+    };
+
+    // Feeds a Reader on the job pool. Only the newest frame waits: one offered
+    // while another is still waiting replaces it, so a reader slower than the
+    // camera drops stale frames instead of falling behind. Progress is published
+    // after every frame, so the getters never wait for a decode.
+    class Scanner
+    {
+    public:
+        Scanner(int votes);
+        // Drops any waiting frame and waits for the one being read
+        ~Scanner(void);
+        Scanner(const Scanner&) = delete;
+        Scanner& operator=(const Scanner&) = delete;
+
+        // Copies frame in. Returns false if it replaced a frame that was never read
+        bool offer(const Frame& frame);
+        // Blocks until every frame offered so far has been read or dropped
+        void wait(void);
+        bool complete(void);
+        int found(void);
+        int total(void);
+        std::vector<u8> message(void);
+        // Starts over before the next frame is read
+        void reset(void);
+        int dropped(void);
+
+    private:
+        void work(Threads::Job& job);
+
+        Threads::Mutex mLock;
+        Reader mReader;
+        std::shared_ptr<Threads::Job> mJob;
+        std::vector<u8> mPending;
+        std::vector<u8> mWorking;
+        int mPendingWidth;
+        int mPendingHeight;
+        bool mHavePending;
+        bool mRunning;
+        bool mResetting;
+        bool mComplete;
+        int mFound;
+        int mTotal;
+        int mDropped;
+        std::vector<u8> mMessage;
+    };
+
+    // The bytes a message carries: the base64 after the last '#', or the whole message
+    // when there is no URL. Empty if it isn't valid base64
+    std::vector<u8> payload(const std::vector<u8>& message);
+    // The gift in data for a game of generation, nullptr if its size doesn't match one
+    std::unique_ptr<WCX> wondercard(const std::vector<u8>& data, u8 generation);
+    // Reads frames until one holds a wondercard for generation, or the source runs dry
+    std::unique_ptr<WCX> scan(FrameSource& source, u8 generation, int votes = 1);
+}
+
+#endif
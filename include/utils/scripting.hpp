@@ -0,0 +1,64 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef SCRIPTING_HPP
+#define SCRIPTING_HPP
+
+#include <string>
+#include <vector>
+#include "Sav.hpp"
+
+namespace Scripting
+{
+    // Runs a picoc script against save, with its boxes decrypted for the run and encrypted again
+    // afterwards. Scripts get the pksm.h library (see library_pksm.cpp).
+    // Returns main's return value, or the code passed to exit(); parse and runtime errors return 1.
+    // Anything but 0 counts as a failure and the save is put back the way it was before the run.
+    int run(Sav& save, const std::string& file, const std::vector<std::string>& args = {});
+    struct Timing
+    {
+        int interpretedRet;
+        u64 interpreted;    // microseconds
+        int compiledRet;
+        u64 compiled;       // microseconds
+    };
+    // Runs the script twice, first interpreting every expression, then with picoc's compiled integer
+    // expressions, and times both runs. The save is put back the way it was after each one.
+    Timing benchmark(Sav& save, const std::string& file, const std::vector<std::string>& args = {});
+    // Headless batch entry point: loads the save file, runs the script, then repairs box slot
+    // checksums, resigns and writes the save back in place if it succeeded. A file not ending in .c is applied as a PKSMSCRIPT instead, and only the blocks it
+    // dirties are resigned. Needs nothing from the GUI.
+    int process(const std::string& saveFile, const std::string& file, const std::vector<std::string>& args);
+    // Save the running script operates on, nullptr outside of run()
+    Sav* current(void);
+    // Whether the running save's boxes are decrypted, and switching them; a no-op if they already are
+    bool boxesDecrypted(void);
+    void cryptBoxes(bool decrypt);
+    // Most heap the last run held at once, in bytes
+    long heapHighWater(void);
+}
+
+#endif
\ No newline at end of file
@@ -28,11 +28,103 @@
 #define THREAD_HPP
 
 #include <3ds.h>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <vector>
+#ifndef _3DS
+#include <pthread.h>
+#endif
 
 namespace Threads
 {
+    class Scheduler;
+
+    enum class Priority : u8
+    {
+        LOW,
+        NORMAL,
+        HIGH
+    };
+
+    class Mutex
+    {
+    public:
+        Mutex(void);
+        ~Mutex(void);
+        Mutex(const Mutex&) = delete;
+        Mutex& operator=(const Mutex&) = delete;
+
+        void lock(void);
+        void unlock(void);
+
+    private:
+#ifdef _3DS
+        LightLock mLock;
+#else
+        pthread_mutex_t mMutex;
+#endif
+    };
+
+    // Sticky event: once set, every current and future wait() returns immediately
+    class Event
+    {
+    public:
+        Event(void);
+        ~Event(void);
+        Event(const Event&) = delete;
+        Event& operator=(const Event&) = delete;
+
+        void set(void);
+        void wait(void);
+        bool isSet(void);
+
+    private:
+#ifdef _3DS
+        LightEvent mEvent;
+#else
+        pthread_mutex_t mMutex;
+        pthread_cond_t mCond;
+        bool mSet;
+#endif
+    };
+
+    // Handle to a submitted job. Cancellation is cooperative: a queued job that
+    // gets cancelled never runs, a running one has to poll cancelled() itself.
+    class Job
+    {
+    public:
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+        // Blocks until the job and its completion callback have run, or the job was dropped
+        void wait(void) { mFinished.wait(); }
+        bool done(void) { return mFinished.isSet(); }
+        void cancel(void) { mCancelled = true; }
+        bool cancelled(void) const { return mCancelled; }
+
+    private:
+        friend class Scheduler;
+        Job(std::function<void(Job&)> work, std::function<void(Job&)> callback);
+        void run(void);
+
+        std::function<void(Job&)> mWork;
+        std::function<void(Job&)> mCallback;
+        Event mFinished;
+        std::atomic<bool> mCancelled;
+    };
+
+    // Starts the worker pool; submit() starts it with the default size if needed
+    void init(size_t workers = 2);
+    // Queues work on the pool. Jobs asking for more stack than a worker has get their own thread.
+    // callback runs on the same thread right after work, also when the job was cancelled.
+    // A job no thread can take (the pool is stopping, or its thread couldn't be started) is
+    // cancelled and its callback runs right away on the caller's thread.
+    std::shared_ptr<Job> submit(std::function<void(Job&)> work, Priority priority = Priority::NORMAL, u32 stackSize = 0,
+                                std::function<void(Job&)> callback = nullptr);
+    // Fire-and-forget helper kept for existing callers
     void create(ThreadFunc entrypoint);
+    // Runs whatever is still queued, then joins every thread
     void destroy(void);
 }
 
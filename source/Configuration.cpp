@@ -27,9 +27,12 @@
 #include "Configuration.hpp"
 #include "archive.hpp"
 #include "FSStream.hpp"
+#include "FileSystem.hpp"
+#include "io.hpp"
 
 Configuration::Configuration()
 {
+    io::CallSite site("Configuration::Configuration");
     static const std::u16string path = StringUtils::UTF8toUTF16("/config.json");
     FSStream stream(Archive::data(), path, FS_OPEN_READ);
     
@@ -42,30 +45,22 @@ Configuration::Configuration()
     }
     else
     {
-        oldSize = stream.size();
-        char* jsonData = new char[oldSize + 1];
-        jsonData[oldSize] = '\0';
-        stream.read(jsonData, oldSize);
+        u32 size = stream.size();
+        char* jsonData = new char[size + 1];
+        jsonData[size] = '\0';
+        stream.read(jsonData, size);
         stream.close();
         mJson = nlohmann::json::parse(jsonData);
         delete[] jsonData;
     }
 }
 
-void Configuration::save()
+Result Configuration::save()
 {
+    io::CallSite site("Configuration::save");
     static const std::u16string path = StringUtils::UTF8toUTF16("/config.json");
 
+    // config.json lives on extdata, which can't rename, so it is rewritten in place
     std::string writeData = mJson.dump(2);
-    writeData.shrink_to_fit();
-    size_t size = writeData.size();
-
-    if (oldSize != size)
-    {
-        FSUSER_DeleteFile(Archive::data(), fsMakePath(PATH_UTF16, path.data()));
-    }
-
-    FSStream stream(Archive::data(), path, FS_OPEN_WRITE, oldSize = size);
-    stream.write(writeData.data(), size);
-    stream.close();
+    return io::writeFile(Archive::data(), path, writeData.data(), writeData.size());
 }
\ No newline at end of file
@@ -38,6 +38,7 @@ Result App::init(void)
     if (R_FAILED(res = amInit())) return res;
     if (R_FAILED(res = Gui::init())) return res;
     i18n::init();
+    Threads::init();
 
     // uncomment when needing to debug with GDB
     // consoleDebugInit(debugDevice_SVC);
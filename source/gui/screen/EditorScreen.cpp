@@ -33,6 +33,8 @@
 #include "HiddenPowerSelectionScreen.hpp"
 #include "NatureSelectionScreen.hpp"
 #include "ItemSelectionScreen.hpp"
+#include "PIDIV.hpp"
+#include "personal.hpp"
 #include <bitset>
 
 #define NO_TEXT_BUTTON(x, y, w, h, function, image) new Button(x, y, w, h, function, image, "", 0.0f, 0)
@@ -60,7 +62,7 @@ EditorScreen::EditorScreen(std::shared_ptr<ViewerScreen> viewer, std::shared_ptr
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 54, 15, 12, std::bind(&EditorScreen::selectNature, this), ui_sheet_button_info_detail_editor_dark_idx));
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 74, 15, 12, std::bind(&EditorScreen::selectAbility, this), ui_sheet_button_info_detail_editor_dark_idx));
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 94, 15, 12, std::bind(&EditorScreen::selectItem, this), ui_sheet_button_info_detail_editor_dark_idx));
-    buttons[tab].push_back(NO_TEXT_BUTTON(75, 114, 15, 12, [this](){ pkm->shiny(!pkm->shiny()); return false; }, ui_sheet_button_info_detail_editor_dark_idx));
+    buttons[tab].push_back(NO_TEXT_BUTTON(75, 114, 15, 12, std::bind(&EditorScreen::toggleShiny, this), ui_sheet_button_info_detail_editor_dark_idx));
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 134, 15, 12, std::bind(&EditorScreen::togglePokerus, this), ui_sheet_button_info_detail_editor_dark_idx));
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 154, 15, 12, [this](){ Gui::setNextKeyboardFunc(std::bind(&EditorScreen::setOT, this)); return false; }, ui_sheet_button_info_detail_editor_dark_idx));
     buttons[tab].push_back(NO_TEXT_BUTTON(75, 174, 15, 12, [this](){ Gui::setNextKeyboardFunc(std::bind(&EditorScreen::setNick, this)); return false; }, ui_sheet_button_info_detail_editor_dark_idx));
@@ -393,6 +395,42 @@ void EditorScreen::setLevel()
     }
 }
 
+bool EditorScreen::toggleShiny()
+{
+    // a gen 4 PID and IVs come from one method 1 seed, so a shiny one that keeps the nature,
+    // gender and ability is searched for instead of patching the PID
+    if (pkm->generation() == 4 && !pkm->shiny() &&
+        Gui::showChoiceMessage("Search for a shiny PID the game could generate?", std::string("The IVs will be rerolled with it.")))
+    {
+        PIDIV::Constraints constraints;
+        constraints.nature = pkm->nature();
+        constraints.ability = pkm->PID() & 1;
+        constraints.shiny = 1;
+        constraints.TID = pkm->TID();
+        constraints.SID = pkm->SID();
+        if (pkm->gender() < 2)
+        {
+            constraints.gender = pkm->gender();
+            constraints.genderRatio = PersonalDPPtHGSS::gender(pkm->species());
+        }
+
+        PIDIV::Search search(constraints, 1);
+        search.start();
+        search.wait();
+        std::vector<PIDIV::Spread> found;
+        if (search.take(found) > 0)
+        {
+            PIDIV::apply(*pkm, found[0]);
+            pkm->refreshChecksum();
+            return false;
+        }
+        Gui::warn("No shiny PID fits this Pok\u00E9mon!");
+        return false;
+    }
+    pkm->shiny(!pkm->shiny());
+    return false;
+}
+
 bool EditorScreen::togglePokerus()
 {
     if (pkm->pkrs() > 0)
@@ -27,6 +27,8 @@
 #include "InjectSelectorScreen.hpp"
 #include "InjectorScreen.hpp"
 #include "WC7.hpp"
+#include "loader.hpp"
+#include "qr.hpp"
 
 static u8 test[] = { 0xf5, 0x01, 0x41, 0x20, 0x20, 0x20, 0x70, 0x20, 0x6f, 0x20, 0x77, 0x20, 0x65, 0x20, 0x72, 0x20, 0x66, 0x20, 0x75, 0x20, 0x6c, 0x20, 0x20, 0x20, 0x47, 0x20, 0x61, 0x20, 0x72, 0x20, 0x63, 0x20, 0x68, 0x20, 0x6f, 0x20, 0x6d, 0x20, 0x70, 0x20, 0x20, 0x20, 0x66, 0x20, 0x6f, 0x20, 0x72, 0x20, 0x20, 0x20, 0x59, 0x20, 0x6f, 0x20, 0x75, 0x20, 0x21, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x85, 0x2d, 0x33, 0x01, 0x2c, 0x20, 0x01, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0xff, 0x20, 0x91, 0x2b, 0xf5, 0x01, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x10, 0x20, 0xfa, 0x20, 0xa3, 0x20, 0x51, 0x01, 0x5b, 0x20, 0xf2, 0x20, 0xbd, 0x01, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0xff, 0x20, 0x20, 0x03, 0x20, 0x20, 0x41, 0x9c, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x20, 0x57, 0x20, 0x49, 0x20, 0x4e, 0x20, 0x54, 0x20, 0x45, 0x20, 0x52, 0x20, 0x32, 0x20, 0x30, 0x20, 0x31, 0x20, 0x33, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x32, 0x20, 0x20, 0x20, 0x02, 0x28, 0x6b, 0xee, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 };
 
@@ -53,6 +55,73 @@ void InjectSelectorScreen::update(touchPosition* touch)
         Gui::setScreen(std::unique_ptr<Screen>(new InjectorScreen(std::unique_ptr<WCX>(new WC6(test, false)))));
         return;
     }
+    if (downKeys & KEY_Y)
+    {
+        scanQR();
+        return;
+    }
+}
+
+void InjectSelectorScreen::scanQR()
+{
+    QR::CameraSource camera;
+    if (!camera.good())
+    {
+        Gui::warn("Could not start the camera!");
+        return;
+    }
+
+    // Decoding runs beside the camera, and a code has to be read from a few frames to count
+    QR::Scanner scanner(3);
+    QR::Frame frame;
+    std::unique_ptr<WCX> card;
+    u8 generation = TitleLoader::save->generation();
+
+    C3D_FrameEnd(0);
+    Gui::clearTextBufs();
+    hidScanInput();
+    while (aptMainLoop() && !card && !(hidKeysDown() & KEY_B))
+    {
+        if (camera.next(frame))
+        {
+            scanner.offer(frame);
+        }
+        if (scanner.complete())
+        {
+            card = QR::wondercard(QR::payload(scanner.message()), generation);
+            if (!card)
+            {
+                scanner.reset();
+            }
+        }
+
+        hidScanInput();
+        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+        C2D_TargetClear(g_renderTargetTop, COLOR_BLACK);
+        C2D_TargetClear(g_renderTargetBottom, COLOR_BLACK);
+
+        C2D_SceneBegin(g_renderTargetTop);
+        Gui::sprite(ui_sheet_part_info_top_idx, 0, 0);
+        Gui::dynamicText(GFX_TOP, 95, "Point the camera at a wondercard QR code.", FONT_SIZE_15, FONT_SIZE_15, COLOR_WHITE);
+        int total = scanner.total();
+        if (total > 1)
+        {
+            Gui::dynamicText(GFX_TOP, 115, StringUtils::format("%d of %d codes read", scanner.found(), total), FONT_SIZE_11, FONT_SIZE_11, COLOR_WHITE);
+        }
+        Gui::dynamicText(GFX_TOP, 130, "Press B to cancel.", FONT_SIZE_11, FONT_SIZE_11, COLOR_WHITE);
+
+        C2D_SceneBegin(g_renderTargetBottom);
+        Gui::sprite(ui_sheet_part_info_bottom_idx, 0, 0);
+
+        C3D_FrameEnd(0);
+        Gui::clearTextBufs();
+    }
+    hidScanInput();
+
+    if (card)
+    {
+        Gui::setScreen(std::unique_ptr<Screen>(new InjectorScreen(std::move(card))));
+    }
 }
 
 void InjectSelectorScreen::draw() const
@@ -119,7 +188,7 @@ void InjectSelectorScreen::draw() const
 
     C2D_SceneBegin(g_renderTargetBottom);
     Gui::backgroundBottom(true);
-    Gui::dynamicText(GFX_BOTTOM, 224, "Press \uE000 to continue or \uE001 to return.", FONT_SIZE_11, FONT_SIZE_11, C2D_Color32(197, 202, 233, 255));
+    Gui::dynamicText(GFX_BOTTOM, 224, "Press \uE000 to continue, \uE003 to scan a QR code or \uE001 to return.", FONT_SIZE_11, FONT_SIZE_11, C2D_Color32(197, 202, 233, 255));
 
     Gui::sprite(ui_sheet_eventmenu_page_indicator_idx, 65, 13);
 
@@ -32,6 +32,7 @@
 #include "InjectSelectorScreen.hpp"
 #include "EditSelectorScreen.hpp"
 #include "ScriptScreen.hpp"
+#include "loader.hpp"
 
 static constexpr int icons[6] = {
     ui_sheet_icon_storage_idx,
@@ -77,8 +78,28 @@ static bool goToScreen(int buttonNum)
     return true;
 }
 
+static std::string changesText()
+{
+    if (!TitleLoader::sinceBackup || TitleLoader::sinceBackup->status() != SaveDiff::OK)
+    {
+        return "";
+    }
+    int counts[4] = {0, 0, 0, 0};
+    for (const SaveDiff::Change& change : TitleLoader::sinceBackup->changes())
+    {
+        counts[change.kind]++;
+    }
+    if (counts[SaveDiff::BLOCK] == 0)
+    {
+        return "No changes since the last backup";
+    }
+    return StringUtils::format("Since the last backup: %i blocks, %i box slots, %i party slots, %i trainer fields",
+        counts[SaveDiff::BLOCK], counts[SaveDiff::BOX], counts[SaveDiff::PARTY], counts[SaveDiff::TRAINER]);
+}
+
 MainMenu::MainMenu()
 {
+    changes = changesText();
     for (u8 i = 0; i < 3; i++)
     {
         for (u8 j = 0; j < 2; j++)
@@ -103,11 +124,15 @@ MainMenu::~MainMenu()
     }
 }
 
-static void menuTop()
+static void menuTop(const std::string& changes)
 {
     static const std::string version = StringUtils::format("v%d.%d.%d", VERSION_MAJOR, VERSION_MINOR, VERSION_MICRO);
     Gui::backgroundTop(false);
     Gui::staticText(GFX_TOP, 4, "PKSM", FONT_SIZE_14, FONT_SIZE_14, COLOR_BLUE);
+    if (!changes.empty())
+    {
+        Gui::dynamicText(GFX_TOP, 212, changes, FONT_SIZE_9, FONT_SIZE_9, COLOR_LIGHTBLUE);
+    }
     Gui::staticText(version, 398, 229, FONT_SIZE_9, FONT_SIZE_9, COLOR_LIGHTBLUE, true);
 }
 
@@ -115,7 +140,7 @@ void MainMenu::draw() const
 {
     Gui::clearTextBufs();
     C2D_SceneBegin(g_renderTargetTop);
-    menuTop();
+    menuTop(changes);
     C2D_SceneBegin(g_renderTargetBottom);
     Gui::backgroundBottom(false);
     for (MainMenuButton* button : buttons)
@@ -29,8 +29,9 @@
 #include "archive.hpp"
 #include "loader.hpp"
 #include "FSStream.hpp"
-
-static const char* MAGIC = "PKSMSCRIPT";
+#include "FileSystem.hpp"
+#include "PatchPlan.hpp"
+#include "scripting.hpp"
 
 namespace
 {
@@ -172,70 +173,37 @@ void ScriptScreen::updateEntries()
 
 void ScriptScreen::applyScript()
 {
+    io::CallSite site("ScriptScreen::applyScript");
+    const std::string& name = currFiles[hid.fullIndex()].first;
+    if (name.size() > 2 && name.substr(name.size() - 2) == ".c")
+    {
+        if (Scripting::run(*TitleLoader::save, currDirString + '/' + name) != 0)
+        {
+            Gui::warn("Script failed!");
+        }
+        return;
+    }
+
     FSStream in(Archive::sd(), StringUtils::UTF8toUTF16(currDirString + '/' + currFiles[hid.fullIndex()].first), FS_OPEN_READ);
     if (in.good())
     {
-        size_t size = in.size();
-        u8* data = new u8[size];
-        in.read(data, size);
+        std::vector<u8> data(in.size());
+        in.read(data.data(), data.size());
         in.close();
 
-        for (size_t i = 0; i < strlen(MAGIC); i++)
+        PatchPlan plan(data.data(), data.size(), *TitleLoader::save);
+        switch (plan.status())
         {
-            if (data[i] != MAGIC[i])
-            {
+            case PatchPlan::OK:
+                plan.apply(*TitleLoader::save);
+                break;
+            case PatchPlan::BAD_MAGIC:
                 Gui::warn("Not a valid script!");
-                return;
-            }
-        }
-
-        size_t index = strlen(MAGIC);
-        while (index < size)
-        {
-            u32 offset = *(u32*)(data + index);
-            u32 length = *(u32*)(data + index + 4);
-            u32 repeat = *(u32*)(data + index + 8 + length);
-
-            if (TitleLoader::save->generation() == 4)
-            {
-                u32 sbo = 0;
-                u32 gbo = 0;
-                switch (TitleLoader::save->version())
-                {
-                    case 7:
-                    case 8:
-                        sbo = ((SavHGSS*)TitleLoader::save.get())->sbo;
-                        gbo = ((SavHGSS*)TitleLoader::save.get())->gbo;
-                        break;
-                    case 10:
-                    case 11:
-                        sbo = ((SavDP*)TitleLoader::save.get())->sbo;
-                        gbo = ((SavDP*)TitleLoader::save.get())->gbo;
-                        break;
-                    case 12:
-                        sbo = ((SavPT*)TitleLoader::save.get())->sbo;
-                        gbo = ((SavPT*)TitleLoader::save.get())->gbo;
-                        break;
-                }
-                if (TitleLoader::save->boxOffset(0, 0) - sbo <= offset && TitleLoader::save->boxOffset(TitleLoader::save->boxes, 0) - sbo >= offset)
-                {
-                    offset += sbo;
-                }
-                else
-                {
-                    offset += gbo;
-                }
-            }
-
-            for (size_t i = 0; i < repeat; i++)
-            {
-                std::copy(data + index + 8, data + index + 8 + length, TitleLoader::save->data + offset + i * length);
-            }
-
-            index += 12 + length;
+                break;
+            default:
+                Gui::warn("Script does not fit this save!");
+                break;
         }
-
-        delete[] data;
     }
     else
     {
@@ -29,11 +29,13 @@
 #include "MainMenu.hpp"
 #include "PK4.hpp"
 #include "Configuration.hpp"
+#include "FileSystem.hpp"
 #include "TitleLoadScreen.hpp"
-
-// TODO: remove
-static u8 test[] = {0x0B,0xEB,0x64,0x89,0x00,0x00,0xC8,0xA5,0x12,0x00,0x00,0x00,0x2A,0x8A,0x42,0x73,0x47,0x9C,0x00,0x00,0xA0,0x91,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x21,0x00,0x62,0x00,0xEF,0x00,0x22,0x01,0x23,0x1E,0x14,0x14,0x00,0x00,0x00,0x00,0xD1,0xA1,0x33,0x3C,0x00,0x00,0x00,0x00,0x02,0x13,0x01,0x00,0x00,0x00,0x00,0x00,0x50,0x00,0x69,0x00,0x64,0x00,0x67,0x00,0x65,0x00,0x6F,0x00,0x74,0x00,0xFF,0xFF,0x6F,0x00,0xFF,0xFF,0xFF,0xFF,0x00,0x17,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x52,0x00,0x6F,0x00,0x43,0x00,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x11,0x01,0x0D,0x00,0x00,0x4B,0x00,0x00,0x19,0x0A,0x00,0x00,0x00};
-static std::shared_ptr<PKX> testPkm(new PK5(test));
+#include "Pack.hpp"
+#include "archive.hpp"
+#include "io.hpp"
+#include <algorithm>
+#include <ctime>
 
 static bool backHeld = false;
 
@@ -110,7 +112,7 @@ void StorageScreen::setBoxName(bool storage)
         input[40] = '\0';
         if (ret == SWKBD_BUTTON_CONFIRM)
         {
-            //storage->setBoxName(storageBox);
+            bank->boxName(storageBox, input);
         }
     }
     else
@@ -200,6 +202,30 @@ StorageScreen::StorageScreen()
     }
     clickButtons[30] = new Button(32, 15, 164, 24, std::bind(&StorageScreen::clickBottomIndex, this, 0), ui_sheet_res_null_idx, "", 0.0f, 0);
     TitleLoader::save->cryptBoxData(true);
+    refreshBox();
+
+    io::CallSite site("Bank::Bank");
+    bank = std::unique_ptr<Bank>(new Bank(Archive::sd(), u"/3ds/PKSM/bank.bnk", Configuration::getInstance().storageSize()));
+    if (!bank->good())
+    {
+        Gui::warn("Could not open the bank, changes won't be saved!");
+    }
+}
+
+std::shared_ptr<PKX> StorageScreen::storagePkm(int slot) const
+{
+    std::shared_ptr<PKX> pk = bank->pkm(storageBox, slot);
+    return pk ? pk : TitleLoader::save->emptyPkm();
+}
+
+void StorageScreen::refreshBox()
+{
+    // one pass over the box's records, rather than a PKX per slot for level and shiny every frame
+    boxSummary = TitleLoader::save->boxSummary(boxBox);
+    for (int i = 0; i < 30; i++)
+    {
+        boxPkm[i] = boxSummary.species[i] > 0 ? TitleLoader::save->pkm(boxBox, i) : nullptr;
+    }
 }
 
 void StorageScreen::draw() const
@@ -213,7 +239,7 @@ void StorageScreen::draw() const
     {
         if (cursorIndex != 0)
         {
-            infoMon = storageChosen ? /*storage->pkm(storageBox, cursorIndex)*/ testPkm : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
+            infoMon = storageChosen ? storagePkm(cursorIndex - 1) : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
         }
     }
     if (infoMon && infoMon->species() == 0)
@@ -241,10 +267,9 @@ void StorageScreen::draw() const
         u16 x = 4;
         for (u8 column = 0; column < 6; column++)
         {
-            std::unique_ptr<PKX> pokemon = TitleLoader::save->pkm(boxBox, row * 6 + column);
-            if (pokemon->species() > 0)
+            if (boxPkm[row * 6 + column])
             {
-                Gui::pkm(pokemon.get(), x, y);
+                Gui::pkm(boxPkm[row * 6 + column].get(), x, y);
             }
             x += 34;
         }
@@ -296,7 +321,8 @@ void StorageScreen::draw() const
         Gui::sprite(ui_sheet_bar_boxname_empty_idx, 44, 21);
         Gui::staticText(45, 24, 24, "\uE004", FONT_SIZE_14, FONT_SIZE_14, COLOR_BLACK);
         Gui::staticText(225, 24, 24, "\uE005", FONT_SIZE_14, FONT_SIZE_14, COLOR_BLACK);
-        Gui::dynamicText(69, 24, 156, StringUtils::format("Bank %i", storageBox + 1), FONT_SIZE_14, FONT_SIZE_14, COLOR_BLACK);
+        std::string name = bank->boxName(storageBox);
+        Gui::dynamicText(69, 24, 156, name.empty() ? StringUtils::format("Bank %i", storageBox + 1) : name, FONT_SIZE_14, FONT_SIZE_14, COLOR_BLACK);
 
         Gui::sprite(ui_sheet_storagemenu_cross_idx, 36, 50);
         Gui::sprite(ui_sheet_storagemenu_cross_idx, 246, 50);
@@ -309,8 +335,7 @@ void StorageScreen::draw() const
             u16 x = 45;
             for (u8 column = 0; column < 6; column++)
             {
-                //Gui::pkm(storage->pkm(storageBox, row * 6 + column).get(), x, y);
-                Gui::pkm(testPkm.get(), x, y);
+                Gui::pkm(bank->pkm(storageBox, row * 6 + column).get(), x, y);
                 x += 34;
             }
             y += 30;
@@ -349,10 +374,11 @@ void StorageScreen::draw() const
 
         if (infoMon)
         {
+            bool fromBox = !moveMon && !storageChosen;
             Gui::dynamicText(infoMon->nickname(), 276, 61, FONT_SIZE_12, FONT_SIZE_12, COLOR_BLACK, false);
             std::string info = "#" + std::to_string(infoMon->species());
             Gui::dynamicText(info, 276, 77, FONT_SIZE_12, FONT_SIZE_12, COLOR_BLACK, false);
-            info = "Lv." + std::to_string(infoMon->level());
+            info = "Lv." + std::to_string(fromBox ? boxSummary.level[cursorIndex - 1] : infoMon->level());
             float width = textWidth(info, FONT_SIZE_12);
             Gui::dynamicText(info, 375 - (int) width, 77, FONT_SIZE_12, FONT_SIZE_12, COLOR_BLACK, false);
             if (infoMon->gender() == 0)
@@ -363,7 +389,7 @@ void StorageScreen::draw() const
             {
                 Gui::sprite(ui_sheet_icon_female_idx, 360 - (int) width, 80);
             }
-            if (infoMon->shiny())
+            if (fromBox ? boxSummary.shiny[cursorIndex - 1] : infoMon->shiny())
             {
                 Gui::sprite(ui_sheet_icon_shiny_idx, 346 - (int) width, 81);
             }
@@ -454,6 +480,16 @@ void StorageScreen::update(touchPosition* touch)
             wirelessStuff();
             return;
         }
+        else if (kDown & KEY_SELECT)
+        {
+            findInBank();
+            return;
+        }
+        else if (kDown & KEY_START)
+        {
+            exportBoxes();
+            return;
+        }
         else if (buttonCooldown <= 0)
         {
             sleep = false;
@@ -568,6 +604,7 @@ bool StorageScreen::lastBox(bool forceBottom)
         {
             boxBox = TitleLoader::save->maxBoxes() - 1;
         }
+        refreshBox();
     }
     return false;
 }
@@ -589,6 +626,7 @@ bool StorageScreen::nextBox(bool forceBottom)
         {
             boxBox = 0;
         }
+        refreshBox();
     }
     return false;
 }
@@ -633,6 +671,10 @@ bool StorageScreen::backButton()
         }
         else
         {
+            if (R_FAILED(bank->save()))
+            {
+                Gui::warn("Could not save the bank!");
+            }
             Gui::screenBack();
         }
     }
@@ -641,7 +683,7 @@ bool StorageScreen::backButton()
 
 bool StorageScreen::showViewer()
 {
-    std::shared_ptr<PKX> view = cursorIndex == 0 ? TitleLoader::save->emptyPkm() : storageChosen ? testPkm : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
+    std::shared_ptr<PKX> view = cursorIndex == 0 ? TitleLoader::save->emptyPkm() : storageChosen ? storagePkm(cursorIndex - 1) : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
     if (view->species() != 0)
     {
         viewer = std::unique_ptr<ViewerScreen>(new ViewerScreen(view, true));
@@ -656,11 +698,15 @@ bool StorageScreen::clearBox()
     {
         for (int i = 0; i < 30; i++)
         {
-            if (storageChosen) { // Storage set all slots in box to PK7()s (or however it happens)
-            }
+            if (storageChosen)
+                bank->clear(storageBox, i);
             else
                 TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, i);
         }
+        if (!storageChosen)
+        {
+            refreshBox();
+        }
     }
     return false;
 }
@@ -668,13 +714,105 @@ bool StorageScreen::clearBox()
 bool StorageScreen::releasePkm()
 {
     backHeld = true;
+    if (cursorIndex == 0)
+    {
+        return false;
+    }
+
     if (Gui::showChoiceMessage("Release the selected Pok\u00E9mon?"))
     {
-        if (storageChosen) { // Storage set all slots in box to PK7()s (or however it happens)
-        }
+        if (storageChosen)
+            bank->clear(storageBox, cursorIndex - 1);
         else
-            TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex);
+        {
+            TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1);
+            refreshBox();
+        }
+    }
+    return false;
+}
+
+bool StorageScreen::dumpPkm()
+{
+    backHeld = true;
+    if (cursorIndex == 0)
+    {
+        return false;
+    }
+
+    std::shared_ptr<PKX> dump = storageChosen ? storagePkm(cursorIndex - 1) : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
+    if (dump->species() != 0 && Gui::showChoiceMessage("Dump the selected Pok\u00E9mon?"))
+    {
+        char stringTime[15] = {0};
+        time_t unixTime = time(NULL);
+        if (std::strftime(stringTime, sizeof(stringTime), "%Y%m%d%H%M%S", gmtime(&unixTime)) == 0)
+        {
+            Gui::warn("Could not dump the Pok\u00E9mon!");
+            return false;
+        }
+        std::string name = StringUtils::format("%s - %i - %s.pk%i", stringTime, dump->species(), dump->nickname().c_str(), dump->generation());
+
+        Pack::Writer out(Archive::sd(), StringUtils::UTF8toUTF16("/3ds/PKSM/dumps.pack"));
+        const PKX& dumped = *dump;
+        if (!out.add(name, dumped.rawData(), dumped.rawLength()))
+        {
+            Gui::warn("Could not dump the Pok\u00E9mon!");
+        }
+        out.close();
+    }
+    return false;
+}
+
+bool StorageScreen::exportBoxes()
+{
+    if (Gui::showChoiceMessage("Export every box of this save as CSV?", std::string("It goes to /3ds/PKSM/exports.")))
+    {
+        char stringTime[15] = {0};
+        time_t unixTime = time(NULL);
+        if (std::strftime(stringTime, sizeof(stringTime), "%Y%m%d%H%M%S", gmtime(&unixTime)) == 0)
+        {
+            Gui::warn("Could not export the boxes!");
+            return false;
+        }
+        std::string csv = TitleLoader::save->boxesCsv();
+        if (R_FAILED(io::writeFile(Archive::sd(), StringUtils::UTF8toUTF16(StringUtils::format("/3ds/PKSM/exports/%s.csv", stringTime)), csv.data(), csv.size())))
+        {
+            Gui::warn("Could not export the boxes!");
+        }
+    }
+    return false;
+}
+
+bool StorageScreen::findInBank()
+{
+    std::shared_ptr<PKX> pk = moveMon;
+    if (!pk && cursorIndex != 0)
+    {
+        pk = storageChosen ? storagePkm(cursorIndex - 1) : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
+    }
+    if (!pk || pk->species() == 0)
+    {
+        return false;
+    }
+
+    BankIndex::Query query;
+    query.species = pk->species();
+    std::vector<u32> found = bank->find(query);
+    if (found.empty())
+    {
+        Gui::warn("There is no Pok\u00E9mon of this species in the bank!");
+        return false;
     }
+    // the first match after the bank cursor, or from the shown bank box on, wrapping around
+    u32 from = storageBox * Bank::SLOTS + (storageChosen ? cursorIndex : 0);
+    auto next = std::lower_bound(found.begin(), found.end(), from);
+    if (next == found.end())
+    {
+        next = found.begin();
+    }
+    storageBox = *next / Bank::SLOTS;
+    cursorIndex = *next % Bank::SLOTS + 1;
+    storageChosen = true;
     return false;
 }
 
@@ -682,27 +820,42 @@ void StorageScreen::pickup()
 {
     if (!moveMon)
     {
-        moveMon = storageChosen ? /*storage->pkm(storageBox, cursorIndex)*/ testPkm : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
+        moveMon = storageChosen ? storagePkm(cursorIndex - 1) : TitleLoader::save->pkm(boxBox, cursorIndex - 1);
         if (storageChosen)
         {
-            // set storage pkm to emptyPKM
+            bank->clear(storageBox, cursorIndex - 1);
         }
         else
         {
             TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1);
+            refreshBox();
         }
     }
     else
     {
         if (storageChosen)
         {
-            // storage implementation->pkm(storageBox, cursorIndex, moveMon);
-            // moveMon = nullptr;
+            std::shared_ptr<PKX> temPkm = storagePkm(cursorIndex - 1);
+            bank->pkm(*moveMon, storageBox, cursorIndex - 1);
+            if (temPkm->species() == 0)
+            {
+                moveMon = nullptr;
+            }
+            else
+            {
+                moveMon = temPkm;
+            }
         }
         else
         {
             std::shared_ptr<PKX> temPkm = TitleLoader::save->pkm(boxBox, cursorIndex - 1);
-            TitleLoader::save->pkm(*moveMon, boxBox, cursorIndex - 1);
+            if (!TitleLoader::save->pkm(*moveMon, boxBox, cursorIndex - 1))
+            {
+                // keep holding it, the bank slot it came from has already been cleared
+                Gui::warn("This Pok\u00E9mon can't be moved to this game!");
+                return;
+            }
+            refreshBox();
             if (temPkm->species() == 0)
             {
                 moveMon = nullptr;
@@ -234,6 +234,21 @@ void TitleLoadScreen::update(touchPosition* touch)
             wirelessSave();
             return;
         }
+        if ((buttonsDown & KEY_Y) && selectedSave != -1)
+        {
+            if (Gui::showChoiceMessage("Restore the latest backup of this save?", std::string("The current save is backed up first.")))
+            {
+                if (TitleLoader::restoreBackup(availableCheckpointSaves[selectedSave + firstSave]))
+                {
+                    Gui::setScreen(std::unique_ptr<Screen>(new MainMenu));
+                }
+                else
+                {
+                    Gui::warn("Could not restore the backup!");
+                }
+            }
+            return;
+        }
         if (buttonsDown & KEY_DOWN)
         {
             if (selectedSave == 4)
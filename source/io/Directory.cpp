@@ -25,6 +25,7 @@
 */
 
 #include "Directory.hpp"
+#include "FileSystem.hpp"
 
 Directory::Directory(FS_Archive archive, std::u16string root)
 {
@@ -34,7 +35,7 @@ Directory::Directory(FS_Archive archive, std::u16string root)
 
 	list.clear();
 
-	err = FSUSER_OpenDirectory(&handle, archive, fsMakePath(PATH_UTF16, root.c_str()));
+	err = io::fs().openDirectory(&handle, archive, root);
 	if (R_FAILED(err))
 	{
 		return;
@@ -43,14 +44,14 @@ Directory::Directory(FS_Archive archive, std::u16string root)
 	u32 result = 0;
 	do {
 		FS_DirectoryEntry item;
-		err = FSDIR_Read(handle, &result, 1, &item);
+		err = io::fs().readDirectory(handle, &result, 1, &item);
 		if (result == 1)
 		{
 			list.push_back(item);
 		}
 	} while(result);
 
-	err = FSDIR_Close(handle);
+	err = io::fs().closeDirectory(handle);
 	if (R_FAILED(err))
 	{
 		list.clear();
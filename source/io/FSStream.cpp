@@ -25,17 +25,24 @@
 */
 
 #include "FSStream.hpp"
+#include "FileSystem.hpp"
+#include <algorithm>
 
 FSStream::FSStream(FS_Archive archive, const std::u16string& path, u32 flags)
 {
     mGood = false;
     mSize = 0;
     mOffset = 0;
+    mPolicy = FLUSH_EACH_WRITE;
+    mCapacity = 0;
+    mBufferOffset = 0;
 
-    mResult = FSUSER_OpenFile(&mHandle, archive, fsMakePath(PATH_UTF16, path.data()), flags, 0);
+    mResult = io::fs().openFile(&mHandle, archive, path, flags);
     if (R_SUCCEEDED(mResult))
     {
-        FSFILE_GetSize(mHandle, (u64*)&mSize);
+        u64 size = 0;
+        io::fs().size(mHandle, &size);
+        mSize = (u32)size;
         mGood = true;
     }
 }
@@ -45,14 +52,17 @@ FSStream::FSStream(FS_Archive archive, const std::u16string& path, u32 flags, u3
     mGood = false;
     mSize = size;
     mOffset = 0;
+    mPolicy = FLUSH_EACH_WRITE;
+    mCapacity = 0;
+    mBufferOffset = 0;
 
-    mResult = FSUSER_OpenFile(&mHandle, archive, fsMakePath(PATH_UTF16, path.data()), flags, 0);
+    mResult = io::fs().openFile(&mHandle, archive, path, flags);
     if (R_FAILED(mResult))
     {
-        mResult = FSUSER_CreateFile(archive, fsMakePath(PATH_UTF16, path.data()), 0, mSize);
+        mResult = io::fs().createFile(archive, path, mSize);
         if (R_SUCCEEDED(mResult))
         {
-            mResult = FSUSER_OpenFile(&mHandle, archive, fsMakePath(PATH_UTF16, path.data()), flags, 0);
+            mResult = io::fs().openFile(&mHandle, archive, path, flags);
             if (R_SUCCEEDED(mResult))
             {
                 mGood = true;
@@ -65,10 +75,83 @@ FSStream::FSStream(FS_Archive archive, const std::u16string& path, u32 flags, u3
     }
 }
 
+FSStream::~FSStream(void)
+{
+    if (!mBuffer.empty())
+    {
+        if (mPolicy == FLUSH_ON_CLOSE)
+        {
+            flush();
+        }
+        else
+        {
+            drain();
+        }
+    }
+}
+
+void FSStream::buffer(FlushPolicy policy, u32 capacity)
+{
+    drain();
+    mPolicy = policy;
+    mCapacity = policy == FLUSH_EACH_WRITE ? 0 : capacity;
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+    mBuffer.reserve(mCapacity);
+}
+
+Result FSStream::drain(void)
+{
+    if (mBuffer.empty())
+    {
+        return 0;
+    }
+
+    u32 wt = 0;
+    Result res = io::fs().write(mHandle, &wt, mBufferOffset, mBuffer.data(), mBuffer.size(), 0);
+    if (R_SUCCEEDED(res) && wt != mBuffer.size())
+    {
+        // the backend accepted less than asked for, keep the rest so a later drain can retry
+        mBuffer.erase(mBuffer.begin(), mBuffer.begin() + wt);
+        mBufferOffset += wt;
+        return mResult = -1;
+    }
+    if (R_SUCCEEDED(res))
+    {
+        mBuffer.clear();
+    }
+    else
+    {
+        mResult = res;
+    }
+    return res;
+}
+
+Result FSStream::flush(void)
+{
+    Result res = drain();
+    if (R_FAILED(res))
+    {
+        return res;
+    }
+    return mResult = io::fs().flush(mHandle);
+}
+
 Result FSStream::close(void)
 {
-    mResult = FSFILE_Close(mHandle);
-    return mResult;
+    Result res = 0;
+    if (mPolicy == FLUSH_ON_CLOSE)
+    {
+        res = flush();
+    }
+    else
+    {
+        res = drain();
+    }
+    // whatever couldn't be written is lost with the handle, the destructor mustn't retry it
+    mBuffer.clear();
+    mResult = io::fs().close(mHandle);
+    return R_FAILED(res) ? res : mResult;
 }
 
 bool FSStream::good(void)
@@ -88,8 +171,13 @@ u32 FSStream::size(void)
 
 u32 FSStream::read(void *buf, u32 sz)
 {
+    if (R_FAILED(drain()))
+    {
+        return 0;
+    }
+
     u32 rd = 0;
-    mResult = FSFILE_Read(mHandle, &rd, mOffset, buf, sz);
+    mResult = io::fs().read(mHandle, &rd, mOffset, buf, sz);
     if (R_FAILED(mResult))
     {
         if (rd > sz)
@@ -101,11 +189,51 @@ u32 FSStream::read(void *buf, u32 sz)
     return rd;
 }
 
+Result FSStream::resize(u32 sz)
+{
+    if (R_FAILED(drain()))
+    {
+        return mResult;
+    }
+
+    mResult = io::fs().setSize(mHandle, sz);
+    if (R_SUCCEEDED(mResult))
+    {
+        mSize = sz;
+    }
+    return mResult;
+}
+
 u32 FSStream::write(const void *buf, u32 sz)
 {
+    if (mPolicy != FLUSH_EACH_WRITE)
+    {
+        // anything that doesn't extend the pending run has to go out first
+        if (!mBuffer.empty() && (mOffset != mBufferOffset + mBuffer.size() || mBuffer.size() + sz > mCapacity))
+        {
+            if (R_FAILED(drain()))
+            {
+                return 0;
+            }
+        }
+
+        if (sz < mCapacity)
+        {
+            if (mBuffer.empty())
+            {
+                mBufferOffset = mOffset;
+            }
+            mBuffer.insert(mBuffer.end(), (const u8*)buf, (const u8*)buf + sz);
+            mOffset += sz;
+            mSize = std::max(mSize, mOffset);
+            return sz;
+        }
+    }
+
     u32 wt = 0;
-    mResult = FSFILE_Write(mHandle, &wt, mOffset, buf, sz, FS_WRITE_FLUSH);
+    mResult = io::fs().write(mHandle, &wt, mOffset, buf, sz, mPolicy == FLUSH_EACH_WRITE ? FS_WRITE_FLUSH : 0);
     mOffset += wt;
+    mSize = std::max(mSize, mOffset);
     return wt;
 }
 
@@ -117,4 +245,9 @@ bool FSStream::eof(void)
 u32 FSStream::offset(void)
 {
     return mOffset;
+}
+
+void FSStream::seek(u32 offset)
+{
+    mOffset = offset;
 }
\ No newline at end of file
@@ -0,0 +1,255 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "FileSystem.hpp"
+#ifndef _3DS
+#include <time.h>
+#endif
+
+namespace
+{
+#ifdef _3DS
+    io::CtrFileSystem native;
+#else
+    io::PosixFileSystem native(".");
+#endif
+    io::FileSystem* current = &native;
+    thread_local const char* site = nullptr;
+
+    u64 now(void)
+    {
+#ifdef _3DS
+        return svcGetSystemTick() / (SYSCLOCK_ARM11 / 1000000);
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    }
+}
+
+namespace io
+{
+    FileSystem& fs(void)
+    {
+        return *current;
+    }
+
+    void fs(FileSystem* backend)
+    {
+        current = backend ? backend : &native;
+    }
+
+    CallSite::CallSite(const char* name)
+    {
+        mPrevious = site;
+        site = name;
+    }
+
+    CallSite::~CallSite(void)
+    {
+        site = mPrevious;
+    }
+
+    const char* CallSite::current(void)
+    {
+        return site;
+    }
+
+    std::map<std::string, InstrumentedFileSystem::Counters> InstrumentedFileSystem::stats(void)
+    {
+        mMutex.lock();
+        std::map<std::string, Counters> ret = mStats;
+        mMutex.unlock();
+        return ret;
+    }
+
+    void InstrumentedFileSystem::reset(void)
+    {
+        mMutex.lock();
+        mStats.clear();
+        mMutex.unlock();
+    }
+
+    void InstrumentedFileSystem::record(Kind kind, u64 start, u64 bytes)
+    {
+        u64 elapsed = now() - start;
+        const char* name = CallSite::current();
+
+        mMutex.lock();
+        Counters& counters = mStats[name ? name : "unknown"];
+        switch (kind)
+        {
+            case OPEN:
+                counters.opens++;
+                counters.openTime += elapsed;
+                break;
+            case READ:
+                counters.reads++;
+                counters.bytesRead += bytes;
+                counters.readTime += elapsed;
+                break;
+            case WRITE:
+                counters.writes++;
+                counters.bytesWritten += bytes;
+                counters.writeTime += elapsed;
+                break;
+            case OTHER:
+                counters.others++;
+                counters.otherTime += elapsed;
+                break;
+        }
+        mMutex.unlock();
+    }
+
+    Result InstrumentedFileSystem::openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path)
+    {
+        u64 start = now();
+        Result res = mBackend.openArchive(archive, id, path);
+        record(OPEN, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::closeArchive(FS_Archive archive)
+    {
+        u64 start = now();
+        Result res = mBackend.closeArchive(archive);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags)
+    {
+        u64 start = now();
+        Result res = mBackend.openFile(handle, archive, path, flags);
+        record(OPEN, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::createFile(FS_Archive archive, const std::u16string& path, u64 size)
+    {
+        u64 start = now();
+        Result res = mBackend.createFile(archive, path, size);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::deleteFile(FS_Archive archive, const std::u16string& path)
+    {
+        u64 start = now();
+        Result res = mBackend.deleteFile(archive, path);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to)
+    {
+        u64 start = now();
+        Result res = mBackend.renameFile(archive, from, to);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::createDirectory(FS_Archive archive, const std::u16string& path)
+    {
+        u64 start = now();
+        Result res = mBackend.createDirectory(archive, path);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::read(Handle handle, u32* read, u64 offset, void* buf, u32 size)
+    {
+        u64 start = now();
+        Result res = mBackend.read(handle, read, offset, buf, size);
+        record(READ, start, *read);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags)
+    {
+        u64 start = now();
+        Result res = mBackend.write(handle, written, offset, buf, size, flags);
+        record(WRITE, start, *written);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::size(Handle handle, u64* size)
+    {
+        u64 start = now();
+        Result res = mBackend.size(handle, size);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::setSize(Handle handle, u64 size)
+    {
+        u64 start = now();
+        Result res = mBackend.setSize(handle, size);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::flush(Handle handle)
+    {
+        u64 start = now();
+        Result res = mBackend.flush(handle);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::close(Handle handle)
+    {
+        u64 start = now();
+        Result res = mBackend.close(handle);
+        record(OTHER, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path)
+    {
+        u64 start = now();
+        Result res = mBackend.openDirectory(handle, archive, path);
+        record(OPEN, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries)
+    {
+        u64 start = now();
+        Result res = mBackend.readDirectory(handle, read, count, entries);
+        record(READ, start, 0);
+        return res;
+    }
+
+    Result InstrumentedFileSystem::closeDirectory(Handle handle)
+    {
+        u64 start = now();
+        Result res = mBackend.closeDirectory(handle);
+        record(OTHER, start, 0);
+        return res;
+    }
+}
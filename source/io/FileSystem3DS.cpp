@@ -0,0 +1,114 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifdef _3DS
+
+#include "FileSystem.hpp"
+
+namespace io
+{
+    Result CtrFileSystem::openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path)
+    {
+        return FSUSER_OpenArchive(archive, id, path);
+    }
+
+    Result CtrFileSystem::closeArchive(FS_Archive archive)
+    {
+        return FSUSER_CloseArchive(archive);
+    }
+
+    Result CtrFileSystem::openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags)
+    {
+        return FSUSER_OpenFile(handle, archive, fsMakePath(PATH_UTF16, path.data()), flags, 0);
+    }
+
+    Result CtrFileSystem::createFile(FS_Archive archive, const std::u16string& path, u64 size)
+    {
+        return FSUSER_CreateFile(archive, fsMakePath(PATH_UTF16, path.data()), 0, size);
+    }
+
+    Result CtrFileSystem::deleteFile(FS_Archive archive, const std::u16string& path)
+    {
+        return FSUSER_DeleteFile(archive, fsMakePath(PATH_UTF16, path.data()));
+    }
+
+    Result CtrFileSystem::renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to)
+    {
+        return FSUSER_RenameFile(archive, fsMakePath(PATH_UTF16, from.data()), archive, fsMakePath(PATH_UTF16, to.data()));
+    }
+
+    Result CtrFileSystem::createDirectory(FS_Archive archive, const std::u16string& path)
+    {
+        return FSUSER_CreateDirectory(archive, fsMakePath(PATH_UTF16, path.data()), 0);
+    }
+
+    Result CtrFileSystem::read(Handle handle, u32* read, u64 offset, void* buf, u32 size)
+    {
+        return FSFILE_Read(handle, read, offset, buf, size);
+    }
+
+    Result CtrFileSystem::write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags)
+    {
+        return FSFILE_Write(handle, written, offset, buf, size, flags);
+    }
+
+    Result CtrFileSystem::size(Handle handle, u64* size)
+    {
+        return FSFILE_GetSize(handle, size);
+    }
+
+    Result CtrFileSystem::setSize(Handle handle, u64 size)
+    {
+        return FSFILE_SetSize(handle, size);
+    }
+
+    Result CtrFileSystem::flush(Handle handle)
+    {
+        return FSFILE_Flush(handle);
+    }
+
+    Result CtrFileSystem::close(Handle handle)
+    {
+        return FSFILE_Close(handle);
+    }
+
+    Result CtrFileSystem::openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path)
+    {
+        return FSUSER_OpenDirectory(handle, archive, fsMakePath(PATH_UTF16, path.data()));
+    }
+
+    Result CtrFileSystem::readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries)
+    {
+        return FSDIR_Read(handle, read, count, entries);
+    }
+
+    Result CtrFileSystem::closeDirectory(Handle handle)
+    {
+        return FSDIR_Close(handle);
+    }
+}
+
+#endif
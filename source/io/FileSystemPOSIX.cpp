@@ -0,0 +1,297 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _3DS
+
+#include "FileSystem.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Same description codes the 3DS FS module hands back, so callers can't tell the backends apart
+static constexpr Result NOT_FOUND      = 0xC8804478;
+static constexpr Result ALREADY_EXISTS = 0xC82044BE;
+static constexpr Result INVALID_HANDLE = 0xD8E007F7;
+static constexpr Result FAILURE        = 0xC8804464;
+
+static Result fromErrno(void)
+{
+    switch (errno)
+    {
+        case ENOENT:
+        case ENOTDIR:
+            return NOT_FOUND;
+        case EEXIST:
+            return ALREADY_EXISTS;
+        case EBADF:
+            return INVALID_HANDLE;
+        default:
+            return FAILURE;
+    }
+}
+
+namespace io
+{
+    PosixFileSystem::PosixFileSystem(const std::string& root)
+    {
+        mRoot = root;
+        while (!mRoot.empty() && mRoot.back() == '/')
+        {
+            mRoot.pop_back();
+        }
+        mNextArchive = 1;
+        mNextDirectory = 1;
+    }
+
+    std::string PosixFileSystem::hostPath(FS_Archive archive, const std::u16string& path)
+    {
+        mMutex.lock();
+        auto it = mArchives.find(archive);
+        std::string base = it != mArchives.end() ? it->second : std::string();
+        mMutex.unlock();
+        return base + StringUtils::UTF16toUTF8(path);
+    }
+
+    Result PosixFileSystem::openArchive(FS_Archive* archive, FS_ArchiveID id, FS_Path path)
+    {
+        std::string dir = mRoot;
+        if (id != ARCHIVE_SDMC)
+        {
+            // Save and extdata archives are told apart by their binary path, so it becomes part of the folder name
+            static const char hex[] = "0123456789ABCDEF";
+            dir += "/archive_" + std::to_string((u32)id) + "_";
+            const u8* data = (const u8*)path.data;
+            for (u32 i = 0; path.type == PATH_BINARY && i < path.size; i++)
+            {
+                dir += hex[data[i] >> 4];
+                dir += hex[data[i] & 0xF];
+            }
+        }
+
+        struct stat st;
+        if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            return NOT_FOUND;
+        }
+
+        mMutex.lock();
+        *archive = mNextArchive++;
+        mArchives[*archive] = dir;
+        mMutex.unlock();
+        return 0;
+    }
+
+    Result PosixFileSystem::closeArchive(FS_Archive archive)
+    {
+        mMutex.lock();
+        size_t erased = mArchives.erase(archive);
+        mMutex.unlock();
+        return erased ? 0 : INVALID_HANDLE;
+    }
+
+    Result PosixFileSystem::openFile(Handle* handle, FS_Archive archive, const std::u16string& path, u32 flags)
+    {
+        int mode = (flags & FS_OPEN_WRITE) ? O_RDWR : O_RDONLY;
+        if (flags & FS_OPEN_CREATE)
+        {
+            mode |= O_CREAT;
+        }
+        int fd = open(hostPath(archive, path).c_str(), mode, 0644);
+        if (fd < 0)
+        {
+            return fromErrno();
+        }
+        *handle = (Handle)fd;
+        return 0;
+    }
+
+    Result PosixFileSystem::createFile(FS_Archive archive, const std::u16string& path, u64 size)
+    {
+        int fd = open(hostPath(archive, path).c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0)
+        {
+            return fromErrno();
+        }
+        Result res = ftruncate(fd, (off_t)size) == 0 ? 0 : fromErrno();
+        ::close(fd);
+        return res;
+    }
+
+    Result PosixFileSystem::deleteFile(FS_Archive archive, const std::u16string& path)
+    {
+        return unlink(hostPath(archive, path).c_str()) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::renameFile(FS_Archive archive, const std::u16string& from, const std::u16string& to)
+    {
+        // rename(2) would silently replace the destination, FSUSER_RenameFile refuses to
+        std::string dst = hostPath(archive, to);
+        if (access(dst.c_str(), F_OK) == 0)
+        {
+            return ALREADY_EXISTS;
+        }
+        return rename(hostPath(archive, from).c_str(), dst.c_str()) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::createDirectory(FS_Archive archive, const std::u16string& path)
+    {
+        return mkdir(hostPath(archive, path).c_str(), 0755) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::read(Handle handle, u32* read, u64 offset, void* buf, u32 size)
+    {
+        ssize_t got = pread((int)handle, buf, size, (off_t)offset);
+        if (got < 0)
+        {
+            *read = 0;
+            return fromErrno();
+        }
+        *read = (u32)got;
+        return 0;
+    }
+
+    Result PosixFileSystem::write(Handle handle, u32* written, u64 offset, const void* buf, u32 size, u32 flags)
+    {
+        ssize_t put = pwrite((int)handle, buf, size, (off_t)offset);
+        if (put < 0)
+        {
+            *written = 0;
+            return fromErrno();
+        }
+        *written = (u32)put;
+        if (flags & FS_WRITE_FLUSH)
+        {
+            return flush(handle);
+        }
+        return 0;
+    }
+
+    Result PosixFileSystem::size(Handle handle, u64* size)
+    {
+        struct stat st;
+        if (fstat((int)handle, &st) != 0)
+        {
+            return fromErrno();
+        }
+        *size = (u64)st.st_size;
+        return 0;
+    }
+
+    Result PosixFileSystem::setSize(Handle handle, u64 size)
+    {
+        return ftruncate((int)handle, (off_t)size) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::flush(Handle handle)
+    {
+        return fsync((int)handle) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::close(Handle handle)
+    {
+        return ::close((int)handle) == 0 ? 0 : fromErrno();
+    }
+
+    Result PosixFileSystem::openDirectory(Handle* handle, FS_Archive archive, const std::u16string& path)
+    {
+        DIR* dir = opendir(hostPath(archive, path).c_str());
+        if (dir == nullptr)
+        {
+            return fromErrno();
+        }
+        mMutex.lock();
+        *handle = mNextDirectory++;
+        mDirectories[*handle] = dir;
+        mMutex.unlock();
+        return 0;
+    }
+
+    Result PosixFileSystem::readDirectory(Handle handle, u32* read, u32 count, FS_DirectoryEntry* entries)
+    {
+        *read = 0;
+        mMutex.lock();
+        auto it = mDirectories.find(handle);
+        DIR* dir = it != mDirectories.end() ? (DIR*)it->second : nullptr;
+        mMutex.unlock();
+        if (dir == nullptr)
+        {
+            return INVALID_HANDLE;
+        }
+
+        struct dirent* ent;
+        while (*read < count && (ent = readdir(dir)) != nullptr)
+        {
+            std::string name = ent->d_name;
+            if (name == "." || name == "..")
+            {
+                continue;
+            }
+
+            FS_DirectoryEntry& out = entries[*read];
+            memset(&out, 0, sizeof(FS_DirectoryEntry));
+            std::u16string wide = StringUtils::UTF8toUTF16(name);
+            size_t len = std::min(wide.size(), sizeof(out.name) / sizeof(u16) - 1);
+            memcpy(out.name, wide.data(), len * sizeof(u16));
+
+            bool isDirectory = ent->d_type == DT_DIR;
+            if (ent->d_type == DT_UNKNOWN)
+            {
+                struct stat st;
+                isDirectory = fstatat(dirfd(dir), ent->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+            }
+            out.attributes = isDirectory ? FS_ATTRIBUTE_DIRECTORY : 0;
+            out.valid = 1;
+            (*read)++;
+        }
+        return 0;
+    }
+
+    Result PosixFileSystem::closeDirectory(Handle handle)
+    {
+        mMutex.lock();
+        auto it = mDirectories.find(handle);
+        DIR* dir = nullptr;
+        if (it != mDirectories.end())
+        {
+            dir = (DIR*)it->second;
+            mDirectories.erase(it);
+        }
+        mMutex.unlock();
+        if (dir == nullptr)
+        {
+            return INVALID_HANDLE;
+        }
+        closedir(dir);
+        return 0;
+    }
+}
+
+#endif
@@ -0,0 +1,381 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "Pack.hpp"
+#include "lz.h"
+#include <algorithm>
+
+namespace
+{
+    const char MAGIC[8] = { 'P', 'K', 'S', 'M', 'P', 'A', 'C', 'K' };
+    constexpr u32 VERSION     = 1;
+    constexpr u32 HEADER_SIZE = 16;
+    constexpr u32 ENTRY_MAGIC = 0x4E454B50; // "PKEN"
+    constexpr u32 INDEX_MAGIC = 0x58494B50; // "PKIX"
+    constexpr u32 RECORD_SIZE = 20;
+    constexpr u32 FOOTER_SIZE = 16;
+
+    // Entry headers and index records share the same layout, only the leading word differs:
+    // the entry magic in front of the data, the entry offset in the index.
+    // u32 lead, u32 rawSize, u32 storedSize, u32 checksum, u8 method, u8 reserved, u16 nameLength, name
+    void putRecord(std::vector<u8>& buf, u32 lead, const Pack::Entry& entry)
+    {
+        size_t pos = buf.size();
+        buf.resize(pos + RECORD_SIZE + entry.name.size());
+        u8* p = buf.data() + pos;
+        *(u32*)(p) = lead;
+        *(u32*)(p + 4) = entry.rawSize;
+        *(u32*)(p + 8) = entry.storedSize;
+        *(u32*)(p + 12) = entry.checksum;
+        p[16] = entry.method;
+        p[17] = 0;
+        *(u16*)(p + 18) = entry.name.size();
+        std::copy(entry.name.begin(), entry.name.end(), p + RECORD_SIZE);
+    }
+
+    // Fills everything but the name and returns the name length
+    u16 getRecord(const u8* p, u32& lead, Pack::Entry& entry)
+    {
+        lead = *(u32*)(p);
+        entry.rawSize = *(u32*)(p + 4);
+        entry.storedSize = *(u32*)(p + 8);
+        entry.checksum = *(u32*)(p + 12);
+        entry.method = p[16];
+        return *(u16*)(p + 18);
+    }
+
+    bool validHeader(FSStream& stream)
+    {
+        u8 header[HEADER_SIZE];
+        stream.seek(0);
+        if (stream.read(header, HEADER_SIZE) != HEADER_SIZE)
+        {
+            return false;
+        }
+        return std::equal(MAGIC, MAGIC + 8, header) && *(u32*)(header + 8) <= VERSION;
+    }
+
+    bool readIndex(FSStream& stream, u32 size, std::vector<Pack::Entry>& entries, u32& end)
+    {
+        if (size < HEADER_SIZE + 4 + FOOTER_SIZE)
+        {
+            return false;
+        }
+
+        u8 footer[FOOTER_SIZE];
+        stream.seek(size - FOOTER_SIZE);
+        if (stream.read(footer, FOOTER_SIZE) != FOOTER_SIZE || *(u32*)(footer + 12) != INDEX_MAGIC)
+        {
+            return false;
+        }
+
+        u32 indexOffset = *(u32*)(footer);
+        u32 indexLength = *(u32*)(footer + 4);
+        if (indexOffset < HEADER_SIZE || indexLength < 4 || indexLength > size || indexOffset != size - FOOTER_SIZE - indexLength)
+        {
+            return false;
+        }
+
+        std::vector<u8> index(indexLength);
+        stream.seek(indexOffset);
+        if (stream.read(index.data(), indexLength) != indexLength || lz_checksum(index.data(), indexLength) != *(u32*)(footer + 8))
+        {
+            return false;
+        }
+
+        u32 count = *(u32*)(index.data());
+        u32 pos = 4;
+        entries.clear();
+        for (u32 i = 0; i < count; i++)
+        {
+            Pack::Entry entry;
+            if (indexLength - pos < RECORD_SIZE)
+            {
+                return false;
+            }
+            u16 nameLength = getRecord(index.data() + pos, entry.offset, entry);
+            pos += RECORD_SIZE;
+            if (indexLength - pos < nameLength)
+            {
+                return false;
+            }
+            entry.name.assign((const char*)index.data() + pos, nameLength);
+            pos += nameLength;
+            entries.push_back(entry);
+        }
+
+        end = indexOffset;
+        return true;
+    }
+
+    // Recovers the entry list from the entry headers, stopping at the first damaged or truncated one
+    void scanEntries(FSStream& stream, u32 size, std::vector<Pack::Entry>& entries, u32& end)
+    {
+        entries.clear();
+        end = HEADER_SIZE;
+        while (size - end >= RECORD_SIZE)
+        {
+            u8 header[RECORD_SIZE];
+            u32 magic;
+            Pack::Entry entry;
+            stream.seek(end);
+            if (stream.read(header, RECORD_SIZE) != RECORD_SIZE)
+            {
+                break;
+            }
+            u16 nameLength = getRecord(header, magic, entry);
+            if (magic != ENTRY_MAGIC || size - end - RECORD_SIZE < (u64)nameLength + entry.storedSize)
+            {
+                break;
+            }
+            entry.name.resize(nameLength);
+            if (stream.read(&entry.name[0], nameLength) != nameLength)
+            {
+                break;
+            }
+            entry.offset = end;
+            end += RECORD_SIZE + nameLength + entry.storedSize;
+            entries.push_back(entry);
+        }
+    }
+}
+
+Pack::Writer::Writer(FS_Archive archive, const std::u16string& path)
+    : mStream(archive, path, FS_OPEN_READ | FS_OPEN_WRITE | FS_OPEN_CREATE), mEnd(HEADER_SIZE),
+      mResult(0), mGood(false), mDirty(false), mClosed(false)
+{
+    if (!mStream.good())
+    {
+        mResult = mStream.result();
+        mClosed = true;
+        return;
+    }
+    // entries and the index are appended back to back, so let them reach the card in large chunks
+    mStream.buffer(FSStream::FLUSH_ON_CLOSE);
+
+    u32 size = mStream.size();
+    if (size == 0)
+    {
+        u8 header[HEADER_SIZE] = {0};
+        std::copy(MAGIC, MAGIC + 8, header);
+        *(u32*)(header + 8) = VERSION;
+        if (mStream.write(header, HEADER_SIZE) != HEADER_SIZE)
+        {
+            mResult = mStream.result();
+            return;
+        }
+        mDirty = true;
+    }
+    else if (!validHeader(mStream))
+    {
+        // not ours, leave it alone
+        return;
+    }
+    else if (!readIndex(mStream, size, mEntries, mEnd))
+    {
+        scanEntries(mStream, size, mEntries, mEnd);
+        mDirty = true;
+    }
+
+    mGood = true;
+}
+
+Pack::Writer::~Writer(void)
+{
+    if (!mClosed)
+    {
+        close();
+    }
+}
+
+bool Pack::Writer::add(const std::string& name, const u8* data, u32 size)
+{
+    if (!mGood || name.size() > 0xFFFF)
+    {
+        return false;
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.offset = mEnd;
+    entry.rawSize = size;
+    entry.checksum = lz_checksum(data, size);
+
+    // header and payload go out in a single write
+    u32 headerSize = RECORD_SIZE + name.size();
+    std::vector<u8> buf(headerSize + lz_compress_bound(size));
+    size_t packed = lz_compress(data, size, buf.data() + headerSize, buf.size() - headerSize);
+    if (packed == 0 || packed >= size)
+    {
+        std::copy(data, data + size, buf.data() + headerSize);
+        entry.method = STORED;
+        entry.storedSize = size;
+    }
+    else
+    {
+        entry.method = LZ;
+        entry.storedSize = packed;
+    }
+    buf.resize(headerSize + entry.storedSize);
+
+    std::vector<u8> header;
+    putRecord(header, ENTRY_MAGIC, entry);
+    std::copy(header.begin(), header.end(), buf.begin());
+
+    mStream.seek(mEnd);
+    if (mStream.write(buf.data(), buf.size()) != buf.size())
+    {
+        // whatever made it to the file lies past mEnd and will be overwritten by the index
+        mResult = mStream.result();
+        return false;
+    }
+
+    mEnd += buf.size();
+    mEntries.push_back(entry);
+    mDirty = true;
+    return true;
+}
+
+Result Pack::Writer::close(void)
+{
+    if (mClosed)
+    {
+        return mResult;
+    }
+
+    if (mGood && mDirty)
+    {
+        std::vector<u8> index(4);
+        *(u32*)(index.data()) = mEntries.size();
+        for (size_t i = 0; i < mEntries.size(); i++)
+        {
+            putRecord(index, mEntries[i].offset, mEntries[i]);
+        }
+
+        u8 footer[FOOTER_SIZE];
+        *(u32*)(footer) = mEnd;
+        *(u32*)(footer + 4) = index.size();
+        *(u32*)(footer + 8) = lz_checksum(index.data(), index.size());
+        *(u32*)(footer + 12) = INDEX_MAGIC;
+        index.insert(index.end(), footer, footer + FOOTER_SIZE);
+
+        mStream.seek(mEnd);
+        if (mStream.write(index.data(), index.size()) != index.size())
+        {
+            mResult = mStream.result();
+        }
+        else if (R_FAILED(mStream.resize(mEnd + index.size())))
+        {
+            mResult = mStream.result();
+        }
+        mDirty = false;
+    }
+
+    mGood = false;
+    mClosed = true;
+    Result res = mStream.close();
+    return R_FAILED(mResult) ? mResult : res;
+}
+
+Pack::Reader::Reader(FS_Archive archive, const std::u16string& path)
+    : mStream(archive, path, FS_OPEN_READ), mGood(false), mClosed(false)
+{
+    if (!mStream.good())
+    {
+        mClosed = true;
+        return;
+    }
+
+    if (validHeader(mStream))
+    {
+        u32 end;
+        if (!readIndex(mStream, mStream.size(), mEntries, end))
+        {
+            scanEntries(mStream, mStream.size(), mEntries, end);
+        }
+        mGood = true;
+    }
+}
+
+Pack::Reader::~Reader(void)
+{
+    if (!mClosed)
+    {
+        close();
+    }
+}
+
+int Pack::Reader::find(const std::string& name) const
+{
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        if (mEntries[i].name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool Pack::Reader::extract(size_t index, u8* out)
+{
+    if (!mGood || index >= mEntries.size())
+    {
+        return false;
+    }
+
+    const Entry& entry = mEntries[index];
+    mStream.seek(entry.offset + RECORD_SIZE + entry.name.size());
+    if (entry.method == STORED)
+    {
+        if (mStream.read(out, entry.rawSize) != entry.rawSize)
+        {
+            return false;
+        }
+    }
+    else if (entry.method == LZ)
+    {
+        std::vector<u8> packed(entry.storedSize);
+        if (mStream.read(packed.data(), entry.storedSize) != entry.storedSize ||
+            lz_decompress(packed.data(), entry.storedSize, out, entry.rawSize) != entry.rawSize)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return lz_checksum(out, entry.rawSize) == entry.checksum;
+}
+
+Result Pack::Reader::close(void)
+{
+    mGood = false;
+    mClosed = true;
+    return mStream.close();
+}
@@ -25,7 +25,7 @@
 */
 
 #include "archive.hpp"
-#include <sys/stat.h>
+#include "FileSystem.hpp"
 
 static FS_Archive sdmc;
 static FS_Archive mData;
@@ -33,20 +33,21 @@ static FS_Archive mData;
 Result Archive::init(void)
 {
     Result res = 0;
-    if (R_FAILED(res = FSUSER_OpenArchive(&sdmc, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, "")))) return res;
+    if (R_FAILED(res = io::fs().openArchive(&sdmc, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, "")))) return res;
     if (!extdataAccessible(UNIQUE_ID))
     {
         if (R_FAILED(res = createPKSMExtdataArchive())) return res;
     }
     else if (R_FAILED(res = extdata(&mData, UNIQUE_ID))) return res;
-    mkdir("/3ds/PKSM/backups", 777);
+    io::fs().createDirectory(sdmc, u"/3ds/PKSM/backups");
+    io::fs().createDirectory(sdmc, u"/3ds/PKSM/exports");
     return res;
 }
 
 void Archive::exit(void)
 {
-    FSUSER_CloseArchive(mData);
-    FSUSER_CloseArchive(sdmc);
+    io::fs().closeArchive(mData);
+    io::fs().closeArchive(sdmc);
 }
 
 FS_Archive Archive::sd(void)
@@ -62,13 +63,13 @@ FS_Archive Archive::data(void)
 Result Archive::save(FS_Archive* archive, FS_MediaType mediatype, u32 lowid, u32 highid)
 {
     const u32 path[3] = { mediatype, lowid, highid };
-    return FSUSER_OpenArchive(archive, ARCHIVE_USER_SAVEDATA, {PATH_BINARY, 12, path});
+    return io::fs().openArchive(archive, ARCHIVE_USER_SAVEDATA, {PATH_BINARY, 12, path});
 }
 
 Result Archive::extdata(FS_Archive* archive, u32 extdata)
 {
     const u32 path[3] = { MEDIATYPE_SD, extdata, 0 };
-    return FSUSER_OpenArchive(archive, ARCHIVE_EXTDATA, {PATH_BINARY, 12, path});
+    return io::fs().openArchive(archive, ARCHIVE_EXTDATA, {PATH_BINARY, 12, path});
 }
 
 bool Archive::saveAccessible(FS_MediaType mediatype, u32 lowid, u32 highid)
@@ -77,7 +78,7 @@ bool Archive::saveAccessible(FS_MediaType mediatype, u32 lowid, u32 highid)
     Result res = save(&archive, mediatype, lowid, highid);
     if (R_SUCCEEDED(res))
     {
-        FSUSER_CloseArchive(archive);
+        io::fs().closeArchive(archive);
         return true;
     }
     return false;
@@ -89,7 +90,7 @@ bool Archive::extdataAccessible(u32 id)
     Result res = extdata(&archive, id);
     if (R_SUCCEEDED(res))
     {
-        FSUSER_CloseArchive(archive);
+        io::fs().closeArchive(archive);
         return true;
     }
     return false;
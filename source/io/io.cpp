@@ -25,9 +25,98 @@
 */
 
 #include "io.hpp"
+#include "FileSystem.hpp"
+#include "FSStream.hpp"
 
 bool io::exists(const std::string& name)
 {
     struct stat buffer;
     return (stat (name.c_str(), &buffer) == 0);
+}
+
+Result io::replaceFile(FS_Archive archive, const std::u16string& path, const void* data, u32 size)
+{
+    const std::u16string temp = path + u".tmp";
+    fs().deleteFile(archive, temp);
+
+    // created at its final size, extdata files can't grow afterwards
+    FSStream stream(archive, temp, FS_OPEN_WRITE, size);
+    if (!stream.good())
+    {
+        return stream.result();
+    }
+    u32 written = stream.write(data, size);
+    Result res = stream.result();
+    Result closed = stream.close();
+    if (written != size)
+    {
+        fs().deleteFile(archive, temp);
+        return R_FAILED(res) ? res : -1;
+    }
+    if (R_FAILED(closed))
+    {
+        fs().deleteFile(archive, temp);
+        return closed;
+    }
+
+    // FSUSER_RenameFile won't overwrite, the old copy has to go first
+    fs().deleteFile(archive, path);
+    return fs().renameFile(archive, temp, path);
+}
+
+Result io::recoverFile(FS_Archive archive, const std::u16string& path)
+{
+    const std::u16string temp = path + u".tmp";
+    {
+        FSStream stream(archive, temp, FS_OPEN_READ);
+        if (!stream.good())
+        {
+            return 0;
+        }
+        stream.close();
+    }
+
+    FSStream existing(archive, path, FS_OPEN_READ);
+    if (existing.good())
+    {
+        // the crash came before the old copy was deleted, which is still whole
+        existing.close();
+        return fs().deleteFile(archive, temp);
+    }
+    // replaceFile() only deletes path once the new copy is written and closed
+    return fs().renameFile(archive, temp, path);
+}
+
+Result io::writeFile(FS_Archive archive, const std::u16string& path, const void* data, u32 size)
+{
+    {
+        FSStream existing(archive, path, FS_OPEN_READ);
+        bool resize = existing.good() && existing.size() != size;
+        if (existing.good())
+        {
+            existing.close();
+        }
+        if (resize)
+        {
+            Result res = fs().deleteFile(archive, path);
+            if (R_FAILED(res))
+            {
+                return res;
+            }
+        }
+    }
+
+    FSStream stream(archive, path, FS_OPEN_WRITE, size);
+    if (!stream.good())
+    {
+        return stream.result();
+    }
+    u32 written = stream.write(data, size);
+    Result res = stream.result();
+    Result closed = stream.close();
+    if (written != size)
+    {
+        return R_FAILED(res) ? res : -1;
+    }
+    return closed;
 }
\ No newline at end of file
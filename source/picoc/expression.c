@@ -1073,6 +1073,465 @@ void ExpressionGetStructElement(struct ParseState *Parser, struct ExpressionStac
     }
 }
 
+#ifndef NO_EXPRESSION_CACHE
+/* positions are byte addresses in the token stream, so mix the low bits with the next ones up */
+#define EXPRESSION_CACHE_SLOT(Pos) (((((unsigned long)(Pos)) >> 7) ^ ((unsigned long)(Pos))) & (EXPRESSION_CACHE_SIZE-1))
+
+/* an operator waiting on the compiler's stack */
+struct PendingOperator
+{
+    enum LexToken Op;
+    enum CompiledStepKind Kind;
+    int Precedence;
+    short int Line;
+    short int CharacterPos;
+};
+
+/* the compiler's picture of the expression stack: how deep it is and which entries are plain variables */
+struct CompileState
+{
+    struct CompiledExpression *Compiled;
+    struct PendingOperator Pending[EXPRESSION_CACHE_STEPS];
+    int NumPending;
+    char IsVariable[EXPRESSION_CACHE_STEPS];
+    int Depth;
+};
+
+/* a value on the compiled expression's stack. Var is set while it's still an lvalue */
+struct CompiledOperand
+{
+    struct Value *Var;
+    long Int;
+};
+
+/* forget every compiled expression. called whenever tokens they could point into are freed */
+void ExpressionCacheClear(Picoc *pc)
+{
+    int Count;
+    
+    for (Count = 0; Count < EXPRESSION_CACHE_SIZE; Count++)
+        pc->ExpressionCache[Count].Pos = NULL;
+}
+
+/* add a step to the compiled expression, checking it has the operands it needs */
+static int ExpressionCompileStep(struct CompileState *State, enum CompiledStepKind Kind, enum LexToken Op, int Line, int CharacterPos)
+{
+    struct CompiledStep *Step;
+    
+    if (State->Compiled->NumSteps >= EXPRESSION_CACHE_STEPS)
+        return FALSE;
+    
+    switch (Kind)
+    {
+        case StepConstant:
+        case StepVariable:
+            State->IsVariable[State->Depth++] = (Kind == StepVariable);
+            break;
+        
+        case StepPrefix:
+        case StepPostfix:
+            if (State->Depth < 1 || ((Op == TokenIncrement || Op == TokenDecrement) && !State->IsVariable[State->Depth-1]))
+                return FALSE;
+            
+            State->IsVariable[State->Depth-1] = FALSE;
+            break;
+        
+        case StepInfix:
+            if (State->Depth < 2 || (Op >= TokenAssign && Op <= TokenArithmeticExorAssign && !State->IsVariable[State->Depth-2]))
+                return FALSE;
+            
+            State->IsVariable[--State->Depth - 1] = FALSE;
+            break;
+    }
+    
+    Step = &State->Compiled->Step[State->Compiled->NumSteps++];
+    Step->Kind = Kind;
+    Step->Op = Op;
+    Step->Line = Line;
+    Step->CharacterPos = CharacterPos;
+    return TRUE;
+}
+
+/* the compiler's ExpressionStackCollapse(): emit every waiting operator of at least this precedence */
+static int ExpressionCompileCollapse(struct CompileState *State, int Precedence)
+{
+    while (State->NumPending > 0 && State->Pending[State->NumPending-1].Precedence >= Precedence)
+    {
+        struct PendingOperator *Top = &State->Pending[--State->NumPending];
+        
+        if (!ExpressionCompileStep(State, Top->Kind, Top->Op, Top->Line, Top->CharacterPos))
+            return FALSE;
+    }
+    
+    return TRUE;
+}
+
+/* the compiler's ExpressionStackPushOperator() */
+static int ExpressionCompilePush(struct CompileState *State, enum CompiledStepKind Kind, enum LexToken Op, int Precedence, int Line, int CharacterPos)
+{
+    if (State->NumPending >= EXPRESSION_CACHE_STEPS)
+        return FALSE;
+    
+    State->Pending[State->NumPending].Kind = Kind;
+    State->Pending[State->NumPending].Op = Op;
+    State->Pending[State->NumPending].Precedence = Precedence;
+    State->Pending[State->NumPending].Line = Line;
+    State->Pending[State->NumPending].CharacterPos = CharacterPos;
+    State->NumPending++;
+    return TRUE;
+}
+
+/* lower the expression at Parser to postfix steps if it only uses integer constants, variables and arithmetic,
+ * comparison, logical and assignment operators. this follows ExpressionParse() token for token so the steps
+ * run in the same order its stack would have. anything else, including function calls, casts, pointers,
+ * arrays, structs, strings, floating point, the ternary operator and preprocessor lines, leaves NumSteps at 0 */
+static void ExpressionCompile(struct ParseState *Parser, struct CompiledExpression *Compiled)
+{
+    struct ParseState Lexer;
+    struct ParseState PreState;
+    struct Value *LexValue;
+    struct CompileState State;
+    enum LexToken Token;
+    int PrefixState = TRUE;
+    int BracketPrecedence = 0;
+    int Precedence;
+    int Ended = FALSE;
+    
+    Compiled->Pos = Parser->Pos;
+    Compiled->NumSteps = 0;
+    State.Compiled = Compiled;
+    State.NumPending = 0;
+    State.Depth = 0;
+    ParserCopy(&Lexer, Parser);
+    
+    for (;;)
+    {
+        ParserCopy(&PreState, &Lexer);
+        Token = LexGetToken(&Lexer, &LexValue, TRUE);
+        if (Lexer.HashIfLevel != Parser->HashIfLevel || Lexer.HashIfEvaluateToLevel != Parser->HashIfEvaluateToLevel)
+            break;
+        
+        if ( ( ((int)Token > TokenComma && (int)Token <= (int)TokenOpenBracket) || 
+               (Token == TokenCloseBracket && BracketPrecedence != 0)) && 
+               Token != TokenColon )
+        {
+            if (PrefixState)
+            {
+                enum LexToken NextToken;
+                int TempPrecedenceBoost;
+                
+                if (Token == TokenOpenBracket)
+                {
+                    /* a cast isn't compiled */
+                    enum LexToken BracketToken = LexGetToken(&Lexer, &LexValue, FALSE);
+                    if (IsTypeToken(&Lexer, BracketToken, LexValue))
+                        break;
+                    
+                    BracketPrecedence += BRACKET_PRECEDENCE;
+                    continue;
+                }
+                
+                if (Token != TokenPlus && Token != TokenMinus && Token != TokenIncrement && Token != TokenDecrement && Token != TokenUnaryNot && Token != TokenUnaryExor)
+                    break;
+                
+                /* the same boost ExpressionParse() gives the outer of two prefix operators */
+                Precedence = BracketPrecedence + OperatorPrecedence[(int)Token].PrefixPrecedence;
+                NextToken = LexGetToken(&Lexer, NULL, FALSE);
+                if (NextToken > TokenComma && NextToken < TokenOpenBracket && OperatorPrecedence[(int)Token].PrefixPrecedence == OperatorPrecedence[(int)NextToken].PrefixPrecedence)
+                    TempPrecedenceBoost = -1;
+                else
+                    TempPrecedenceBoost = 0;
+                
+                /* nothing in prefix position has a value to collapse onto yet */
+                if ((State.NumPending > 0 && State.Pending[State.NumPending-1].Precedence >= Precedence) ||
+                    !ExpressionCompilePush(&State, StepPrefix, Token, Precedence + TempPrecedenceBoost, PreState.Line, PreState.CharacterPos))
+                    break;
+            }
+            else if (Token == TokenCloseBracket)
+            {
+                if (!ExpressionCompileCollapse(&State, BracketPrecedence))
+                    break;
+                
+                BracketPrecedence -= BRACKET_PRECEDENCE;
+            }
+            else if (Token == TokenRightSquareBracket && BracketPrecedence == 0)
+            {
+                /* the end of an array index we're inside */
+                ParserCopy(&Lexer, &PreState);
+                Ended = TRUE;
+                break;
+            }
+            else if (Token == TokenIncrement || Token == TokenDecrement)
+            {
+                Precedence = BracketPrecedence + OperatorPrecedence[(int)Token].PostfixPrecedence;
+                if (!ExpressionCompileCollapse(&State, Precedence) || !ExpressionCompilePush(&State, StepPostfix, Token, Precedence, PreState.Line, PreState.CharacterPos))
+                    break;
+            }
+            else if ((Token >= TokenAssign && Token <= TokenArithmeticExorAssign) || (Token >= TokenLogicalOr && Token <= TokenModulus))
+            {
+                Precedence = BracketPrecedence + OperatorPrecedence[(int)Token].InfixPrecedence;
+                if (!ExpressionCompileCollapse(&State, IS_LEFT_TO_RIGHT(OperatorPrecedence[(int)Token].InfixPrecedence) ? Precedence : Precedence+1) ||
+                    !ExpressionCompilePush(&State, StepInfix, Token, Precedence, PreState.Line, PreState.CharacterPos))
+                    break;
+                
+                PrefixState = TRUE;
+            }
+            else
+                break;
+        }
+        else if (Token == TokenIdentifier)
+        {
+            /* function calls aren't compiled */
+            if (!PrefixState || LexGetToken(&Lexer, NULL, FALSE) == TokenOpenBracket || !ExpressionCompileStep(&State, StepVariable, TokenNone, Lexer.Line, Lexer.CharacterPos))
+                break;
+            
+            Compiled->Step[Compiled->NumSteps-1].Arg.Ident = LexValue->Val->Identifier;
+            PrefixState = FALSE;
+        }
+        else if (Token == TokenIntegerConstant || Token == TokenCharacterConstant)
+        {
+            if (!PrefixState || !ExpressionCompileStep(&State, StepConstant, TokenNone, Lexer.Line, Lexer.CharacterPos))
+                break;
+            
+            Compiled->Step[Compiled->NumSteps-1].Arg.Int = ExpressionCoerceInteger(LexValue);
+            PrefixState = FALSE;
+        }
+        else if (((int)Token > TokenCloseBracket && (int)Token <= TokenCharacterConstant) || IsTypeToken(&Lexer, Token, LexValue))
+            break;
+        
+        else
+        {
+            /* it isn't a token from an expression */
+            ParserCopy(&Lexer, &PreState);
+            Ended = TRUE;
+            break;
+        }
+    }
+    
+    /* a lone value keeps its own type and lvalue-ness, so it's left to the interpreter */
+    if (Ended && BracketPrecedence == 0 && ExpressionCompileCollapse(&State, 0) && 
+            State.Depth == 1 && Compiled->NumSteps > 1)
+    {
+        Compiled->EndPos = Lexer.Pos;
+        Compiled->EndLine = Lexer.Line;
+        Compiled->EndCharacterPos = Lexer.CharacterPos;
+    }
+    else
+        Compiled->NumSteps = 0;
+}
+
+/* the integer value of an operand */
+static long ExpressionCompiledInt(struct CompiledOperand *Operand)
+{
+    return (Operand->Var != NULL) ? ExpressionCoerceInteger(Operand->Var) : Operand->Int;
+}
+
+/* the variable an operand is assigned through */
+static struct Value *ExpressionCompiledLValue(struct ParseState *Parser, struct CompiledStep *Step, struct CompiledOperand *Operand)
+{
+    if (Operand->Var == NULL)
+    {
+        Parser->Line = Step->Line;
+        Parser->CharacterPos = Step->CharacterPos;
+        ProgramFail(Parser, "can't assign to this");
+    }
+    
+    return Operand->Var;
+}
+
+/* look up a variable step's operand. FALSE if it isn't an integer variable or a macro that's a single integer constant */
+static int ExpressionResolveCompiled(struct ParseState *Parser, struct CompiledStep *Step, struct CompiledOperand *Operand)
+{
+    struct Value *VariableValue;
+    
+    /* so an undefined name is reported where it is */
+    Parser->Line = Step->Line;
+    Parser->CharacterPos = Step->CharacterPos;
+    VariableGet(Parser->pc, Parser, Step->Arg.Ident, &VariableValue);
+    if (VariableValue->Typ->Base == TypeMacro)
+    {
+        struct ParseState MacroParser;
+        struct Value *MacroValue;
+        enum LexToken Token;
+        
+        if (VariableValue->Val->MacroDef.NumParams != 0)
+            return FALSE;
+        
+        ParserCopy(&MacroParser, &VariableValue->Val->MacroDef.Body);
+        Token = LexGetToken(&MacroParser, &MacroValue, TRUE);
+        if (Token != TokenIntegerConstant && Token != TokenCharacterConstant)
+            return FALSE;
+        
+        Operand->Var = NULL;
+        Operand->Int = ExpressionCoerceInteger(MacroValue);
+        return LexGetToken(&MacroParser, NULL, FALSE) == TokenEndOfFunction;
+    }
+    
+    Operand->Var = VariableValue;
+    return IS_INTEGER_NUMERIC(VariableValue);
+}
+
+/* run a compiled expression, leaving its int result on the stack like ExpressionParse() does. returns NULL
+ * without doing anything if a variable isn't an integer any more, so the caller can interpret it instead */
+static struct Value *ExpressionRunCompiled(struct ParseState *Parser, struct CompiledExpression *Compiled)
+{
+    struct CompiledOperand Resolved[EXPRESSION_CACHE_STEPS];
+    struct CompiledOperand Stack[EXPRESSION_CACHE_STEPS];
+    struct CompiledOperand *Top;
+    struct CompiledOperand *Bottom;
+    struct Value *Result;
+    short int Line = Parser->Line;
+    short int CharacterPos = Parser->CharacterPos;
+    int Depth = 0;
+    int Count;
+    
+    /* look everything up first so nothing has been assigned if we have to give up */
+    for (Count = 0; Count < Compiled->NumSteps; Count++)
+    {
+        if (Compiled->Step[Count].Kind == StepVariable && !ExpressionResolveCompiled(Parser, &Compiled->Step[Count], &Resolved[Count]))
+        {
+            Parser->Line = Line;
+            Parser->CharacterPos = CharacterPos;
+            return NULL;
+        }
+    }
+    
+    for (Count = 0; Count < Compiled->NumSteps; Count++)
+    {
+        struct CompiledStep *Step = &Compiled->Step[Count];
+        long ResultInt = 0;
+        
+        switch (Step->Kind)
+        {
+            case StepConstant:
+                Stack[Depth].Var = NULL;
+                Stack[Depth++].Int = Step->Arg.Int;
+                continue;
+            
+            case StepVariable:
+                Stack[Depth++] = Resolved[Count];
+                continue;
+            
+            case StepPrefix:
+            {
+                long TopInt;
+                
+                Top = &Stack[Depth-1];
+                TopInt = ExpressionCompiledInt(Top);
+                switch (Step->Op)
+                {
+                    case TokenPlus:         ResultInt = TopInt; break;
+                    case TokenMinus:        ResultInt = -TopInt; break;
+                    case TokenIncrement:    ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Top), TopInt+1, FALSE); break;
+                    case TokenDecrement:    ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Top), TopInt-1, FALSE); break;
+                    case TokenUnaryNot:     ResultInt = !TopInt; break;
+                    case TokenUnaryExor:    ResultInt = ~TopInt; break;
+                    default:                ProgramFail(Parser, "invalid operation"); break;
+                }
+                break;
+            }
+            
+            case StepPostfix:
+            {
+                long TopInt;
+                
+                Top = &Stack[Depth-1];
+                TopInt = ExpressionCompiledInt(Top);
+                switch (Step->Op)
+                {
+                    case TokenIncrement:    ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Top), TopInt+1, TRUE); break;
+                    case TokenDecrement:    ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Top), TopInt-1, TRUE); break;
+                    default:                ProgramFail(Parser, "invalid operation"); break;
+                }
+                break;
+            }
+            
+            default:
+            {
+                /* both sides are always evaluated, as in ExpressionParse() where && and || only skip function calls */
+                long TopInt;
+                long BottomInt;
+                
+                Top = &Stack[--Depth];
+                Bottom = &Stack[Depth-1];
+                TopInt = ExpressionCompiledInt(Top);
+                BottomInt = ExpressionCompiledInt(Bottom);
+                switch (Step->Op)
+                {
+                    case TokenAssign:               ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), TopInt, FALSE); break;
+                    case TokenAddAssign:            ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt + TopInt, FALSE); break;
+                    case TokenSubtractAssign:       ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt - TopInt, FALSE); break;
+                    case TokenMultiplyAssign:       ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt * TopInt, FALSE); break;
+                    case TokenDivideAssign:         ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt / TopInt, FALSE); break;
+#ifndef NO_MODULUS
+                    case TokenModulusAssign:        ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt % TopInt, FALSE); break;
+#endif
+                    case TokenShiftLeftAssign:      ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt << TopInt, FALSE); break;
+                    case TokenShiftRightAssign:     ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt >> TopInt, FALSE); break;
+                    case TokenArithmeticAndAssign:  ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt & TopInt, FALSE); break;
+                    case TokenArithmeticOrAssign:   ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt | TopInt, FALSE); break;
+                    case TokenArithmeticExorAssign: ResultInt = ExpressionAssignInt(Parser, ExpressionCompiledLValue(Parser, Step, Bottom), BottomInt ^ TopInt, FALSE); break;
+                    case TokenLogicalOr:            ResultInt = BottomInt || TopInt; break;
+                    case TokenLogicalAnd:           ResultInt = BottomInt && TopInt; break;
+                    case TokenArithmeticOr:         ResultInt = BottomInt | TopInt; break;
+                    case TokenArithmeticExor:       ResultInt = BottomInt ^ TopInt; break;
+                    case TokenAmpersand:            ResultInt = BottomInt & TopInt; break;
+                    case TokenEqual:                ResultInt = BottomInt == TopInt; break;
+                    case TokenNotEqual:             ResultInt = BottomInt != TopInt; break;
+                    case TokenLessThan:             ResultInt = BottomInt < TopInt; break;
+                    case TokenGreaterThan:          ResultInt = BottomInt > TopInt; break;
+                    case TokenLessEqual:            ResultInt = BottomInt <= TopInt; break;
+                    case TokenGreaterEqual:         ResultInt = BottomInt >= TopInt; break;
+                    case TokenShiftLeft:            ResultInt = BottomInt << TopInt; break;
+                    case TokenShiftRight:           ResultInt = BottomInt >> TopInt; break;
+                    case TokenPlus:                 ResultInt = BottomInt + TopInt; break;
+                    case TokenMinus:                ResultInt = BottomInt - TopInt; break;
+                    case TokenAsterisk:             ResultInt = BottomInt * TopInt; break;
+                    case TokenSlash:                ResultInt = BottomInt / TopInt; break;
+#ifndef NO_MODULUS
+                    case TokenModulus:              ResultInt = BottomInt % TopInt; break;
+#endif
+                    default:                        ProgramFail(Parser, "invalid operation"); break;
+                }
+                Top = Bottom;
+                break;
+            }
+        }
+        
+        /* every operator result is an int value, as from ExpressionPushInt() */
+        Top->Var = NULL;
+        Top->Int = (int)ResultInt;
+    }
+    
+    Result = VariableAllocValueFromType(Parser->pc, Parser, &Parser->pc->IntType, FALSE, NULL, FALSE);
+    Result->Val->Integer = Stack[0].Int;
+    return Result;
+}
+
+/* the compiled form of the expression at Parser, compiling it if this is the first time it's run. NULL if it
+ * can't be compiled or its slot belongs to another expression */
+static struct CompiledExpression *ExpressionCacheGet(struct ParseState *Parser)
+{
+    Picoc *pc = Parser->pc;
+    struct CompiledExpression *Compiled = &pc->ExpressionCache[EXPRESSION_CACHE_SLOT(Parser->Pos)];
+    
+    if (pc->ExpressionCacheOff || pc->InteractiveHead != NULL || Parser->Pos == NULL)
+        return NULL;
+    
+    if (Compiled->Pos == NULL && Parser->Mode == RunModeRun)
+        ExpressionCompile(Parser, Compiled);
+    
+    if (Compiled->Pos != Parser->Pos || Compiled->NumSteps == 0)
+        return NULL;
+    
+    return Compiled;
+}
+#else
+void ExpressionCacheClear(Picoc *pc)
+{
+}
+#endif
+
 /* parse an expression with operator precedence */
 int ExpressionParse(struct ParseState *Parser, struct Value **Result)
 {
@@ -1085,6 +1544,23 @@ int ExpressionParse(struct ParseState *Parser, struct Value **Result)
     int IgnorePrecedence = DEEP_PRECEDENCE;
     struct ExpressionStack *StackTop = NULL;
     int TernaryDepth = 0;
+#ifndef NO_EXPRESSION_CACHE
+    struct CompiledExpression *Compiled = ExpressionCacheGet(Parser);
+    
+    if (Compiled != NULL)
+    {
+        /* a compiled expression has no function calls, so there's nothing to do but step over it unless we're running */
+        if (Parser->Mode != RunModeRun || (*Result = ExpressionRunCompiled(Parser, Compiled)) != NULL)
+        {
+            Parser->Pos = Compiled->EndPos;
+            Parser->Line = Compiled->EndLine;
+            Parser->CharacterPos = Compiled->EndCharacterPos;
+            Parser->pc->ExpressionCacheHits++;
+            return TRUE;
+        }
+    }
+    Parser->pc->ExpressionCacheMisses++;
+#endif
     
     debugf("ExpressionParse():\n");
     do
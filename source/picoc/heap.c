@@ -18,8 +18,84 @@ void ShowBigList(Picoc *pc)
 }
 #endif
 
-/* initialise the stack and heap storage */
-void HeapInit(Picoc *pc, int StackOrHeapSize)
+#ifdef USE_MALLOC_HEAP
+/* allocate from the arena. each script run bumps through blocks of ArenaSize
+ * bytes and only gives them back at cleanup, so values cost no malloc() each */
+static void *HeapArenaAlloc(Picoc *pc, int Size)
+{
+    struct ArenaBlock *Block = pc->Arena;
+    int AllocSize = MEM_ALIGN(Size);
+    void *ReturnMem;
+    
+    if (Block == NULL || Block->End - Block->Top < AllocSize)
+    {
+        /* start a new block. big allocations get a block of their own size */
+        int BlockSize = pc->ArenaSize;
+        if (BlockSize < AllocSize)
+            BlockSize = AllocSize;
+            
+        Block = malloc(MEM_ALIGN(sizeof(struct ArenaBlock)) + BlockSize);
+        if (Block == NULL)
+            return NULL;
+            
+        Block->Prev = pc->Arena;
+        Block->Top = (char *)Block + MEM_ALIGN(sizeof(struct ArenaBlock));
+        Block->End = Block->Top + BlockSize;
+        pc->Arena = Block;
+        pc->ArenaBlocks++;
+    }
+    
+    ReturnMem = Block->Top;
+    Block->Top += AllocSize;
+    pc->ArenaLast = ReturnMem;
+    pc->ArenaLastSize = AllocSize;
+    pc->ArenaInUse += AllocSize;
+    if (pc->ArenaInUse > pc->ArenaHighWater)
+        pc->ArenaHighWater = pc->ArenaInUse;
+        
+    memset(ReturnMem, '\0', AllocSize);
+#ifdef DEBUG_HEAP
+    printf("HeapArenaAlloc(%d) = %lx\n", AllocSize, (unsigned long)ReturnMem);
+#endif
+    return ReturnMem;
+}
+
+/* free arena memory. only the latest allocation can be given back, the rest
+ * waits for the arena to be reset */
+static void HeapArenaFree(Picoc *pc, void *Mem)
+{
+    if (Mem != NULL && Mem == pc->ArenaLast)
+    {
+        pc->Arena->Top -= pc->ArenaLastSize;
+        pc->ArenaInUse -= pc->ArenaLastSize;
+        pc->ArenaLast = NULL;
+    }
+}
+
+/* give all the arena blocks back */
+static void HeapArenaReset(Picoc *pc)
+{
+    struct ArenaBlock *Block;
+    
+#ifdef DEBUG_HEAP
+    printf("Arena: %ld bytes high water in %d blocks\n", pc->ArenaHighWater, pc->ArenaBlocks);
+#endif
+    while (pc->Arena != NULL)
+    {
+        Block = pc->Arena;
+        pc->Arena = Block->Prev;
+        free(Block);
+    }
+    
+    pc->ArenaLast = NULL;
+    pc->ArenaInUse = 0;
+    pc->ArenaBlocks = 0;
+}
+#endif
+
+/* initialise the stack and heap storage. ArenaSize only applies when the heap
+ * comes from malloc() - the fixed heap already lives in one region */
+void HeapInit(Picoc *pc, int StackOrHeapSize, int ArenaSize)
 {
     int Count;
     int AlignOffset = 0;
@@ -53,10 +129,22 @@ void HeapInit(Picoc *pc, int StackOrHeapSize)
     pc->FreeListBig = NULL;
     for (Count = 0; Count < FREELIST_BUCKETS; Count++)
         pc->FreeListBucket[Count] = NULL;
+        
+#ifdef USE_MALLOC_HEAP
+    pc->ArenaSize = ArenaSize > 0 ? MEM_ALIGN(ArenaSize) : 0;
+    pc->Arena = NULL;
+    pc->ArenaLast = NULL;
+    pc->ArenaInUse = 0;
+    pc->ArenaHighWater = 0;
+    pc->ArenaBlocks = 0;
+#endif
 }
 
 void HeapCleanup(Picoc *pc)
 {
+#ifdef USE_MALLOC_HEAP
+    HeapArenaReset(pc);
+#endif
 #ifdef USE_MALLOC_STACK
     free(pc->HeapMemory);
 #endif
@@ -135,6 +223,9 @@ int HeapPopStackFrame(Picoc *pc)
 void *HeapAllocMem(Picoc *pc, int Size)
 {
 #ifdef USE_MALLOC_HEAP
+    if (pc->ArenaSize > 0)
+        return Size > 0 ? HeapArenaAlloc(pc, Size) : NULL;
+        
     return calloc(Size, 1);
 #else
     struct AllocNode *NewMem = NULL;
@@ -226,7 +317,10 @@ void *HeapAllocMem(Picoc *pc, int Size)
 void HeapFreeMem(Picoc *pc, void *Mem)
 {
 #ifdef USE_MALLOC_HEAP
-    free(Mem);
+    if (pc->ArenaSize > 0)
+        HeapArenaFree(pc, Mem);
+    else
+        free(Mem);
 #else
     struct AllocNode *MemNode = (struct AllocNode *)((char *)Mem - MEM_ALIGN(sizeof(MemNode->Size)));
     int Bucket = MemNode->Size >> 2;
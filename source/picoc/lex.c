@@ -113,6 +113,8 @@ void LexCleanup(Picoc *pc)
 
     for (Count = 0; Count < (int) (sizeof(ReservedWords) / sizeof(struct ReservedWord)); Count++)
         TableDelete(pc, &pc->ReservedWordTable, TableStrRegister(pc, ReservedWords[Count].Word));
+        
+    TableFreeBuckets(pc, &pc->ReservedWordTable);
 }
 
 /* check if a word is a reserved word - used while scanning */
@@ -17,6 +17,7 @@ void ParseCleanup(Picoc *pc)
         HeapFreeMem(pc, pc->CleanupTokenList);
         pc->CleanupTokenList = Next;
     }
+    ExpressionCacheClear(pc);
 }
 
 /* parse a statement, but only run it if Condition is TRUE */
@@ -971,7 +972,10 @@ void PicocParse(Picoc *pc, const char *FileName, const char *Source, int SourceL
     
     /* clean up */
     if (CleanupNow)
+    {
         HeapFreeMem(pc, Tokens);
+        ExpressionCacheClear(pc);
+    }
 }
 
 /* parse interactively */
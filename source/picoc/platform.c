@@ -7,11 +7,19 @@
 
 /* initialise everything */
 void PicocInitialise(Picoc *pc, int StackSize)
+{
+    PicocInitialiseArena(pc, StackSize, 0);
+}
+
+/* initialise everything, taking the heap from an arena of ArenaSize byte blocks
+ * which is dropped in one go by PicocCleanup(). an ArenaSize of 0 uses the
+ * normal heap */
+void PicocInitialiseArena(Picoc *pc, int StackSize, int ArenaSize)
 {
     memset(pc, '\0', sizeof(*pc));
     PlatformInit(pc);
     BasicIOInit(pc);
-    HeapInit(pc, StackSize);
+    HeapInit(pc, StackSize, ArenaSize);
     TableInit(pc);
     VariableInit(pc);
     LexInit(pc);
@@ -31,6 +39,20 @@ void PicocInitialise(Picoc *pc, int StackSize)
 /* free memory */
 void PicocCleanup(Picoc *pc)
 {
+#ifdef DEBUG_TABLES
+    TableStats(pc, "strings", &pc->StringTable);
+    TableStats(pc, "globals", &pc->GlobalTable);
+    TableStats(pc, "string literals", &pc->StringLiteralTable);
+#endif
+#ifdef USE_MALLOC_HEAP
+    if (pc->ArenaSize > 0)
+    {
+        /* everything on the heap goes with the arena, so don't free it piece by piece */
+        HeapCleanup(pc);
+        PlatformCleanup(pc);
+        return;
+    }
+#endif
     DebugCleanup(pc);
 #ifndef NO_HASH_INCLUDE
     IncludeCleanup(pc);
@@ -0,0 +1,422 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "scripting.hpp"
+#include "PGF.hpp"
+#include "PGT.hpp"
+#include "WC6.hpp"
+#include "WC7.hpp"
+extern "C" {
+#include "picoc.h"
+#include "interpreter.h"
+}
+
+// Native half of pksm.h. Bulk operations run here in a single call, so scripts don't
+// walk boxes field by field through the interpreter.
+
+enum Field
+{
+    FIELD_SPECIES,
+    FIELD_HELD_ITEM,
+    FIELD_TID,
+    FIELD_SID,
+    FIELD_PID,
+    FIELD_LEVEL,
+    FIELD_NATURE,
+    FIELD_ABILITY,
+    FIELD_GENDER,
+    FIELD_FORM,
+    FIELD_BALL,
+    FIELD_SHINY,
+    FIELD_EGG,
+    FIELD_LANGUAGE,
+    FIELD_OT_FRIENDSHIP,
+    FIELD_MET_LEVEL,
+    FIELD_FATEFUL,
+    FIELD_MOVE1,
+    FIELD_MOVE2,
+    FIELD_MOVE3,
+    FIELD_MOVE4,
+    FIELD_IV_HP,
+    FIELD_IV_ATK,
+    FIELD_IV_DEF,
+    FIELD_IV_SPE,
+    FIELD_IV_SPA,
+    FIELD_IV_SPD,
+    FIELD_EV_HP,
+    FIELD_EV_ATK,
+    FIELD_EV_DEF,
+    FIELD_EV_SPE,
+    FIELD_EV_SPA,
+    FIELD_EV_SPD,
+    FIELD_COUNT
+};
+
+static const char* PKSM_DEFS =
+    "#define BOX_SLOTS 30\n"
+    "#define FIELD_SPECIES 0\n"
+    "#define FIELD_HELD_ITEM 1\n"
+    "#define FIELD_TID 2\n"
+    "#define FIELD_SID 3\n"
+    "#define FIELD_PID 4\n"
+    "#define FIELD_LEVEL 5\n"
+    "#define FIELD_NATURE 6\n"
+    "#define FIELD_ABILITY 7\n"
+    "#define FIELD_GENDER 8\n"
+    "#define FIELD_FORM 9\n"
+    "#define FIELD_BALL 10\n"
+    "#define FIELD_SHINY 11\n"
+    "#define FIELD_EGG 12\n"
+    "#define FIELD_LANGUAGE 13\n"
+    "#define FIELD_OT_FRIENDSHIP 14\n"
+    "#define FIELD_MET_LEVEL 15\n"
+    "#define FIELD_FATEFUL 16\n"
+    "#define FIELD_MOVE1 17\n"
+    "#define FIELD_MOVE2 18\n"
+    "#define FIELD_MOVE3 19\n"
+    "#define FIELD_MOVE4 20\n"
+    "#define FIELD_IV_HP 21\n"
+    "#define FIELD_IV_ATK 22\n"
+    "#define FIELD_IV_DEF 23\n"
+    "#define FIELD_IV_SPE 24\n"
+    "#define FIELD_IV_SPA 25\n"
+    "#define FIELD_IV_SPD 26\n"
+    "#define FIELD_EV_HP 27\n"
+    "#define FIELD_EV_ATK 28\n"
+    "#define FIELD_EV_DEF 29\n"
+    "#define FIELD_EV_SPE 30\n"
+    "#define FIELD_EV_SPA 31\n"
+    "#define FIELD_EV_SPD 32\n";
+
+static const int BOX_SLOTS = 30;
+
+class PksmLibrary
+{
+public:
+    static u8* slot(int box, int slot)
+    {
+        return Scripting::current()->data + Scripting::current()->boxOffset(box, slot);
+    }
+
+    static u8 length(void)
+    {
+        return Scripting::current()->generation() < 6 ? 136 : 232;
+    }
+
+    static int get(const PKX& pk, int field)
+    {
+        switch (field)
+        {
+            case FIELD_SPECIES:         return pk.species();
+            case FIELD_HELD_ITEM:       return pk.heldItem();
+            case FIELD_TID:             return pk.TID();
+            case FIELD_SID:             return pk.SID();
+            case FIELD_PID:             return pk.PID();
+            case FIELD_LEVEL:           return pk.level();
+            case FIELD_NATURE:          return pk.nature();
+            case FIELD_ABILITY:         return pk.ability();
+            case FIELD_GENDER:          return pk.gender();
+            case FIELD_FORM:            return pk.alternativeForm();
+            case FIELD_BALL:            return pk.ball();
+            case FIELD_SHINY:           return pk.shiny();
+            case FIELD_EGG:             return pk.egg();
+            case FIELD_LANGUAGE:        return pk.language();
+            case FIELD_OT_FRIENDSHIP:   return pk.otFriendship();
+            case FIELD_MET_LEVEL:       return pk.metLevel();
+            case FIELD_FATEFUL:         return pk.fatefulEncounter();
+            case FIELD_MOVE1:
+            case FIELD_MOVE2:
+            case FIELD_MOVE3:
+            case FIELD_MOVE4:           return pk.move(field - FIELD_MOVE1);
+            case FIELD_IV_HP:
+            case FIELD_IV_ATK:
+            case FIELD_IV_DEF:
+            case FIELD_IV_SPE:
+            case FIELD_IV_SPA:
+            case FIELD_IV_SPD:          return pk.iv(field - FIELD_IV_HP);
+            default:                    return pk.ev(field - FIELD_EV_HP);
+        }
+    }
+
+    static void set(PKX& pk, int field, int v)
+    {
+        switch (field)
+        {
+            case FIELD_SPECIES:         pk.species(v); break;
+            case FIELD_HELD_ITEM:       pk.heldItem(v); break;
+            case FIELD_TID:             pk.TID(v); break;
+            case FIELD_SID:             pk.SID(v); break;
+            case FIELD_PID:             pk.PID(v); break;
+            case FIELD_LEVEL:           pk.level(v); break;
+            case FIELD_NATURE:          pk.nature(v); break;
+            case FIELD_ABILITY:         pk.ability(v); break;
+            case FIELD_GENDER:          pk.gender(v); break;
+            case FIELD_FORM:            pk.alternativeForm(v); break;
+            case FIELD_BALL:            pk.ball(v); break;
+            case FIELD_SHINY:           pk.shiny(v); break;
+            case FIELD_EGG:             pk.egg(v); break;
+            case FIELD_LANGUAGE:        pk.language(v); break;
+            case FIELD_OT_FRIENDSHIP:   pk.otFriendship(v); break;
+            case FIELD_MET_LEVEL:       pk.metLevel(v); break;
+            case FIELD_FATEFUL:         pk.fatefulEncounter(v); break;
+            case FIELD_MOVE1:
+            case FIELD_MOVE2:
+            case FIELD_MOVE3:
+            case FIELD_MOVE4:           pk.move(field - FIELD_MOVE1, v); break;
+            case FIELD_IV_HP:
+            case FIELD_IV_ATK:
+            case FIELD_IV_DEF:
+            case FIELD_IV_SPE:
+            case FIELD_IV_SPA:
+            case FIELD_IV_SPD:          pk.iv(field - FIELD_IV_HP, v); break;
+            default:                    pk.ev(field - FIELD_EV_HP, v); break;
+        }
+        pk.refreshChecksum();
+    }
+
+    // sets field on count slots starting at box/slot
+    static void setRange(int box, int slot, int count, int field, int v)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int b = box + (slot + i) / BOX_SLOTS;
+            int s = (slot + i) % BOX_SLOTS;
+            std::unique_ptr<PKX> pk = Scripting::current()->pkm(b, s);
+            set(*pk, field, v);
+            Scripting::current()->pkm(*pk, b, s);
+        }
+    }
+
+    static u16 giftLength(void)
+    {
+        switch (Scripting::current()->generation())
+        {
+            case 4: return PGT::length;
+            case 5: return PGF::length;
+            case 6: return WC6::length;
+            default: return WC7::length;
+        }
+    }
+
+    static std::unique_ptr<WCX> gift(u8* data)
+    {
+        switch (Scripting::current()->generation())
+        {
+            case 4: return std::unique_ptr<WCX>(new PGT(data));
+            case 5: return std::unique_ptr<WCX>(new PGF(data));
+            case 6: return std::unique_ptr<WCX>(new WC6(data));
+            case 7: return std::unique_ptr<WCX>(new WC7(data));
+        }
+        return nullptr;
+    }
+};
+
+// Argument checks run before any C++ object exists, ProgramFail longjmps out of here
+static void checkSlot(struct ParseState* parser, int box, int slot)
+{
+    if (box < 0 || box >= Scripting::current()->boxes || slot < 0 || slot >= BOX_SLOTS)
+    {
+        ProgramFail(parser, "box %d slot %d is out of range", box, slot);
+    }
+}
+
+static void checkRange(struct ParseState* parser, int box, int slot, int count)
+{
+    checkSlot(parser, box, slot);
+    if (count < 0 || box * BOX_SLOTS + slot + count > Scripting::current()->boxes * BOX_SLOTS)
+    {
+        ProgramFail(parser, "%d slots from box %d slot %d run past the last box", count, box, slot);
+    }
+}
+
+static void checkPointer(struct ParseState* parser, void* pointer)
+{
+    if (pointer == NULL)
+    {
+        ProgramFail(parser, "NULL buffer passed");
+    }
+}
+
+// scripts pass the size of every buffer a call copies a whole record through
+static void checkBuffer(struct ParseState* parser, void* pointer, int length, int needed)
+{
+    checkPointer(parser, pointer);
+    if (length < needed)
+    {
+        ProgramFail(parser, "buffer of %d bytes is smaller than the %d bytes it needs", length, needed);
+    }
+}
+
+static void checkField(struct ParseState* parser, int field)
+{
+    if (field < 0 || field >= FIELD_COUNT)
+    {
+        ProgramFail(parser, "unknown field %d", field);
+    }
+}
+
+static void sav_generation(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    ret->Val->Integer = Scripting::current()->generation();
+}
+
+static void sav_boxes(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    ret->Val->Integer = Scripting::current()->boxes;
+}
+
+static void pkx_length(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    ret->Val->Integer = PksmLibrary::length();
+}
+
+static void slot_read(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, param[1]->Val->Integer);
+    checkBuffer(parser, param[2]->Val->Pointer, param[3]->Val->Integer, PksmLibrary::length());
+    u8* src = PksmLibrary::slot(param[0]->Val->Integer, param[1]->Val->Integer);
+    std::copy(src, src + PksmLibrary::length(), (u8*)param[2]->Val->Pointer);
+}
+
+static void slot_write(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, param[1]->Val->Integer);
+    checkBuffer(parser, param[2]->Val->Pointer, param[3]->Val->Integer, PksmLibrary::length());
+    const u8* src = (const u8*)param[2]->Val->Pointer;
+    std::copy(src, src + PksmLibrary::length(), PksmLibrary::slot(param[0]->Val->Integer, param[1]->Val->Integer));
+}
+
+static void slot_fill(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    int box = param[0]->Val->Integer;
+    int slot = param[1]->Val->Integer;
+    int count = param[2]->Val->Integer;
+    checkRange(parser, box, slot, count);
+    checkBuffer(parser, param[3]->Val->Pointer, param[4]->Val->Integer, PksmLibrary::length());
+    const u8* src = (const u8*)param[3]->Val->Pointer;
+    for (int i = 0; i < count; i++)
+    {
+        std::copy(src, src + PksmLibrary::length(), PksmLibrary::slot(box + (slot + i) / BOX_SLOTS, (slot + i) % BOX_SLOTS));
+    }
+}
+
+static void box_copy(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, 0);
+    checkSlot(parser, param[1]->Val->Integer, 0);
+    // slots of a box are contiguous in every generation
+    u8* src = PksmLibrary::slot(param[0]->Val->Integer, 0);
+    std::memmove(PksmLibrary::slot(param[1]->Val->Integer, 0), src, BOX_SLOTS * PksmLibrary::length());
+}
+
+static void pkx_get(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, param[1]->Val->Integer);
+    checkField(parser, param[2]->Val->Integer);
+    ret->Val->Integer = PksmLibrary::get(*Scripting::current()->pkm(param[0]->Val->Integer, param[1]->Val->Integer), param[2]->Val->Integer);
+}
+
+static void pkx_set(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, param[1]->Val->Integer);
+    checkField(parser, param[2]->Val->Integer);
+    PksmLibrary::setRange(param[0]->Val->Integer, param[1]->Val->Integer, 1, param[2]->Val->Integer, param[3]->Val->Integer);
+}
+
+static void box_set(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, 0);
+    checkField(parser, param[1]->Val->Integer);
+    PksmLibrary::setRange(param[0]->Val->Integer, 0, BOX_SLOTS, param[1]->Val->Integer, param[2]->Val->Integer);
+}
+
+static void all_set(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkField(parser, param[0]->Val->Integer);
+    PksmLibrary::setRange(0, 0, Scripting::current()->boxes * BOX_SLOTS, param[0]->Val->Integer, param[1]->Val->Integer);
+}
+
+static void box_crypt(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    Scripting::cryptBoxes(param[0]->Val->Integer);
+}
+
+static void dex_set(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkSlot(parser, param[0]->Val->Integer, param[1]->Val->Integer);
+    Scripting::current()->dex(*Scripting::current()->pkm(param[0]->Val->Integer, param[1]->Val->Integer));
+}
+
+static void gift_inject(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    checkBuffer(parser, param[0]->Val->Pointer, param[1]->Val->Integer, PksmLibrary::giftLength());
+    int pos = Scripting::current()->emptyGiftLocation();
+    if (pos < 0 || (size_t)pos >= Scripting::current()->maxWondercards())
+    {
+        ret->Val->Integer = -1;
+        return;
+    }
+    std::unique_ptr<WCX> wc = PksmLibrary::gift((u8*)param[0]->Val->Pointer);
+    if (wc)
+    {
+        Scripting::current()->mysteryGift(*wc, pos);
+    }
+    ret->Val->Integer = wc ? pos : -1;
+}
+
+static void sav_resign(struct ParseState* parser, struct Value* ret, struct Value** param, int args)
+{
+    // checksums cover the boxes as stored
+    bool decrypted = Scripting::boxesDecrypted();
+    Scripting::cryptBoxes(false);
+    Scripting::current()->resign();
+    Scripting::cryptBoxes(decrypted);
+}
+
+static struct LibraryFunction PksmFunctions[] =
+{
+    { sav_generation,   "int sav_generation();" },
+    { sav_boxes,        "int sav_boxes();" },
+    { pkx_length,       "int pkx_length();" },
+    { slot_read,        "void slot_read(int, int, char*, int);" },
+    { slot_write,       "void slot_write(int, int, char*, int);" },
+    { slot_fill,        "void slot_fill(int, int, int, char*, int);" },
+    { box_copy,         "void box_copy(int, int);" },
+    { pkx_get,          "int pkx_get(int, int, int);" },
+    { pkx_set,          "void pkx_set(int, int, int, int);" },
+    { box_set,          "void box_set(int, int, int);" },
+    { all_set,          "void all_set(int, int);" },
+    { box_crypt,        "void box_crypt(int);" },
+    { dex_set,          "void dex_set(int, int);" },
+    { gift_inject,      "int gift_inject(char*, int);" },
+    { sav_resign,       "void sav_resign();" },
+    { NULL,             NULL }
+};
+
+extern "C" void PksmLibraryInit(Picoc* pc)
+{
+    IncludeRegister(pc, "pksm.h", NULL, &PksmFunctions[0], PKSM_DEFS);
+}
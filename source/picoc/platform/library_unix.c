@@ -26,4 +26,5 @@ struct LibraryFunction UnixFunctions[] =
 void PlatformLibraryInit(Picoc *pc)
 {
     IncludeRegister(pc, "picoc_unix.h", &UnixSetupFunc, &UnixFunctions[0], NULL);
+    PksmLibraryInit(pc);
 }
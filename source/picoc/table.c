@@ -10,41 +10,121 @@ void TableInit(Picoc *pc)
     pc->StrEmpty = TableStrRegister(pc, "");
 }
 
-/* hash function for strings */
+/* hash function for strings - FNV-1a, which spreads short identifiers well */
 static unsigned int TableHash(const char *Key, int Len)
 {
-    unsigned int Hash = Len;
-    int Offset;
+    unsigned int Hash = 2166136261u;
     int Count;
     
-    for (Count = 0, Offset = 8; Count < Len; Count++, Offset+=7)
+    for (Count = 0; Count < Len; Count++)
     {
-        if (Offset > (int) sizeof(unsigned int) * 8 - 7)
-            Offset -= sizeof(unsigned int) * 8 - 6;
-            
-        Hash ^= *Key++ << Offset;
+        Hash ^= (unsigned char)Key[Count];
+        Hash *= 16777619u;
     }
     
     return Hash;
 }
 
+/* hash function for shared strings. they have unique addresses so we only need
+ * to mix the pointer bits. the low bit is masked so keys which have been
+ * altered to hide them out of scope stay in the same chain */
+static unsigned int TableHashPointer(const char *Key)
+{
+    return (unsigned int)(((unsigned long)Key >> 1) * 2654435761u);
+}
+
 /* initialise a table */
 void TableInitTable(struct Table *Tbl, struct TableEntry **HashTable, int Size, int OnHeap)
 {
     Tbl->Size = Size;
     Tbl->OnHeap = OnHeap;
     Tbl->HashTable = HashTable;
+    Tbl->Grown = FALSE;
+    Tbl->Resizes = 0;
+    Tbl->Entries = 0;
+    Tbl->Lookups = 0;
+    Tbl->Probes = 0;
     memset((void *)HashTable, '\0', sizeof(struct TableEntry *) * Size);
 }
 
+/* give a heap table more buckets once its chains get long. tables on the
+ * stack keep their size since they only live as long as a function call */
+static void TableGrow(Picoc *pc, struct Table *Tbl, int IsStringTable)
+{
+    struct TableEntry **NewHashTable;
+    struct TableEntry *Entry;
+    struct TableEntry *NextEntry;
+    unsigned int HashValue;
+    int NewSize;
+    int Count;
+    
+    if (!Tbl->OnHeap || Tbl->Entries < Tbl->Size * TABLE_MAX_LOAD || Tbl->Size >= TABLE_MAX_SIZE)
+        return;
+    
+    NewSize = Tbl->Size * 2 + 1;
+    if (NewSize > TABLE_MAX_SIZE)
+        NewSize = TABLE_MAX_SIZE;
+        
+    NewHashTable = HeapAllocMem(pc, sizeof(struct TableEntry *) * NewSize);
+    if (NewHashTable == NULL)
+        return;     /* longer chains are still correct, just slower */
+    
+    for (Count = 0; Count < Tbl->Size; Count++)
+    {
+        for (Entry = Tbl->HashTable[Count]; Entry != NULL; Entry = NextEntry)
+        {
+            NextEntry = Entry->Next;
+            if (IsStringTable)
+                HashValue = TableHash(&Entry->p.Key[0], strlen(&Entry->p.Key[0])) % NewSize;
+            else
+                HashValue = TableHashPointer(Entry->p.v.Key) % NewSize;
+                
+            Entry->Next = NewHashTable[HashValue];
+            NewHashTable[HashValue] = Entry;
+        }
+    }
+    
+    if (Tbl->Grown)
+        HeapFreeMem(pc, Tbl->HashTable);
+        
+    Tbl->HashTable = NewHashTable;
+    Tbl->Size = NewSize;
+    Tbl->Grown = TRUE;
+    Tbl->Resizes++;
+}
+
+/* free a bucket array which was allocated by growing the table */
+void TableFreeBuckets(Picoc *pc, struct Table *Tbl)
+{
+    if (Tbl->Grown)
+    {
+        HeapFreeMem(pc, Tbl->HashTable);
+        Tbl->HashTable = NULL;
+        Tbl->Size = 0;
+        Tbl->Grown = FALSE;
+    }
+}
+
+/* report how full a table is and how long its chains are */
+void TableStats(Picoc *pc, const char *Name, struct Table *Tbl)
+{
+    int LoadPercent = Tbl->Size > 0 ? Tbl->Entries * 100 / Tbl->Size : 0;
+    int ProbesPerHundred = Tbl->Lookups > 0 ? (int)(Tbl->Probes * 100 / Tbl->Lookups) : 0;
+    
+    PlatformPrintf(pc->CStdOut, "%s: %d entries in %d buckets (%d%% load), %d resizes, %d probes per 100 lookups\n",
+        Name, Tbl->Entries, Tbl->Size, LoadPercent, Tbl->Resizes, ProbesPerHundred);
+}
+
 /* check a hash table entry for a key */
 static struct TableEntry *TableSearch(struct Table *Tbl, const char *Key, int *AddAt)
 {
     struct TableEntry *Entry;
-    int HashValue = ((unsigned long)Key) % Tbl->Size;   /* shared strings have unique addresses so we don't need to hash them */
+    int HashValue = TableHashPointer(Key) % Tbl->Size;
     
+    Tbl->Lookups++;
     for (Entry = Tbl->HashTable[HashValue]; Entry != NULL; Entry = Entry->Next)
     {
+        Tbl->Probes++;
         if (Entry->p.v.Key == Key)
             return Entry;   /* found */
     }
@@ -70,6 +150,9 @@ int TableSet(Picoc *pc, struct Table *Tbl, char *Key, struct Value *Val, const c
         NewEntry->p.v.Val = Val;
         NewEntry->Next = Tbl->HashTable[AddAt];
         Tbl->HashTable[AddAt] = NewEntry;
+        Tbl->Entries++;
+        TableGrow(pc, Tbl, FALSE);
+        VariableBindingEvict(pc, Key);
         return TRUE;
     }
 
@@ -101,7 +184,7 @@ int TableGet(struct Table *Tbl, const char *Key, struct Value **Val, const char
 struct Value *TableDelete(Picoc *pc, struct Table *Tbl, const char *Key)
 {
     struct TableEntry **EntryPtr;
-    int HashValue = ((unsigned long)Key) % Tbl->Size;   /* shared strings have unique addresses so we don't need to hash them */
+    int HashValue = TableHashPointer(Key) % Tbl->Size;
     
     for (EntryPtr = &Tbl->HashTable[HashValue]; *EntryPtr != NULL; EntryPtr = &(*EntryPtr)->Next)
     {
@@ -111,6 +194,8 @@ struct Value *TableDelete(Picoc *pc, struct Table *Tbl, const char *Key)
             struct Value *Val = DeleteEntry->p.v.Val;
             *EntryPtr = DeleteEntry->Next;
             HeapFreeMem(pc, DeleteEntry);
+            Tbl->Entries--;
+            VariableBindingEvict(pc, Key);
 
             return Val;
         }
@@ -125,8 +210,10 @@ static struct TableEntry *TableSearchIdentifier(struct Table *Tbl, const char *K
     struct TableEntry *Entry;
     int HashValue = TableHash(Key, Len) % Tbl->Size;
     
+    Tbl->Lookups++;
     for (Entry = Tbl->HashTable[HashValue]; Entry != NULL; Entry = Entry->Next)
     {
+        Tbl->Probes++;
         if (strncmp(&Entry->p.Key[0], (char *)Key, Len) == 0 && Entry->p.Key[Len] == '\0')
             return Entry;   /* found */
     }
@@ -153,6 +240,8 @@ char *TableSetIdentifier(Picoc *pc, struct Table *Tbl, const char *Ident, int Id
         NewEntry->p.Key[IdentLen] = '\0';
         NewEntry->Next = Tbl->HashTable[AddAt];
         Tbl->HashTable[AddAt] = NewEntry;
+        Tbl->Entries++;
+        TableGrow(pc, Tbl, TRUE);
         return &NewEntry->p.Key[0];
     }
 }
@@ -183,4 +272,6 @@ void TableStrFree(Picoc *pc)
             HeapFreeMem(pc, Entry);
         }
     }
+    
+    TableFreeBuckets(pc, &pc->StringTable);
 }
@@ -6,6 +6,11 @@
 /* maximum size of a value to temporarily copy while we create a variable */
 #define MAX_TMP_COPY_BUF 256
 
+#ifndef NO_BINDING_CACHE
+/* shared strings have unique addresses so the pointer is a good enough hash */
+#define BINDING_CACHE_SLOT(Ident) ((((unsigned long)(Ident)) >> 2) & (BINDING_CACHE_SIZE-1))
+#endif
+
 
 /* initialise the variable system */
 void VariableInit(Picoc *pc)
@@ -22,11 +27,17 @@ void VariableFree(Picoc *pc, struct Value *Val)
     {
         /* free function bodies */
         if (Val->Typ == &pc->FunctionType && Val->Val->FuncDef.Intrinsic == NULL && Val->Val->FuncDef.Body.Pos != NULL)
+        {
             HeapFreeMem(pc, (void *)Val->Val->FuncDef.Body.Pos);
+            ExpressionCacheClear(pc);
+        }
 
         /* free macro bodies */
         if (Val->Typ == &pc->MacroType)
+        {
             HeapFreeMem(pc, (void *)Val->Val->MacroDef.Body.Pos);
+            ExpressionCacheClear(pc);
+        }
 
         /* free the AnyValue */
         if (Val->AnyValOnHeap)
@@ -56,6 +67,8 @@ void VariableTableCleanup(Picoc *pc, struct Table *HashTable)
             HeapFreeMem(pc, Entry);
         }
     }
+    
+    TableFreeBuckets(pc, HashTable);
 }
 
 void VariableCleanup(Picoc *pc)
@@ -191,6 +204,8 @@ int VariableScopeBegin(struct ParseState * Parser, int* OldScopeID)
             {
                 Entry->p.v.Val->OutOfScope = FALSE;
                 Entry->p.v.Key = (char*)((intptr_t)Entry->p.v.Key & ~1);
+                /* it may shadow whatever the name resolved to until now */
+                VariableBindingEvict(pc, Entry->p.v.Key);
                 #ifdef VAR_SCOPE_DEBUG
                 if (!FirstPrint) { PRINT_SOURCE_POS; }
                 FirstPrint = 1;
@@ -359,6 +374,20 @@ int VariableDefined(Picoc *pc, const char *Ident)
 /* get the value of a variable. must be defined. Ident must be registered */
 void VariableGet(Picoc *pc, struct ParseState *Parser, const char *Ident, struct Value **LVal)
 {
+#ifndef NO_BINDING_CACHE
+    unsigned int FrameSerial = (pc->TopStackFrame == NULL) ? 0 : pc->TopStackFrame->Serial;
+    struct BindingCacheEntry *Cached = &pc->BindingCache[BINDING_CACHE_SLOT(Ident)];
+
+    /* the serial is checked first: a popped frame's values are gone */
+    if (Cached->Ident == Ident && Cached->FrameSerial == FrameSerial && !Cached->Val->OutOfScope)
+    {
+        pc->BindingCacheHits++;
+        *LVal = Cached->Val;
+        return;
+    }
+    pc->BindingCacheMisses++;
+#endif
+
     if (pc->TopStackFrame == NULL || !TableGet(&pc->TopStackFrame->LocalTable, Ident, LVal, NULL, NULL, NULL))
     {
         if (!TableGet(&pc->GlobalTable, Ident, LVal, NULL, NULL, NULL))
@@ -369,6 +398,23 @@ void VariableGet(Picoc *pc, struct ParseState *Parser, const char *Ident, struct
                 ProgramFail(Parser, "'%s' is undefined", Ident);
         }
     }
+
+#ifndef NO_BINDING_CACHE
+    Cached->Ident = Ident;
+    Cached->FrameSerial = FrameSerial;
+    Cached->Val = *LVal;
+#endif
+}
+
+/* forget any cached lookup of Ident. called whenever a table gains, loses or uncovers that name */
+void VariableBindingEvict(Picoc *pc, const char *Ident)
+{
+#ifndef NO_BINDING_CACHE
+    struct BindingCacheEntry *Cached = &pc->BindingCache[BINDING_CACHE_SLOT(Ident)];
+
+    if (Cached->Ident == Ident)
+        Cached->Ident = NULL;
+#endif
 }
 
 /* define a global variable shared with a platform global. Ident will be registered */
@@ -423,6 +469,7 @@ void VariableStackFrameAdd(struct ParseState *Parser, const char *FuncName, int
     NewFrame->Parameter = (NumParams > 0) ? ((void *)((char *)NewFrame + sizeof(struct StackFrame))) : NULL;
     TableInitTable(&NewFrame->LocalTable, &NewFrame->LocalHashTable[0], LOCAL_TABLE_SIZE, FALSE);
     NewFrame->PreviousStackFrame = Parser->pc->TopStackFrame;
+    NewFrame->Serial = ++Parser->pc->FrameSerial;
     Parser->pc->TopStackFrame = NewFrame;
 }
 
@@ -0,0 +1,152 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "BoxSummary.hpp"
+
+namespace
+{
+    // Where the fields BoxSummary reads live in each format
+    struct Layout
+    {
+        u8 PID;
+        u8 ivs;
+        u8 evs;
+        u8 form;
+        // 0 when the nature is PID % 25
+        u8 nature;
+        u8 shinyShift;
+    };
+
+    const Layout LAYOUTS[4] = {
+        { 0x00, 0x38, 0x18, 0x40, 0x00, 3 },
+        { 0x00, 0x38, 0x18, 0x40, 0x41, 3 },
+        { 0x18, 0x74, 0x1E, 0x1D, 0x1C, 4 },
+        { 0x18, 0x74, 0x1E, 0x1D, 0x1C, 4 },
+    };
+
+    struct Personal
+    {
+        u8 (*expType)(u16);
+        u8 (*formCount)(u16);
+        u16 (*formStatIndex)(u16);
+        u8 (*base[6])(u16);
+    };
+
+    const Personal PERSONAL[4] = {
+        { PersonalDPPtHGSS::expType, PersonalDPPtHGSS::formCount, PersonalDPPtHGSS::formStatIndex,
+            { PersonalDPPtHGSS::baseHP, PersonalDPPtHGSS::baseAtk, PersonalDPPtHGSS::baseDef, PersonalDPPtHGSS::baseSpe, PersonalDPPtHGSS::baseSpa, PersonalDPPtHGSS::baseSpd } },
+        { PersonalBWB2W2::expType, PersonalBWB2W2::formCount, PersonalBWB2W2::formStatIndex,
+            { PersonalBWB2W2::baseHP, PersonalBWB2W2::baseAtk, PersonalBWB2W2::baseDef, PersonalBWB2W2::baseSpe, PersonalBWB2W2::baseSpa, PersonalBWB2W2::baseSpd } },
+        { PersonalXYORAS::expType, PersonalXYORAS::formCount, PersonalXYORAS::formStatIndex,
+            { PersonalXYORAS::baseHP, PersonalXYORAS::baseAtk, PersonalXYORAS::baseDef, PersonalXYORAS::baseSpe, PersonalXYORAS::baseSpa, PersonalXYORAS::baseSpd } },
+        { PersonalSMUSUM::expType, PersonalSMUSUM::formCount, PersonalSMUSUM::formStatIndex,
+            { PersonalSMUSUM::baseHP, PersonalSMUSUM::baseAtk, PersonalSMUSUM::baseDef, PersonalSMUSUM::baseSpe, PersonalSMUSUM::baseSpa, PersonalSMUSUM::baseSpd } },
+    };
+
+    // hyper training bit of each stat, from PK7
+    const u8 HYPER_TRAIN_BITS[6] = { 0, 1, 2, 5, 3, 4 };
+}
+
+void BoxSummary::compute(const u8* data, u32 stride, u8 generation, int count)
+{
+    this->count = count;
+    if (generation < 4 || generation > 7)
+    {
+        this->count = 0;
+        return;
+    }
+    const Layout& layout = LAYOUTS[generation - 4];
+    const Personal& personal = PERSONAL[generation - 4];
+
+    // Gather: one pass over the records, the only one with personal lookups
+    for (int i = 0; i < count; i++)
+    {
+        const u8* pk = data + i * stride;
+        u32 PID = *(u32*)(pk + layout.PID);
+        u32 tsv = *(u16*)(pk + 0x0C) ^ *(u16*)(pk + 0x0E);
+        u32 ivData = *(u32*)(pk + layout.ivs);
+
+        species[i] = *(u16*)(pk + 0x08);
+        experience[i] = *(u32*)(pk + 0x10);
+        nature[i] = layout.nature ? pk[layout.nature] : PID % 25;
+        shiny[i] = (tsv >> layout.shinyShift) == (((PID >> 16) ^ (PID & 0xFFFF)) >> layout.shinyShift);
+        hyperTrained[i] = 0;
+        for (int stat = 0; stat < 6; stat++)
+        {
+            ivs[stat][i] = (ivData >> 5 * stat) & 0x1F;
+            evs[stat][i] = pk[layout.evs + stat];
+        }
+        if (generation == 7)
+        {
+            for (int stat = 0; stat < 6; stat++)
+            {
+                hyperTrained[i] |= ((pk[0xDE] >> HYPER_TRAIN_BITS[stat]) & 1) << stat;
+            }
+        }
+
+        u16 form = pk[layout.form] >> 3;
+        u8 formCount = personal.formCount(species[i]);
+        formSpecies[i] = species[i];
+        if (form && form < formCount)
+        {
+            u16 index = personal.formStatIndex(species[i]);
+            if (index)
+            {
+                formSpecies[i] = index + form - 1;
+            }
+        }
+
+        expType[i] = personal.expType(species[i]);
+        for (int stat = 0; stat < 6; stat++)
+        {
+            base[stat][i] = personal.base[stat](formSpecies[i]);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        level[i] = PKX::levelFor(expType[i], experience[i]);
+    }
+
+    // Everything below is straight arithmetic over the arrays
+    for (int i = 0; i < count; i++)
+    {
+        hpType[i] = 15 * ((ivs[0][i] & 1) + 2*(ivs[1][i] & 1) + 4*(ivs[2][i] & 1) + 8*(ivs[3][i] & 1) + 16*(ivs[4][i] & 1) + 32*(ivs[5][i] & 1)) / 63;
+    }
+
+    for (int stat = 0; stat < 6; stat++)
+    {
+        const u32 hpBonus = stat == 0 ? 100 : 0;
+        const u32 flat    = stat == 0 ? 10 : 5;
+        for (int i = 0; i < count; i++)
+        {
+            u32 iv = (hyperTrained[i] >> stat) & 1 ? 31 : ivs[stat][i];
+            u32 value = flat + (2 * base[stat][i] + iv + evs[stat][i] / 4 + hpBonus) * level[i] / 100;
+            u32 mult = 10 + (nature[i] / 5 + 1 == stat) - (nature[i] % 5 + 1 == stat);
+            stats[stat][i] = value * mult / 10;
+        }
+    }
+}
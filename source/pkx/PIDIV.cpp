@@ -0,0 +1,282 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "PIDIV.hpp"
+
+namespace
+{
+    // the inverse of seed * MULT + ADD
+    constexpr u32 REVERSE_MULT = 0xEEB9EB65;
+    constexpr u32 REVERSE_ADD  = 0x0A3561A1;
+    // seeds checked side by side in a sweep, written so the compiler can keep them in vector registers
+    constexpr u32 LANES = 8;
+    // seeds swept between two looks at the cancellation flags
+    constexpr u32 POLL = 0x10000;
+
+    // Composes steps applications of seed * mult + add by squaring
+    void jump(u32 steps, u32 mult, u32 add, u32& outMult, u32& outAdd)
+    {
+        outMult = 1;
+        outAdd  = 0;
+        while (steps)
+        {
+            if (steps & 1)
+            {
+                outMult *= mult;
+                outAdd   = outAdd * mult + add;
+            }
+            add  *= mult + 1;
+            mult *= mult;
+            steps >>= 1;
+        }
+    }
+
+    u8 genderOf(u32 PID, u8 ratio)
+    {
+        switch (ratio)
+        {
+            case 0:
+                return 0;
+            case 254:
+                return 1;
+            case 255:
+                return 2;
+        }
+        return (PID & 0xFF) < ratio ? 1 : 0;
+    }
+}
+
+u32 PIDIV::advance(u32 seed, u32 steps)
+{
+    u32 mult, add;
+    jump(steps, MULT, ADD, mult, add);
+    return seed * mult + add;
+}
+
+u32 PIDIV::reverse(u32 seed, u32 steps)
+{
+    u32 mult, add;
+    jump(steps, REVERSE_MULT, REVERSE_ADD, mult, add);
+    return seed * mult + add;
+}
+
+PIDIV::Spread PIDIV::method1(u32 seed)
+{
+    Spread spread;
+    spread.seed = seed;
+    seed = seed * MULT + ADD;
+    spread.PID = seed >> 16;
+    seed = seed * MULT + ADD;
+    spread.PID |= seed & 0xFFFF0000;
+    seed = seed * MULT + ADD;
+    u16 ivs = seed >> 16;
+    spread.ivs[0] = ivs & 0x1F;
+    spread.ivs[1] = (ivs >> 5) & 0x1F;
+    spread.ivs[2] = (ivs >> 10) & 0x1F;
+    seed = seed * MULT + ADD;
+    ivs = seed >> 16;
+    spread.ivs[3] = ivs & 0x1F;
+    spread.ivs[4] = (ivs >> 5) & 0x1F;
+    spread.ivs[5] = (ivs >> 10) & 0x1F;
+    return spread;
+}
+
+void PIDIV::apply(PKX& pk, const Spread& spread)
+{
+    pk.PID(spread.PID);
+    for (int i = 0; i < 6; i++)
+    {
+        pk.iv(i, spread.ivs[i]);
+    }
+}
+
+bool PIDIV::matches(const Constraints& constraints, const Spread& spread)
+{
+    if (constraints.nature != Constraints::ANY && spread.PID % 25 != (u32)constraints.nature)
+        return false;
+    if (constraints.gender != Constraints::ANY && genderOf(spread.PID, constraints.genderRatio) != constraints.gender)
+        return false;
+    if (constraints.ability != Constraints::ANY && (int)(spread.PID & 1) != constraints.ability)
+        return false;
+    if (constraints.shiny != Constraints::ANY
+        && ((constraints.TID ^ constraints.SID ^ (spread.PID >> 16) ^ (spread.PID & 0xFFFF)) < 8) != (constraints.shiny != 0))
+        return false;
+    for (int i = 0; i < 6; i++)
+    {
+        if (spread.ivs[i] < constraints.minIVs[i])
+            return false;
+    }
+    if (constraints.hpType != Constraints::ANY)
+    {
+        u8 type = 15 * ((spread.ivs[0] & 1) + 2*(spread.ivs[1] & 1) + 4*(spread.ivs[2] & 1) + 8*(spread.ivs[3] & 1) + 16*(spread.ivs[4] & 1) + 32*(spread.ivs[5] & 1)) / 63;
+        if (type != constraints.hpType)
+            return false;
+    }
+    return true;
+}
+
+PIDIV::Search::Search(const Constraints& constraints, size_t limit)
+    : mConstraints(constraints), mLimit(limit), mTotal(0), mProgress(0), mStopped(false)
+{
+}
+
+PIDIV::Search::~Search(void)
+{
+    cancel();
+    wait();
+}
+
+void PIDIV::Search::start(void)
+{
+    static_assert(((u64)1 << 32) % PARTS == 0, "seed space doesn't split evenly");
+    const u32 count = ((u64)1 << 32) / PARTS;
+    for (u32 i = 0; i < PARTS; i++)
+    {
+        u32 first = i * count;
+        mJobs.push_back(Threads::submit([this, first, count](Threads::Job& job) { sweep(job, first, count); }, Threads::Priority::LOW));
+    }
+}
+
+void PIDIV::Search::cancel(void)
+{
+    mStopped = true;
+    for (auto& job : mJobs)
+    {
+        job->cancel();
+    }
+}
+
+void PIDIV::Search::wait(void)
+{
+    for (auto& job : mJobs)
+    {
+        job->wait();
+    }
+}
+
+bool PIDIV::Search::done(void)
+{
+    for (auto& job : mJobs)
+    {
+        if (!job->done())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t PIDIV::Search::take(std::vector<Spread>& out)
+{
+    mMutex.lock();
+    size_t taken = mFound.size();
+    out.insert(out.end(), mFound.begin(), mFound.end());
+    mFound.clear();
+    mMutex.unlock();
+    return taken;
+}
+
+void PIDIV::Search::sweep(Threads::Job& job, u32 first, u32 count)
+{
+    // The first two calls only depend on the seed, so consecutive seeds give PID halves that
+    // step by a constant: each lane adds LANES times it instead of running the LCG
+    u32 mult1, add1, mult2, add2;
+    jump(1, MULT, ADD, mult1, add1);
+    jump(2, MULT, ADD, mult2, add2);
+
+    // Unconstrained fields compare against masks that let everything through
+    const u32 natureAny  = mConstraints.nature == Constraints::ANY;
+    const u32 nature     = mConstraints.nature;
+    const u32 abilityAny = mConstraints.ability == Constraints::ANY;
+    const u32 ability    = mConstraints.ability;
+    const u32 shinyAny   = mConstraints.shiny == Constraints::ANY;
+    const u32 shiny      = mConstraints.shiny != 0;
+    const u32 tsv        = mConstraints.TID ^ mConstraints.SID;
+    // only a ratio strictly between the fixed ones depends on the PID
+    u32 genderAny = mConstraints.gender == Constraints::ANY;
+    u32 female    = mConstraints.gender == 1;
+    u32 ratio     = mConstraints.genderRatio;
+    if (!genderAny && (ratio == 0 || ratio >= 254))
+    {
+        if (genderOf(0, ratio) != mConstraints.gender)
+        {
+            mProgress++;
+            return;
+        }
+        genderAny = 1;
+    }
+
+    u32 low[LANES], high[LANES];
+    for (u32 lane = 0; lane < LANES; lane++)
+    {
+        low[lane]  = (first + lane) * mult1 + add1;
+        high[lane] = (first + lane) * mult2 + add2;
+    }
+
+    for (u32 done = 0; done < count; done += LANES)
+    {
+        if (done % POLL == 0 && (mStopped || job.cancelled()))
+        {
+            return;
+        }
+
+        // Everything the PID decides, without branches per lane
+        u32 candidates = 0;
+        for (u32 lane = 0; lane < LANES; lane++)
+        {
+            u32 PID = (low[lane] >> 16) | (high[lane] & 0xFFFF0000);
+            u32 ok = natureAny | (PID % 25 == nature);
+            ok &= abilityAny | ((PID & 1) == ability);
+            ok &= genderAny | (((PID & 0xFF) < ratio) == female);
+            ok &= shinyAny | (((tsv ^ (PID >> 16) ^ (PID & 0xFFFF)) < 8) == shiny);
+            candidates |= ok << lane;
+            low[lane]  += mult1 * LANES;
+            high[lane] += mult2 * LANES;
+        }
+
+        while (candidates)
+        {
+            u32 lane = __builtin_ctz(candidates);
+            candidates &= candidates - 1;
+            Spread spread = method1(first + done + lane);
+            if (matches(mConstraints, spread))
+            {
+                mMutex.lock();
+                if (mTotal < mLimit)
+                {
+                    mFound.push_back(spread);
+                    if (++mTotal == mLimit)
+                    {
+                        mStopped = true;
+                    }
+                }
+                mMutex.unlock();
+            }
+        }
+    }
+
+    mProgress++;
+}
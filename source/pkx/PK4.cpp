@@ -25,6 +25,7 @@
 */
 
 #include "PK4.hpp"
+#include "PKXAlgorithms.hpp"
 
 void PK4::shuffleArray(void)
 {
@@ -156,15 +157,6 @@ void PK4::ribbon(u8 ribcat, u8 ribnum, u8 v)
     data[ribIndex[ribcat]] = (u8)((data[ribIndex[ribcat]] & ~(1 << ribnum)) | (v ? 1 << ribnum : 0));
 }
 
-u16 PK4::move(u8 m) const { return *(u16*)(data + 0x28 + m*2); }
-void PK4::move(u8 m, u16 v) { *(u16*)(data + 0x28 + m*2) = v; }
-
-u8 PK4::PP(u8 m) const { return data[0x30 + m]; }
-void PK4::PP(u8 m, u8 v) { data[0x30 + m] = v; }
-
-u8 PK4::PPUp(u8 m) const { return data[0x34 + m]; }
-void PK4::PPUp(u8 m, u8 v) { data[0x34 + m] = v; }
-
 u8 PK4::iv(u8 stat) const
 {
     u32 buffer = *(u32*)(data + 0x38);
@@ -366,13 +358,7 @@ void PK4::hpType(u8 v)
 u16 PK4::TSV(void) const { return (TID() ^ SID()) >> 3; }
 u16 PK4::PSV(void) const { return ((PID() >> 16) ^ (PID() & 0xFFFF)) >> 3; }
 
-u8 PK4::level(void) const
-{
-    u8 i = 1;
-    u8 xpType = PersonalDPPtHGSS::expType(species());
-    while (experience() >= expTable(i, xpType) && ++i < 100);
-    return i;
-}
+u8 PK4::level(void) const { return levelFor(PersonalDPPtHGSS::expType(species()), experience()); }
 
 void PK4::level(u8 v)
 {
@@ -440,7 +426,15 @@ u16 PK4::stat(const u8 stat) const
 
 std::unique_ptr<PKX> PK4::next(void)
 {
-    u8 dt[136];
+    PK5* pk5 = new PK5;
+    next(*pk5);
+    pk5->refreshChecksum();
+    return std::unique_ptr<PKX>(pk5);
+}
+
+void PK4::next(PK5& pk5)
+{
+    u8* dt = pk5.data;
     std::copy(data, data + 136, dt);
 
     // Clear HGSS data
@@ -449,38 +443,36 @@ std::unique_ptr<PKX> PK4::next(void)
     // Clear PtHGSS met data
     *(u32*)(dt + 0x44) = 0;
 
-    std::unique_ptr<PKX> pk5(new PK5(dt));
-
     time_t t = time(NULL);
     struct tm* timeStruct = gmtime((const time_t *) &t);
 
-    pk5->otFriendship(70);
-    pk5->metYear(timeStruct->tm_year - 100);
-    pk5->metMonth(timeStruct->tm_mon + 1);
-    pk5->metDay(timeStruct->tm_mday);
+    pk5.otFriendship(70);
+    pk5.metYear(timeStruct->tm_year - 100);
+    pk5.metMonth(timeStruct->tm_mon + 1);
+    pk5.metDay(timeStruct->tm_mday);
 
     // Force normal Arceus form
-    if (pk5->species() == 493)
+    if (pk5.species() == 493)
     {
-        pk5->alternativeForm(0);
+        pk5.alternativeForm(0);
     }
 
-    pk5->heldItem(0);
+    pk5.heldItem(0);
 
-    pk5->nature(nature());
+    pk5.nature(nature());
 
     // Check met location
-    pk5->metLocation(pk5->gen4() && pk5->fatefulEncounter() && std::find(beasts, beasts + 4, pk5->species()) != beasts + 4
-                ? (pk5->species() == 251 ? 30010 : 30012) // Celebi : Beast
+    pk5.metLocation(pk5.gen4() && pk5.fatefulEncounter() && std::find(beasts, beasts + 4, pk5.species()) != beasts + 4
+                ? (pk5.species() == 251 ? 30010 : 30012) // Celebi : Beast
                 : 30001); // Pokétransfer (not Crown)
 
-    pk5->ball(ball());
+    pk5.ball(ball());
 
-    pk5->nickname(nickname().c_str());
-    pk5->otName(otName().c_str());
+    pk5.nickname(nickname().c_str());
+    pk5.otName(otName().c_str());
 
     // Check level
-    pk5->metLevel(pk5->level());
+    pk5.metLevel(pk5.level());
     
     //Remove HM
     u16 moves[4] = { move(0), move(1), move(2), move(3) };
@@ -491,10 +483,7 @@ std::unique_ptr<PKX> PK4::next(void)
         {
             moves[i] = 0;
         }
-        pk5->move(i, moves[i]);
+        pk5.move(i, moves[i]);
     }
-    pk5->fixMoves();
-
-    pk5->refreshChecksum();
-    return pk5;
+    PKXAlgorithms::fixMoves(pk5);
 }
\ No newline at end of file
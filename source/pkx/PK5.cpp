@@ -25,6 +25,35 @@
 */
 
 #include "PK5.hpp"
+#include "PKXAlgorithms.hpp"
+
+// Byte ranges that keep their encoding between the gen 5 and gen 6 layouts
+struct Remap
+{
+    u8 from;
+    u8 to;
+    u8 length;
+};
+
+static const Remap toPK6[] = {
+    { 0x00, 0x00, 4 }, // PID -> encryption constant
+    { 0x00, 0x18, 4 }, // PID
+    { 0x08, 0x08, 2 }, // species
+    { 0x0C, 0x0C, 8 }, // TID, SID, experience
+    { 0x15, 0x14, 1 }, // ability
+    { 0x16, 0x2A, 1 }, // markings
+    { 0x17, 0xE3, 1 }, // language
+    { 0x1E, 0x24, 6 }, // contest stats
+    { 0x28, 0x5A, 16 }, // moves, PP, PP ups
+    { 0x38, 0x74, 4 }, // IVs, egg and nicknamed flags
+    { 0x40, 0x1D, 1 }, // fateful encounter, gender, form
+    { 0x41, 0x1C, 1 }, // nature
+    { 0x5F, 0xDF, 1 }, // version
+    { 0x78, 0xD1, 6 }, // egg and met dates
+    { 0x80, 0xDA, 2 }, // met location
+    { 0x82, 0x2B, 1 }, // pokerus
+    { 0x83, 0xDC, 3 }, // ball, met level and OT gender, encounter type
+};
 
 void PK5::shuffleArray(void)
 {
@@ -156,15 +185,6 @@ void PK5::ribbon(u8 ribcat, u8 ribnum, u8 v)
     data[ribIndex[ribcat]] = (u8)((data[ribIndex[ribcat]] & ~(1 << ribnum)) | (v ? 1 << ribnum : 0));
 }
 
-u16 PK5::move(u8 m) const { return *(u16*)(data + 0x28 + m*2); }
-void PK5::move(u8 m, u16 v) { *(u16*)(data + 0x28 + m*2) = v; }
-
-u8 PK5::PP(u8 m) const { return data[0x30 + m]; }
-void PK5::PP(u8 m, u8 v) { data[0x30 + m] = v; }
-
-u8 PK5::PPUp(u8 m) const { return data[0x34 + m]; }
-void PK5::PPUp(u8 m, u8 v) { data[0x34 + m] = v; }
-
 u8 PK5::iv(u8 stat) const
 {
     u32 buffer = *(u32*)(data + 0x38);
@@ -231,8 +251,8 @@ void PK5::metMonth(u8 v) { data[0x7C] = v; }
 u8 PK5::metDay(void) const { return data[0x7D]; }
 void PK5::metDay(u8 v) { data[0x7D] = v; }
 
-u16 PK5::eggLocation(void) const { return *(u16*)(data + 0x78); }
-void PK5::eggLocation(u16 v) { *(u16*)(data + 0x78) = v; }
+u16 PK5::eggLocation(void) const { return *(u16*)(data + 0x7E); }
+void PK5::eggLocation(u16 v) { *(u16*)(data + 0x7E) = v; }
 
 u16 PK5::metLocation(void) const { return *(u16*)(data + 0x80); }
 void PK5::metLocation(u16 v) { *(u16*)(data + 0x80) = v; }
@@ -299,13 +319,7 @@ void PK5::hpType(u8 v)
 u16 PK5::TSV(void) const { return (TID() ^ SID()) >> 3; }
 u16 PK5::PSV(void) const { return ((PID() >> 16) ^ (PID() & 0xFFFF)) >> 3; }
 
-u8 PK5::level(void) const
-{
-    u8 i = 1;
-    u8 xpType = PersonalBWB2W2::expType(species());
-    while (experience() >= expTable(i, xpType) && ++i < 100);
-    return i;
-}
+u8 PK5::level(void) const { return levelFor(PersonalBWB2W2::expType(species()), experience()); }
 
 void PK5::level(u8 v)
 {
@@ -373,16 +387,19 @@ u16 PK5::stat(const u8 stat) const
 
 std::unique_ptr<PKX> PK5::next(void)
 {
-    u8 dt[232] = {0};
-    PK6 *pk6 = new PK6(dt);
+    PK6* pk6 = new PK6;
+    next(*pk6);
+    pk6->refreshChecksum();
+    return std::unique_ptr<PKX>(pk6);
+}
 
-    pk6->encryptionConstant(PID());
-    pk6->species(species());
-    pk6->TID(TID());
-    pk6->SID(SID());
-    pk6->experience(experience());
-    pk6->PID(PID());
-    pk6->ability(ability());
+void PK5::next(PK6& pk6)
+{
+    std::fill(pk6.data, pk6.data + 232, 0);
+    for (size_t i = 0; i < sizeof(toPK6) / sizeof(Remap); i++)
+    {
+        std::copy(data + toPK6[i].from, data + toPK6[i].from + toPK6[i].length, pk6.data + toPK6[i].to);
+    }
 
     u8 abilities[3] = { PersonalBWB2W2::ability(species(), 0), PersonalBWB2W2::ability(species(), 1), PersonalBWB2W2::ability(species(), 2) };
     u8 abilVal = std::distance(abilities, std::find(abilities, abilities + 3, ability()));
@@ -392,71 +409,33 @@ std::unique_ptr<PKX> PK5::next(void)
     }
     if (abilVal <= 3)
     {
-        pk6->abilityNumber(1 << abilVal);
+        pk6.abilityNumber(1 << abilVal);
     }
     else // Shouldn't happen
     {
         if (hiddenAbility())
         {
-            pk6->abilityNumber(4);
+            pk6.abilityNumber(4);
         }
         else
         {
-            pk6->abilityNumber(gen5() ? ((PID() >> 16) & 1) : 1 << (PID() & 1));
+            pk6.abilityNumber(gen5() ? ((PID() >> 16) & 1) : 1 << (PID() & 1));
         }
     }
 
-    pk6->markValue(markValue());
-    pk6->language(language());
-    
     for (int i = 0; i < 6; i++)
     {
         // EV Cap
-        pk6->ev(i, ev(i) > 252 ? 252 : ev(i));
-        pk6->iv(i, iv(i));
-        pk6->contest(i, contest(i));
+        pk6.ev(i, ev(i) > 252 ? 252 : ev(i));
     }
 
-    for (int i = 0; i < 4; i++)
-    {
-        pk6->move(i, move(i));
-        pk6->PPUp(i, PPUp(i));
-        pk6->PP(i, PP(i));
-    }
-
-    pk6->egg(egg());
-    pk6->nicknamed(nicknamed());
-
-    pk6->fatefulEncounter(fatefulEncounter());
-    pk6->gender(gender());
-    pk6->alternativeForm(alternativeForm());
-    pk6->nature(nature());
-
-    pk6->nickname(i18n::species(pk6->language(), pk6->species()).c_str());
+    pk6.nickname(i18n::species(pk6.language(), pk6.species()).c_str());
     if (nicknamed())
-        pk6->nickname(nickname().c_str());
-
-    pk6->version(version());
+        pk6.nickname(nickname().c_str());
 
-    pk6->otName(otName().c_str());
+    pk6.otName(otName().c_str());
 
-    pk6->metYear(metYear());
-    pk6->metMonth(metMonth());
-    pk6->metDay(metDay());
-    pk6->eggYear(eggYear());
-    pk6->eggMonth(eggMonth());
-    pk6->eggDay(eggDay());
-
-    pk6->metLocation(metLocation());
-    pk6->eggLocation(eggLocation());
-
-    pk6->pkrsStrain(pkrsStrain());
-    pk6->pkrsDays(pkrsDays());
-    pk6->ball(ball());
-
-    pk6->metLevel(metLevel());
-    pk6->otGender(otGender());
-    pk6->encounterType(encounterType());
+    pk6.eggLocation(eggLocation());
 
     // Ribbon
     u8 contestRibbon = 0;
@@ -482,74 +461,71 @@ std::unique_ptr<PKX> PK5::next(void)
     for (int i = 1; i < 7; i++) // Sinnoh Battle Ribbons
         if (((data[0x24] >> i) & 1) == 1) battleRibbon++;
 
-    pk6->ribbonContestCount(contestRibbon);
-    pk6->ribbonBattleCount(battleRibbon);
-
-    pk6->ribbon(0, 1, ribbon(6, 4)); // Hoenn Champion
-    pk6->ribbon(0, 2, ribbon(0, 0)); // Sinnoh Champ
-    pk6->ribbon(0, 7, ribbon(7, 0)); // Effort Ribbon
-
-    pk6->ribbon(1, 0, ribbon(0, 7)); // Alert
-    pk6->ribbon(1, 1, ribbon(1, 0)); // Shock
-    pk6->ribbon(1, 2, ribbon(1, 1)); // Downcast
-    pk6->ribbon(1, 3, ribbon(1, 2)); // Careless
-    pk6->ribbon(1, 4, ribbon(1, 3)); // Relax
-    pk6->ribbon(1, 5, ribbon(1, 4)); // Snooze
-    pk6->ribbon(1, 6, ribbon(1, 5)); // Smile
-    pk6->ribbon(1, 7, ribbon(1, 6)); // Gorgeous
-
-    pk6->ribbon(2, 0, ribbon(1, 7)); // Royal
-    pk6->ribbon(2, 1, ribbon(2, 0)); // Gorgeous Royal
-    pk6->ribbon(2, 2, ribbon(6, 7)); // Artist
-    pk6->ribbon(2, 3, ribbon(2, 1)); // Footprint
-    pk6->ribbon(2, 4, ribbon(2, 2)); // Record
-    pk6->ribbon(2, 5, ribbon(2, 4)); // Legend
-    pk6->ribbon(2, 6, ribbon(7, 4)); // Country
-    pk6->ribbon(2, 7, ribbon(7, 5)); // National
-
-    pk6->ribbon(3, 0, ribbon(7, 6)); // Earth
-    pk6->ribbon(3, 1, ribbon(7, 7)); // World
-    pk6->ribbon(3, 2, ribbon(3, 2)); // Classic
-    pk6->ribbon(3, 3, ribbon(3, 3)); // Premier
-    pk6->ribbon(3, 4, ribbon(2, 3)); // Event
-    pk6->ribbon(3, 5, ribbon(2, 6)); // Birthday
-    pk6->ribbon(3, 6, ribbon(2, 7)); // Special
-    pk6->ribbon(3, 7, ribbon(3, 0)); // Souvenir
-
-    pk6->ribbon(4, 0, ribbon(3, 1)); // Wishing Ribbon
-    pk6->ribbon(4, 1, ribbon(7, 1)); // Battle Champion
-    pk6->ribbon(4, 2, ribbon(7, 2)); // Regional Champion
-    pk6->ribbon(4, 3, ribbon(7, 3)); // National Champion
-    pk6->ribbon(4, 4, ribbon(2, 5)); // World Champion
+    pk6.ribbonContestCount(contestRibbon);
+    pk6.ribbonBattleCount(battleRibbon);
+
+    pk6.ribbon(0, 1, ribbon(6, 4)); // Hoenn Champion
+    pk6.ribbon(0, 2, ribbon(0, 0)); // Sinnoh Champ
+    pk6.ribbon(0, 7, ribbon(7, 0)); // Effort Ribbon
+
+    pk6.ribbon(1, 0, ribbon(0, 7)); // Alert
+    pk6.ribbon(1, 1, ribbon(1, 0)); // Shock
+    pk6.ribbon(1, 2, ribbon(1, 1)); // Downcast
+    pk6.ribbon(1, 3, ribbon(1, 2)); // Careless
+    pk6.ribbon(1, 4, ribbon(1, 3)); // Relax
+    pk6.ribbon(1, 5, ribbon(1, 4)); // Snooze
+    pk6.ribbon(1, 6, ribbon(1, 5)); // Smile
+    pk6.ribbon(1, 7, ribbon(1, 6)); // Gorgeous
+
+    pk6.ribbon(2, 0, ribbon(1, 7)); // Royal
+    pk6.ribbon(2, 1, ribbon(2, 0)); // Gorgeous Royal
+    pk6.ribbon(2, 2, ribbon(6, 7)); // Artist
+    pk6.ribbon(2, 3, ribbon(2, 1)); // Footprint
+    pk6.ribbon(2, 4, ribbon(2, 2)); // Record
+    pk6.ribbon(2, 5, ribbon(2, 4)); // Legend
+    pk6.ribbon(2, 6, ribbon(7, 4)); // Country
+    pk6.ribbon(2, 7, ribbon(7, 5)); // National
+
+    pk6.ribbon(3, 0, ribbon(7, 6)); // Earth
+    pk6.ribbon(3, 1, ribbon(7, 7)); // World
+    pk6.ribbon(3, 2, ribbon(3, 2)); // Classic
+    pk6.ribbon(3, 3, ribbon(3, 3)); // Premier
+    pk6.ribbon(3, 4, ribbon(2, 3)); // Event
+    pk6.ribbon(3, 5, ribbon(2, 6)); // Birthday
+    pk6.ribbon(3, 6, ribbon(2, 7)); // Special
+    pk6.ribbon(3, 7, ribbon(3, 0)); // Souvenir
+
+    pk6.ribbon(4, 0, ribbon(3, 1)); // Wishing Ribbon
+    pk6.ribbon(4, 1, ribbon(7, 1)); // Battle Champion
+    pk6.ribbon(4, 2, ribbon(7, 2)); // Regional Champion
+    pk6.ribbon(4, 3, ribbon(7, 3)); // National Champion
+    pk6.ribbon(4, 4, ribbon(2, 5)); // World Champion
 
     // TODO
-    //pk6->country
-    //pk6->region
-    //pk6->console
+    //pk6.country
+    //pk6.region
+    //pk6.console
 
     // TODO
-    pk6->currentHandler(1);
-    //pk6->htName
-    //pk6->htGender
-    //pk6->geoRegion
-    //pk6->geoCountry
-    pk6->htIntensity(1);
-    pk6->htMemory(4);
-    pk6->htFeeling(rand() % 10);
-    pk6->otFriendship(PersonalXYORAS::baseFriendship(pk6->species()));
-    pk6->htFriendship(PersonalXYORAS::baseFriendship(pk6->species()));
+    pk6.currentHandler(1);
+    //pk6.htName
+    //pk6.htGender
+    //pk6.geoRegion
+    //pk6.geoCountry
+    pk6.htIntensity(1);
+    pk6.htMemory(4);
+    pk6.htFeeling(rand() % 10);
+    pk6.otFriendship(PersonalXYORAS::baseFriendship(pk6.species()));
+    pk6.htFriendship(PersonalXYORAS::baseFriendship(pk6.species()));
 
     u32 shiny = 0;
     shiny = (PID() >> 16) ^ (PID() & 0xFFFF) ^ TID() ^ SID();
     if (shiny >= 8 && shiny < 16) // Illegal shiny transfer
-        pk6->PID(pk6->PID() ^ 0x80000000);
+        pk6.PID(pk6.PID() ^ 0x80000000);
 
-    pk6->fixMoves();
+    PKXAlgorithms::fixMoves(pk6);
 
     // Fix name strings TODO ???
-
-    pk6->refreshChecksum();
-    return std::unique_ptr<PKX>(pk6);
 }
 
 std::unique_ptr<PKX> PK5::previous(void)
@@ -184,15 +184,6 @@ void PK6::ribbonBattleCount(u8 v) { data[0x39] = v; }
 std::string PK6::nickname(void) const { return StringUtils::getString(data, 0x40, 12); }
 void PK6::nickname(const char* v) { StringUtils::setString(data, v, 0x40, 12); }
 
-u16 PK6::move(u8 m) const { return *(u16*)(data + 0x5A + m*2); }
-void PK6::move(u8 m, u16 v) { *(u16*)(data + 0x5A + m*2) = v; }
-
-u8 PK6::PP(u8 m) const { return data[0x62 + m]; }
-void PK6::PP(u8 m, u8 v) { data[0x62 + m] = v; }
-
-u8 PK6::PPUp(u8 m) const { return data[0x66 + m]; }
-void PK6::PPUp(u8 m, u8 v) { data[0x66 + m] = v; }
-
 u16 PK6::relearnMove(u8 m) const { return *(u16*)(data + 0x6A + m*2); }
 void PK6::relearnMove(u8 m, u16 v) { *(u16*)(data + 0x6A + m*2) = v; }
 
@@ -381,13 +372,7 @@ void PK6::hpType(u8 v)
 u16 PK6::TSV(void) const { return (TID() ^ SID()) >> 4; }
 u16 PK6::PSV(void) const { return ((PID() >> 16) ^ (PID() & 0xFFFF)) >> 4; }
 
-u8 PK6::level(void) const
-{
-    u8 i = 1;
-    u8 xpType = PersonalXYORAS::expType(species());
-    while (experience() >= expTable(i, xpType) && ++i < 100);
-    return i;
-}
+u8 PK6::level(void) const { return levelFor(PersonalXYORAS::expType(species()), experience()); }
 
 void PK6::level(u8 v)
 {
@@ -455,7 +440,15 @@ u16 PK6::stat(const u8 stat) const
 
 std::unique_ptr<PKX> PK6::next(void)
 {
-    u8 dt[232];
+    PK7* pk7 = new PK7;
+    next(*pk7);
+    pk7->refreshChecksum();
+    return std::unique_ptr<PKX>(pk7);
+}
+
+void PK6::next(PK7& pk7)
+{
+    u8* dt = pk7.data;
     std::copy(data, data + 232, dt);
 
     // markvalue field moved, clear old gen 6 data
@@ -471,9 +464,7 @@ std::unique_ptr<PKX> PK6::next(void)
     dt[0x72] &= 0xFC; // low 2 bits of super training
     dt[0xDE] = 0; // gen 4 encounter type
 
-    PK7 *pk7 = new PK7(dt);
-    
-    pk7->markValue(markValue());
+    pk7.markValue(markValue());
 
     switch (abilityNumber())
     {
@@ -482,19 +473,16 @@ std::unique_ptr<PKX> PK6::next(void)
         case 4:
             u8 index = abilityNumber() >> 1;
             if (PersonalXYORAS::ability(species(), index) == ability())
-                pk7->ability(PersonalSMUSUM::ability(species(), index));
+                pk7.ability(PersonalSMUSUM::ability(species(), index));
     }
 
     // TODO
-    pk7->htMemory(4);
-    pk7->htTextVar(0);
-    pk7->htIntensity(1);
-    pk7->htFeeling(rand() % 10);
+    pk7.htMemory(4);
+    pk7.htTextVar(0);
+    pk7.htIntensity(1);
+    pk7.htFeeling(rand() % 10);
     //pk7->geoCountry
     //pk7->geoRegion
-
-    pk7->refreshChecksum();
-    return std::unique_ptr<PKX>(pk7);
 }
 
 std::unique_ptr<PKX> PK6::previous(void)
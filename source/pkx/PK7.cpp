@@ -175,15 +175,6 @@ void PK7::ribbon(u8 ribcat, u8 ribnum, u8 v) { data[0x30 + ribcat] = (u8)((data[
 std::string PK7::nickname(void) const { return StringUtils::getString(data, 0x40, 12); }
 void PK7::nickname(const char* v) { StringUtils::setString(data, v, 0x40, 12); }
 
-u16 PK7::move(u8 m) const { return *(u16*)(data + 0x5A + m*2); }
-void PK7::move(u8 m, u16 v) { *(u16*)(data + 0x5A + m*2) = v; }
-
-u8 PK7::PP(u8 m) const { return data[0x62 + m]; }
-void PK7::PP(u8 m, u8 v) { data[0x62 + m] = v; }
-
-u8 PK7::PPUp(u8 m) const { return data[0x66 + m]; }
-void PK7::PPUp(u8 m, u8 v) { data[0x66 + m] = v; }
-
 u16 PK7::relearnMove(u8 m) const { return *(u16*)(data + 0x6A + m*2); }
 void PK7::relearnMove(u8 m, u16 v) { *(u16*)(data + 0x6A + m*2) = v; }
 
@@ -366,13 +357,7 @@ void PK7::hpType(u8 v)
 u16 PK7::TSV(void) const { return (TID() ^ SID()) >> 4; }
 u16 PK7::PSV(void) const { return ((PID() >> 16) ^ (PID() & 0xFFFF)) >> 4; }
 
-u8 PK7::level(void) const
-{
-    u8 i = 1;
-    u8 xpType = PersonalSMUSUM::expType(species());
-    while (experience() >= expTable(i, xpType) && ++i < 100);
-    return i;
-}
+u8 PK7::level(void) const { return levelFor(PersonalSMUSUM::expType(species()), experience()); }
 
 void PK7::level(u8 v)
 {
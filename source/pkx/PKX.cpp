@@ -25,8 +25,13 @@
 */
 
 #include "PKX.hpp"
+#include "PK4.hpp"
+#include "PK5.hpp"
+#include "PK6.hpp"
+#include "PK7.hpp"
+#include "PKXAlgorithms.hpp"
 
-u32 PKX::expTable(u8 row, u8 col) const
+u32 PKX::expTable(u8 row, u8 col)
 {
     static const u32 table[100][6] = {
         {0, 0, 0, 0, 0, 0},
@@ -134,35 +139,27 @@ u32 PKX::expTable(u8 row, u8 col) const
     return table[row][col]; 
 }
 
-u32 PKX::seedStep(u32 seed) { return seed * 0x41C64E6D + 0x6073; }
-
-void PKX::reorderMoves(void)
+u8 PKX::levelFor(u8 expType, u32 experience)
 {
-    if (move(3) != 0 && move(2) == 0)
-    {
-        move(2, move(3));
-        PP(2, PP(3));
-        PPUp(2, PPUp(3));
-        move(3, 0);
-    }
-    if (move(2) != 0 && move(1) == 0)
-    {
-        move(1, move(2));
-        PP(1, PP(2));
-        PPUp(1, PPUp(2));
-        move(2, 0);
-        reorderMoves();
-    }
-    if (move(1) != 0 && move(0) == 0)
+    // first level whose threshold is above experience
+    u8 low = 1, high = 100;
+    while (low < high)
     {
-        move(0, move(1));
-        PP(0, PP(1));
-        PPUp(0,PPUp(1));
-        move(1, 0);
-        reorderMoves();
+        u8 mid = (low + high) / 2;
+        if (experience >= expTable(mid, expType))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
+    return low;
 }
 
+u32 PKX::seedStep(u32 seed) { return seed * 0x41C64E6D + 0x6073; }
+
 bool PKX::gen7(void) const { return version() >= 30 && version() <= 33;}
 
 bool PKX::gen6(void) const { return version() >= 24 && version() <= 29; }
@@ -175,19 +172,19 @@ bool PKX::gen3(void) const { return (version() >= 1 && version() <= 5) || (versi
 
 void PKX::fixMoves(void)
 {
-    reorderMoves();
-
-    if (move(0) == 0)
+    switch (generation())
     {
-        move(0, 1);
+        case 4:
+            PKXAlgorithms::fixMoves(static_cast<PK4&>(*this));
+            break;
+        case 5:
+            PKXAlgorithms::fixMoves(static_cast<PK5&>(*this));
+            break;
+        case 6:
+            PKXAlgorithms::fixMoves(static_cast<PK6&>(*this));
+            break;
+        case 7:
+            PKXAlgorithms::fixMoves(static_cast<PK7&>(*this));
+            break;
     }
-
-    for (int i = 0; i < 4; i++)
-    {
-        if (move(i) == 0)
-        {
-            PP(i, 0);
-            PPUp(i, 0);
-        }
-    }
-}
\ No newline at end of file
+}
@@ -0,0 +1,359 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "Schema.hpp"
+
+namespace
+{
+    using Schema::Encoding;
+    using Schema::Field;
+
+    constexpr Field number(const char* name, u8 offset, u8 width) { return Field{ name, offset, width, 0, 0, Encoding::UINT }; }
+    constexpr Field bits(const char* name, u8 offset, u8 width, u8 shift, u8 count) { return Field{ name, offset, width, shift, count, Encoding::UINT }; }
+    constexpr Field text(const char* name, u8 offset, u8 chars, Encoding encoding) { return Field{ name, offset, chars, 0, 0, encoding }; }
+
+    constexpr u32 end(const Field& field) { return field.offset + (field.encoding == Encoding::UINT ? field.width : field.width * 2); }
+
+    // Every field inside the record and every bit range inside its number
+    template <size_t N>
+    constexpr bool fits(const Field (&fields)[N], u32 length, size_t i = 0)
+    {
+        return i == N || (end(fields[i]) <= length && (fields[i].bits == 0 || fields[i].shift + fields[i].bits <= fields[i].width * 8) && fits(fields, length, i + 1));
+    }
+
+#define SIX(name, offset) number(name "0", offset, 1), number(name "1", offset + 1, 1), number(name "2", offset + 2, 1), \
+    number(name "3", offset + 3, 1), number(name "4", offset + 4, 1), number(name "5", offset + 5, 1)
+#define MOVES(moves, pp, ppUps) number("move0", moves, 2), number("move1", moves + 2, 2), number("move2", moves + 4, 2), number("move3", moves + 6, 2), \
+    number("PP0", pp, 1), number("PP1", pp + 1, 1), number("PP2", pp + 2, 1), number("PP3", pp + 3, 1), \
+    number("PPUp0", ppUps, 1), number("PPUp1", ppUps + 1, 1), number("PPUp2", ppUps + 2, 1), number("PPUp3", ppUps + 3, 1)
+#define IVS(offset) bits("iv0", offset, 4, 0, 5), bits("iv1", offset, 4, 5, 5), bits("iv2", offset, 4, 10, 5), \
+    bits("iv3", offset, 4, 15, 5), bits("iv4", offset, 4, 20, 5), bits("iv5", offset, 4, 25, 5), \
+    bits("egg", offset, 4, 30, 1), bits("nicknamed", offset, 4, 31, 1)
+#define FORM(offset) bits("fatefulEncounter", offset, 1, 0, 1), bits("gender", offset, 1, 1, 2), bits("alternativeForm", offset, 1, 3, 5)
+#define DATES(offset) number("eggYear", offset, 1), number("eggMonth", offset + 1, 1), number("eggDay", offset + 2, 1), \
+    number("metYear", offset + 3, 1), number("metMonth", offset + 4, 1), number("metDay", offset + 5, 1)
+#define MET(offset) bits("metLevel", offset, 1, 0, 7), bits("otGender", offset, 1, 7, 1)
+
+    constexpr Field PK4_FIELDS[] = {
+        number("PID", 0x00, 4), number("checksum", 0x06, 2), number("species", 0x08, 2), number("heldItem", 0x0A, 2),
+        number("TID", 0x0C, 2), number("SID", 0x0E, 2), number("experience", 0x10, 4), number("otFriendship", 0x14, 1),
+        number("ability", 0x15, 1), number("markValue", 0x16, 1), number("language", 0x17, 1),
+        SIX("ev", 0x18), SIX("contest", 0x1E), MOVES(0x28, 0x30, 0x34), IVS(0x38), FORM(0x40),
+        number("shinyLeaf", 0x41, 1),
+        // Platinum and HGSS locations, used instead of the DP ones when set
+        number("eggLocationPtHGSS", 0x44, 2), number("metLocationPtHGSS", 0x46, 2),
+        text("nickname", 0x48, 11, Encoding::TEXT4), number("version", 0x5F, 1), text("otName", 0x68, 8, Encoding::TEXT4),
+        DATES(0x78), number("eggLocation", 0x7E, 2), number("metLocation", 0x80, 2), number("pkrs", 0x82, 1),
+        number("ball", 0x83, 1), MET(0x84), number("encounterType", 0x85, 1),
+        // HGSS ball, the larger of the two is shown
+        number("ballHGSS", 0x86, 1),
+    };
+
+    constexpr Field PK5_FIELDS[] = {
+        number("PID", 0x00, 4), number("checksum", 0x06, 2), number("species", 0x08, 2), number("heldItem", 0x0A, 2),
+        number("TID", 0x0C, 2), number("SID", 0x0E, 2), number("experience", 0x10, 4), number("otFriendship", 0x14, 1),
+        number("ability", 0x15, 1), number("markValue", 0x16, 1), number("language", 0x17, 1),
+        SIX("ev", 0x18), SIX("contest", 0x1E), MOVES(0x28, 0x30, 0x34), IVS(0x38), FORM(0x40),
+        number("nature", 0x41, 1), bits("hiddenAbility", 0x42, 1, 0, 1), bits("nPokemon", 0x42, 1, 1, 1),
+        text("nickname", 0x48, 11, Encoding::TEXT5), number("version", 0x5F, 1), text("otName", 0x68, 8, Encoding::TEXT5),
+        DATES(0x78), number("eggLocation", 0x7E, 2), number("metLocation", 0x80, 2), number("pkrs", 0x82, 1),
+        number("ball", 0x83, 1), MET(0x84), number("encounterType", 0x85, 1),
+    };
+
+    constexpr Field PK6_FIELDS[] = {
+        number("encryptionConstant", 0x00, 4), number("checksum", 0x06, 2), number("species", 0x08, 2), number("heldItem", 0x0A, 2),
+        number("TID", 0x0C, 2), number("SID", 0x0E, 2), number("experience", 0x10, 4), number("ability", 0x14, 1),
+        number("abilityNumber", 0x15, 1), number("trainingBagHits", 0x16, 1), number("trainingBag", 0x17, 1),
+        number("PID", 0x18, 4), number("nature", 0x1C, 1), FORM(0x1D), SIX("ev", 0x1E), SIX("contest", 0x24),
+        number("markValue", 0x2A, 1), number("pkrs", 0x2B, 1), number("ribbonContestCount", 0x38, 1), number("ribbonBattleCount", 0x39, 1),
+        text("nickname", 0x40, 12, Encoding::TEXT6), MOVES(0x5A, 0x62, 0x66),
+        number("relearnMove0", 0x6A, 2), number("relearnMove1", 0x6C, 2), number("relearnMove2", 0x6E, 2), number("relearnMove3", 0x70, 2),
+        IVS(0x74), text("htName", 0x78, 12, Encoding::TEXT6), number("htGender", 0x92, 1), number("currentHandler", 0x93, 1),
+        number("htFriendship", 0xA2, 1), number("htAffection", 0xA3, 1), number("htIntensity", 0xA4, 1), number("htMemory", 0xA5, 1),
+        number("htFeeling", 0xA6, 1), number("htTextVar", 0xA8, 2), number("fullness", 0xAE, 1), number("enjoyment", 0xAF, 1),
+        text("otName", 0xB0, 12, Encoding::TEXT6), number("otFriendship", 0xCA, 1), number("otAffection", 0xCB, 1),
+        number("otIntensity", 0xCC, 1), number("otMemory", 0xCD, 1), number("otTextVar", 0xCE, 2), number("otFeeling", 0xD0, 1),
+        DATES(0xD1), number("eggLocation", 0xD8, 2), number("metLocation", 0xDA, 2), number("ball", 0xDC, 1), MET(0xDD),
+        number("encounterType", 0xDE, 1), number("version", 0xDF, 1), number("country", 0xE0, 1), number("region", 0xE1, 1),
+        number("consoleRegion", 0xE2, 1), number("language", 0xE3, 1),
+    };
+
+    constexpr Field PK7_FIELDS[] = {
+        number("encryptionConstant", 0x00, 4), number("checksum", 0x06, 2), number("species", 0x08, 2), number("heldItem", 0x0A, 2),
+        number("TID", 0x0C, 2), number("SID", 0x0E, 2), number("experience", 0x10, 4), number("ability", 0x14, 1),
+        number("abilityNumber", 0x15, 1), number("markValue", 0x16, 2), number("PID", 0x18, 4), number("nature", 0x1C, 1),
+        FORM(0x1D), SIX("ev", 0x1E), SIX("contest", 0x24), number("pelagoEventStatus", 0x2A, 1), number("pkrs", 0x2B, 1),
+        text("nickname", 0x40, 12, Encoding::TEXT6), MOVES(0x5A, 0x62, 0x66),
+        number("relearnMove0", 0x6A, 2), number("relearnMove1", 0x6C, 2), number("relearnMove2", 0x6E, 2), number("relearnMove3", 0x70, 2),
+        IVS(0x74), text("htName", 0x78, 12, Encoding::TEXT6), number("htGender", 0x92, 1), number("currentHandler", 0x93, 1),
+        number("htFriendship", 0xA2, 1), number("htAffection", 0xA3, 1), number("htIntensity", 0xA4, 1), number("htMemory", 0xA5, 1),
+        number("htFeeling", 0xA6, 1), number("htTextVar", 0xA8, 2), number("fullness", 0xAE, 1), number("enjoyment", 0xAF, 1),
+        text("otName", 0xB0, 12, Encoding::TEXT6), number("otFriendship", 0xCA, 1), number("otAffection", 0xCB, 1),
+        number("otIntensity", 0xCC, 1), number("otMemory", 0xCD, 1), number("otTextVar", 0xCE, 2), number("otFeeling", 0xD0, 1),
+        DATES(0xD1), number("eggLocation", 0xD8, 2), number("metLocation", 0xDA, 2), number("ball", 0xDC, 1), MET(0xDD),
+        number("hyperTrainFlags", 0xDE, 1), number("version", 0xDF, 1), number("country", 0xE0, 1), number("region", 0xE1, 1),
+        number("consoleRegion", 0xE2, 1), number("language", 0xE3, 1),
+    };
+
+#undef SIX
+#undef MOVES
+#undef IVS
+#undef FORM
+#undef DATES
+#undef MET
+
+    static_assert(fits(PK4_FIELDS, 136), "PK4 field out of the record");
+    static_assert(fits(PK5_FIELDS, 136), "PK5 field out of the record");
+    static_assert(fits(PK6_FIELDS, 232), "PK6 field out of the record");
+    static_assert(fits(PK7_FIELDS, 232), "PK7 field out of the record");
+
+    const Schema::Layout LAYOUTS[5] = {
+        { PK4_FIELDS, sizeof(PK4_FIELDS) / sizeof(Field), 136 },
+        { PK5_FIELDS, sizeof(PK5_FIELDS) / sizeof(Field), 136 },
+        { PK6_FIELDS, sizeof(PK6_FIELDS) / sizeof(Field), 232 },
+        { PK7_FIELDS, sizeof(PK7_FIELDS) / sizeof(Field), 232 },
+        { nullptr, 0, 0 },
+    };
+
+    // species sits at 0x08 in every format
+    bool empty(const u8* record) { return *(u16*)(record + 0x08) == 0; }
+
+    void appendNumber(std::string& out, u32 v)
+    {
+        char buf[10];
+        int i = sizeof(buf);
+        do
+        {
+            buf[--i] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        out.append(buf + i, sizeof(buf) - i);
+    }
+
+    void appendJSONString(std::string& out, const std::string& v)
+    {
+        static const char* hex = "0123456789abcdef";
+        out += '"';
+        for (char c : v)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if ((u8)c < 0x20)
+            {
+                out += "\\u00";
+                out += hex[(u8)c >> 4];
+                out += hex[c & 0xF];
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    void appendCSVString(std::string& out, const std::string& v)
+    {
+        out += '"';
+        for (char c : v)
+        {
+            if (c == '"')
+            {
+                out += '"';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+}
+
+const Schema::Layout& Schema::layout(u8 generation)
+{
+    return generation >= 4 && generation <= 7 ? LAYOUTS[generation - 4] : LAYOUTS[4];
+}
+
+const Schema::Field* Schema::find(const Layout& layout, const std::string& name)
+{
+    for (size_t i = 0; i < layout.count; i++)
+    {
+        if (name == layout.fields[i].name)
+        {
+            return layout.fields + i;
+        }
+    }
+    return nullptr;
+}
+
+void Schema::set(u8* record, const Field& field, u32 v)
+{
+    if (field.bits)
+    {
+        u32 mask = ((1u << field.bits) - 1) << field.shift;
+        v = (get(record, Field{ field.name, field.offset, field.width, 0, 0, Encoding::UINT }) & ~mask) | ((v << field.shift) & mask);
+    }
+    switch (field.width)
+    {
+        case 1:
+            record[field.offset] = v;
+            break;
+        case 2:
+            *(u16*)(record + field.offset) = v;
+            break;
+        default:
+            *(u32*)(record + field.offset) = v;
+            break;
+    }
+}
+
+std::string Schema::text(const u8* record, const Field& field)
+{
+    switch (field.encoding)
+    {
+        case Encoding::TEXT4:
+            return StringUtils::getString4(record, field.offset, field.width);
+        case Encoding::TEXT5:
+            return StringUtils::getTrimmedString(record, field.offset, field.width, (char*)"\uFFFF");
+        case Encoding::TEXT6:
+            return StringUtils::getString(record, field.offset, field.width);
+        default:
+            return std::string();
+    }
+}
+
+void Schema::json(std::string& out, const u8* data, u32 stride, u8 generation, int count, u32 first)
+{
+    const Layout& format = layout(generation);
+    for (int i = 0; i < count; i++)
+    {
+        const u8* record = data + i * stride;
+        if (empty(record))
+        {
+            continue;
+        }
+
+        out += out.empty() || out.back() != '}' ? "{\"slot\":" : ",{\"slot\":";
+        appendNumber(out, first + i);
+        for (size_t f = 0; f < format.count; f++)
+        {
+            const Field& field = format.fields[f];
+            out += ",\"";
+            out += field.name;
+            out += "\":";
+            if (field.encoding == Encoding::UINT)
+            {
+                appendNumber(out, get(record, field));
+            }
+            else
+            {
+                appendJSONString(out, text(record, field));
+            }
+        }
+        out += '}';
+    }
+}
+
+void Schema::csv(std::string& out, const u8* data, u32 stride, u8 generation, int count, u32 first, bool header)
+{
+    const Layout& format = layout(generation);
+    if (header)
+    {
+        out += "slot";
+        for (size_t f = 0; f < format.count; f++)
+        {
+            out += ',';
+            out += format.fields[f].name;
+        }
+        out += '\n';
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const u8* record = data + i * stride;
+        if (empty(record))
+        {
+            continue;
+        }
+
+        appendNumber(out, first + i);
+        for (size_t f = 0; f < format.count; f++)
+        {
+            const Field& field = format.fields[f];
+            out += ',';
+            if (field.encoding == Encoding::UINT)
+            {
+                appendNumber(out, get(record, field));
+            }
+            else
+            {
+                appendCSVString(out, text(record, field));
+            }
+        }
+        out += '\n';
+    }
+}
+
+void Schema::columns(Columns& out, const u8* data, u32 stride, u8 generation, int count, u32 first)
+{
+    const Layout& format = layout(generation);
+    out.numbers.resize(format.count);
+    out.text.resize(format.count);
+
+    size_t start = out.slots.size();
+    for (int i = 0; i < count; i++)
+    {
+        if (!empty(data + i * stride))
+        {
+            out.slots.push_back(first + i);
+        }
+    }
+
+    // A field at a time, so each column is filled by one loop over the records
+    for (size_t f = 0; f < format.count; f++)
+    {
+        const Field& field = format.fields[f];
+        if (field.encoding == Encoding::UINT)
+        {
+            std::vector<u32>& column = out.numbers[f];
+            column.reserve(out.slots.size());
+            for (size_t row = start; row < out.slots.size(); row++)
+            {
+                column.push_back(get(data + (out.slots[row] - first) * stride, field));
+            }
+        }
+        else
+        {
+            std::vector<std::string>& column = out.text[f];
+            column.reserve(out.slots.size());
+            for (size_t row = start; row < out.slots.size(); row++)
+            {
+                column.push_back(text(data + (out.slots[row] - first) * stride, field));
+            }
+        }
+    }
+}
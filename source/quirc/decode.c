@@ -233,28 +233,95 @@ static void berlekamp_massey(const uint8_t *s, int N,
  * Generator polynomial for GF(2^8) is x^8 + x^4 + x^3 + x^2 + 1
  */
 
-static int block_syndromes(const uint8_t *data, int bs, int npar, uint8_t *s)
+/* Multiplication by a constant c, split by nibble: since multiplication
+ * distributes over xor, c * x = lo[x & 0xf] ^ hi[x >> 4].
+ */
+struct gf256_mul_table {
+	uint8_t lo[16];
+	uint8_t hi[16];
+};
+
+/* Tables for multiplying by alpha^0 .. alpha^(npar - 1), the points
+ * the syndromes are evaluated at. Every block of a code has the same
+ * number of parity bytes, so these are built once per code.
+ */
+struct syndrome_tables {
+	int			npar;
+	struct gf256_mul_table	alpha[MAX_POLY];
+};
+
+static inline uint8_t gf256_mul_alpha(uint8_t x)
+{
+	return (x << 1) ^ ((x & 0x80) ? 0x1d : 0);
+}
+
+static void syndrome_tables_init(struct syndrome_tables *t, int npar)
+{
+	int i, x;
+
+	t->npar = npar;
+
+	for (x = 0; x < 16; x++) {
+		t->alpha[0].lo[x] = x;
+		t->alpha[0].hi[x] = x << 4;
+	}
+
+	for (i = 1; i < npar; i++)
+		for (x = 0; x < 16; x++) {
+			t->alpha[i].lo[x] = gf256_mul_alpha(t->alpha[i - 1].lo[x]);
+			t->alpha[i].hi[x] = gf256_mul_alpha(t->alpha[i - 1].hi[x]);
+		}
+}
+
+static inline uint8_t gf256_mul_by(const struct gf256_mul_table *m,
+				   uint8_t x)
+{
+	return m->lo[x & 0xf] ^ m->hi[x >> 4];
+}
+
+/* S_i is the block read as a polynomial, evaluated at alpha^i with
+ * Horner's rule: one table multiply per byte, and no logarithms. Each
+ * step depends on the last, so four syndromes are worked on at once to
+ * keep more than one multiply in flight.
+ */
+static int block_syndromes(const uint8_t *data, int bs,
+			   const struct syndrome_tables *t, uint8_t *s)
 {
 	int nonzero = 0;
-	int i;
+	int i = 0;
+	int j;
 
 	memset(s, 0, MAX_POLY);
 
-	for (i = 0; i < npar; i++) {
-		int j;
+	for (; i + 4 <= t->npar; i += 4) {
+		const struct gf256_mul_table *m = &t->alpha[i];
+		uint8_t v0 = 0, v1 = 0, v2 = 0, v3 = 0;
 
 		for (j = 0; j < bs; j++) {
-			uint8_t c = data[bs - j - 1];
-
-			if (!c)
-				continue;
+			const uint8_t c = data[j];
 
-			s[i] ^= gf256_exp[((int)gf256_log[c] +
-				    i * j) % 255];
+			v0 = gf256_mul_by(&m[0], v0) ^ c;
+			v1 = gf256_mul_by(&m[1], v1) ^ c;
+			v2 = gf256_mul_by(&m[2], v2) ^ c;
+			v3 = gf256_mul_by(&m[3], v3) ^ c;
 		}
 
-		if (s[i])
-			nonzero = 1;
+		s[i] = v0;
+		s[i + 1] = v1;
+		s[i + 2] = v2;
+		s[i + 3] = v3;
+		nonzero |= v0 | v1 | v2 | v3;
+	}
+
+	for (; i < t->npar; i++) {
+		const struct gf256_mul_table *m = &t->alpha[i];
+		uint8_t v = 0;
+
+		for (j = 0; j < bs; j++)
+			v = gf256_mul_by(m, v) ^ data[j];
+
+		s[i] = v;
+		nonzero |= v;
 	}
 
 	return nonzero;
@@ -292,18 +359,25 @@ static void eloc_poly(uint8_t *omega,
 }
 
 static quirc_decode_error_t correct_block(uint8_t *data,
-					  const struct quirc_rs_params *ecc)
+					  const struct quirc_rs_params *ecc,
+					  const struct syndrome_tables *t,
+					  struct quirc_decode_stats *stats)
 {
 	int npar = ecc->bs - ecc->dw;
 	uint8_t s[MAX_POLY];
 	uint8_t sigma[MAX_POLY];
 	uint8_t sigma_deriv[MAX_POLY];
 	uint8_t omega[MAX_POLY];
+	int corrected = 0;
 	int i;
 
-	/* Compute syndrome vector */
-	if (!block_syndromes(data, ecc->bs, npar, s))
+	stats->blocks++;
+
+	/* Compute syndrome vector. A clean block needs no correction. */
+	if (!block_syndromes(data, ecc->bs, t, s)) {
+		stats->blocks_clean++;
 		return QUIRC_SUCCESS;
+	}
 
 	berlekamp_massey(s, npar, &gf256, sigma);
 
@@ -326,11 +400,18 @@ static quirc_decode_error_t correct_block(uint8_t *data,
 						   gf256_log[omega_x]) % 255];
 
 			data[ecc->bs - i - 1] ^= error;
+			if (error)
+				corrected++;
 		}
 	}
 
-	if (block_syndromes(data, ecc->bs, npar, s))
+	if (block_syndromes(data, ecc->bs, t, s)) {
+		stats->blocks_failed++;
 		return QUIRC_ERROR_DATA_ECC;
+	}
+
+	stats->blocks_corrected++;
+	stats->bytes_corrected += corrected;
 
 	return QUIRC_SUCCESS;
 }
@@ -570,7 +651,8 @@ static void read_data(const struct quirc_code *code,
 }
 
 static quirc_decode_error_t codestream_ecc(struct quirc_data *data,
-					   struct datastream *ds)
+					   struct datastream *ds,
+					   struct quirc_decode_stats *stats)
 {
 	const struct quirc_version_info *ver =
 		&quirc_version_db[data->version];
@@ -580,12 +662,15 @@ static quirc_decode_error_t codestream_ecc(struct quirc_data *data,
 	int dst_offset = 0;
 	int lb_count = ver->data_bytes - bc * sb_ecc->bs;
 	int small_dw_total = bc * sb_ecc->dw;
+	struct syndrome_tables tables;
 	int i;
 
 	memcpy(&lb_ecc, sb_ecc, sizeof(lb_ecc));
 	lb_ecc.dw++;
 	lb_ecc.bs++;
 
+	syndrome_tables_init(&tables, sb_ecc->bs - sb_ecc->dw);
+
 	for (i = 0; i < bc; i++) {
 		uint8_t *dst = ds->data + dst_offset;
 		const struct quirc_rs_params *ecc = sb_ecc;
@@ -605,7 +690,7 @@ static quirc_decode_error_t codestream_ecc(struct quirc_data *data,
 			dst[j++] = ds->raw[small_dw_total + lb_count + i +
 					   k * bc];
 
-		err = correct_block(dst, ecc);
+		err = correct_block(dst, ecc, &tables, stats);
 		if (err)
 			return err;
 
@@ -832,6 +917,19 @@ static quirc_decode_error_t decode_eci(struct quirc_data *data,
 	return QUIRC_SUCCESS;
 }
 
+static quirc_decode_error_t decode_structured_append(struct quirc_data *data,
+						     struct datastream *ds)
+{
+	if (bits_remaining(ds) < 16)
+		return QUIRC_ERROR_DATA_UNDERFLOW;
+
+	data->sa_index = take_bits(ds, 4);
+	data->sa_size = take_bits(ds, 4) + 1;
+	data->sa_parity = take_bits(ds, 8);
+
+	return QUIRC_SUCCESS;
+}
+
 static quirc_decode_error_t decode_payload(struct quirc_data *data,
 					   struct datastream *ds)
 {
@@ -856,6 +954,10 @@ static quirc_decode_error_t decode_payload(struct quirc_data *data,
 			err = decode_kanji(data, ds);
 			break;
 
+		case 3:
+			err = decode_structured_append(data, ds);
+			break;
+
 		case 7:
 			err = decode_eci(data, ds);
 			break;
@@ -880,11 +982,35 @@ done:
 	return QUIRC_SUCCESS;
 }
 
-quirc_decode_error_t quirc_decode(const struct quirc_code *code,
-				  struct quirc_data *data)
+/* Add the time since *start to *total and restart the clock */
+static void stats_lap(const struct quirc_decode_stats *stats,
+		      uint64_t *start, uint64_t *total)
+{
+	uint64_t now;
+
+	if (!stats->clock)
+		return;
+
+	now = stats->clock();
+	*total += now - *start;
+	*start = now;
+}
+
+quirc_decode_error_t quirc_decode_with_stats(const struct quirc_code *code,
+					     struct quirc_data *data,
+					     struct quirc_decode_stats *stats)
 {
 	quirc_decode_error_t err;
 	struct datastream ds;
+	struct quirc_decode_stats scratch;
+	uint64_t start = 0;
+
+	if (!stats) {
+		memset(&scratch, 0, sizeof(scratch));
+		stats = &scratch;
+	}
+
+	stats->codes++;
 
 	if ((code->size - 17) % 4)
 		return QUIRC_ERROR_INVALID_GRID_SIZE;
@@ -898,21 +1024,36 @@ quirc_decode_error_t quirc_decode(const struct quirc_code *code,
 	    data->version > QUIRC_MAX_VERSION)
 		return QUIRC_ERROR_INVALID_VERSION;
 
+	if (stats->clock)
+		start = stats->clock();
+
 	/* Read format information -- try both locations */
 	err = read_format(code, data, 0);
 	if (err)
 		err = read_format(code, data, 1);
+	stats_lap(stats, &start, &stats->time_format);
 	if (err)
 		return err;
 
 	read_data(code, data, &ds);
-	err = codestream_ecc(data, &ds);
+	stats_lap(stats, &start, &stats->time_read);
+
+	err = codestream_ecc(data, &ds, stats);
+	stats_lap(stats, &start, &stats->time_ecc);
 	if (err)
 		return err;
 
 	err = decode_payload(data, &ds);
+	stats_lap(stats, &start, &stats->time_payload);
 	if (err)
 		return err;
 
+	stats->decoded++;
 	return QUIRC_SUCCESS;
 }
+
+quirc_decode_error_t quirc_decode(const struct quirc_code *code,
+				  struct quirc_data *data)
+{
+	return quirc_decode_with_stats(code, data, NULL);
+}
@@ -118,181 +118,201 @@ static void perspective_unmap(const double *c,
 }
 
 /************************************************************************
- * Span-based floodfill routine
+ * Span-based region labelling
  */
 
 typedef void (*span_func_t)(void *user_data, int y, int left, int right);
 
-#if 0 // recursive flood fill
+static int run_find(struct quirc_run *runs, int i)
+{
+	while (runs[i].parent != i) {
+		runs[i].parent = runs[runs[i].parent].parent;
+		i = runs[i].parent;
+	}
 
-#define FLOOD_FILL_MAX_DEPTH	4096
+	return i;
+}
 
-struct flood_fill_params{
-	struct quirc *q;
-	int from;
-	int to;
-	span_func_t func;
-	void *user_data;
-};
+/* The lower index always becomes the root, so every region ends up
+ * rooted at its first run in scan order.
+ */
+static void run_union(struct quirc_run *runs, int a, int b)
+{
+	a = run_find(runs, a);
+	b = run_find(runs, b);
 
-static struct flood_fill_params ffp;
+	if (a < b)
+		runs[b].parent = a;
+	else if (b < a)
+		runs[a].parent = b;
+}
 
-static void flood_fill_rec(int x, int y, int depth)
+static int run_push(struct quirc *q, int y, int left, int right)
 {
-	int left = x;
-	int right = x;
-	int i;
-	quirc_pixel_t *row = ffp.q->pixels + y * ffp.q->w;
+	struct quirc_run *run;
 
-	if (!depth)
-		return;
+	if (q->num_runs >= q->runs_size) {
+		int size = q->runs_size ? q->runs_size * 2 : 1024;
+		struct quirc_run *runs =
+			realloc(q->runs, size * sizeof(*runs));
 
-	while (left > 0 && row[left - 1] == ffp.from)
-		left--;
+		if (!runs)
+			return -1;
 
-	while (right < ffp.q->w - 1 && row[right + 1] == ffp.from)
-		right++;
+		q->runs = runs;
+		q->runs_size = size;
+	}
 
-	/* Fill the extent */
-	for (i = left; i <= right; i++)
-		row[i] = ffp.to;
+	run = &q->runs[q->num_runs];
+	run->y = y;
+	run->left = left;
+	run->right = right;
+	run->parent = q->num_runs;
 
-	if (ffp.func)
-		ffp.func(ffp.user_data, y, left, right);
+	return q->num_runs++;
+}
 
-	/* Seed new flood-fills */
-	if (y > 0) {
-		row = ffp.q->pixels + (y - 1) * ffp.q->w;
+/* First x at or after start where the pixel colour is no longer black
+ * (or white). Thresholded pixels are exactly 0 or 1, so four of them
+ * can be checked at once.
+ */
+static int run_scan(const quirc_pixel_t *row, int x, int w, int black)
+{
+	if (sizeof(*row) == 1) {
+		const uint32_t same = black ? 0x01010101 : 0;
+
+		while (x + 4 <= w) {
+			uint32_t v;
 
-		for (i = left; i <= right; i++)
-			if (row[i] == ffp.from)
-				flood_fill_rec(i, y - 1, depth - 1);
+			memcpy(&v, row + x, 4);
+			if (v != same)
+				break;
+			x += 4;
+		}
 	}
 
-	if (y < ffp.q->h - 1) {
-		row = ffp.q->pixels + (y + 1) * ffp.q->w;
+	while (x < w && (row[x] != 0) == black)
+		x++;
 
-		for (i = left; i <= right; i++)
-			if (row[i] == ffp.from)
-				flood_fill_rec(i, y + 1, depth - 1);
-	}
+	return x;
 }
 
-static void flood_fill_seed(struct quirc *q, int x, int y, int from, int to,
-				span_func_t func, void *user_data)
+/* Split the thresholded image into runs of black pixels and join runs
+ * which share a column with a run on the row above, in a single pass.
+ * This gives the same 4-connected regions a flood fill would find, with
+ * their areas, without touching any pixel twice. If the run table can't
+ * grow, the rest of the image is left unlabelled.
+ */
+static void label_regions(struct quirc *q)
 {
-	ffp.q = q;
-	ffp.from = from;
-	ffp.to = to;
-	ffp.func = func;
-	ffp.user_data = user_data;
+	int prev_first = 0;
+	int prev_end = 0;
+	int x, y, i;
 
-	flood_fill_rec(x, y, FLOOD_FILL_MAX_DEPTH);
-}
+	q->num_runs = 0;
 
-#else // stacked flood fill
+	for (y = 0; y < q->h; y++) {
+		const quirc_pixel_t *row = q->pixels + y * q->w;
+		int above = prev_first;
 
-#define FILL_STACK_CHUNK_SIZE 0x400
+		q->row_runs[y] = q->num_runs;
 
-struct fill_stack_chunk{
-	int x[FILL_STACK_CHUNK_SIZE];
-	int y[FILL_STACK_CHUNK_SIZE];
-	struct fill_stack_chunk *prev;
-};
+		x = run_scan(row, 0, q->w, 0);
+		while (x < q->w) {
+			int left = x;
+			int run;
+			int k;
 
-struct fill_stack{
-	struct fill_stack_chunk *last_chunk;
-	int index;
-};
+			x = run_scan(row, x, q->w, 1);
 
-static void fill_stack_init(struct fill_stack *s){
-	s->last_chunk = NULL;
-}
+			run = run_push(q, y, left, x - 1);
+			if (run < 0)
+				goto out_of_memory;
 
-static int fill_stack_is_empty(struct fill_stack *s){
-	return s->last_chunk == NULL;
-}
+			/* The last run above which overlaps may also overlap
+			 * the next run on this row, so don't step past it.
+			 */
+			while (above < prev_end && q->runs[above].right < left)
+				above++;
 
-static void fill_stack_push(struct fill_stack *s, int x, int y){
-	struct fill_stack_chunk *c;
-	if(s->last_chunk != NULL && s->index < FILL_STACK_CHUNK_SIZE - 1){
-		c = s->last_chunk;
-		s->index++;
-	}else{
-		c = (struct fill_stack_chunk*)malloc(sizeof(struct fill_stack_chunk));
-		if(c == NULL){
-			return;
+			for (k = above; k < prev_end &&
+			     q->runs[k].left <= x - 1; k++)
+				run_union(q->runs, run, k);
+
+			x = run_scan(row, x, q->w, 0);
 		}
-		c->prev = s->last_chunk;
-		s->last_chunk = c;
-		s->index = 0;
-	}
-	c->x[s->index] = x;
-	c->y[s->index] = y;
-}
 
-static void fill_stack_pop(struct fill_stack *s, int *px, int *py){
-	struct fill_stack_chunk *c = s->last_chunk;
-	if(c == NULL){
-		return;
-	}
-	*px = c->x[s->index];
-	*py = c->y[s->index];
-	if(s->index > 0){
-		s->index--;
-	}else{
-		s->last_chunk = c->prev;
-		s->index = FILL_STACK_CHUNK_SIZE - 1;
-		free(c);
+		prev_first = q->row_runs[y];
+		prev_end = q->num_runs;
 	}
-}
 
-static void flood_fill_seed(struct quirc *q, int start_x, int start_y, int from, int to,
-				span_func_t func, void *user_data)
-{
-	struct fill_stack s;
-	fill_stack_init(&s);
-	fill_stack_push(&s, start_x, start_y);
+	q->row_runs[q->h] = q->num_runs;
+
+resolve:
+	/* Roots come before the rest of their runs */
+	for (i = 0; i < q->num_runs; i++) {
+		struct quirc_run *run = &q->runs[i];
+		int root = run_find(q->runs, i);
+		int len = run->right - run->left + 1;
 
-	do{
-		int x = 0, y = 0;
-		fill_stack_pop(&s, &x, &y);
+		run->parent = root;
+		run->next = -1;
 
-		int left = x, right = x, i;
-		quirc_pixel_t *row = q->pixels + y * q->w;
+		if (root == i) {
+			run->count = len;
+			run->last = i;
+			run->region = -1;
+		} else {
+			struct quirc_run *r = &q->runs[root];
+
+			r->count += len;
+			q->runs[r->last].next = i;
+			r->last = i;
+		}
+	}
 
-		while (left > 0 && row[left - 1] == from)
-			left--;
+	return;
 
-		while (right < q->w - 1 && row[right + 1] == from)
-			right++;
+out_of_memory:
+	for (y++; y <= q->h; y++)
+		q->row_runs[y] = q->num_runs;
 
-		/* Fill the extent */
-		for (i = left; i <= right; i++)
-			row[i] = to;
+	goto resolve;
+}
 
-		if (func)
-			func(user_data, y, left, right);
+/* Index of the run covering (x, y), or -1 if that pixel is white */
+static int run_at(const struct quirc *q, int x, int y)
+{
+	int lo = q->row_runs[y];
+	int hi = q->row_runs[y + 1] - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) >> 1;
+		const struct quirc_run *run = &q->runs[mid];
+
+		if (run->right < x)
+			lo = mid + 1;
+		else if (run->left > x)
+			hi = mid - 1;
+		else
+			return mid;
+	}
 
-		/* Seed new flood-fills */
-		if (y > 0) {
-			row = q->pixels + (y - 1) * q->w;
+	return -1;
+}
 
-			for (i = left; i <= right; i++)
-				if (row[i] == from)
-					fill_stack_push(&s, i, y - 1);
-		}
+/* Call func for every span of a region, in scan order */
+static void region_spans(const struct quirc *q, int rcode,
+			 span_func_t func, void *user_data)
+{
+	int i;
 
-		if (y < q->h - 1) {
-			row = q->pixels + (y + 1) * q->w;
+	for (i = q->regions[rcode].run; i >= 0; i = q->runs[i].next) {
+		const struct quirc_run *run = &q->runs[i];
 
-			for (i = left; i <= right; i++)
-				if (row[i] == from)
-					fill_stack_push(&s, i, y + 1);
-		}
-	}while(!fill_stack_is_empty(&s));
+		func(user_data, run->y, run->left, run->right);
+	}
 }
-#endif
 
 /************************************************************************
  * Adaptive thresholding
@@ -301,6 +321,43 @@ static void flood_fill_seed(struct quirc *q, int start_x, int start_y, int from,
 #define THRESHOLD_S_DEN		8
 #define THRESHOLD_T		5
 
+/* Division by a constant done as a multiply, since the moving average
+ * divides twice per pixel and the 3DS's ARM11 has no divide instruction.
+ * With shift = 31 + floor(log2(d)) the result is exact for n < 2^30.
+ * The averages are at most 255 * d * (d - 1), which is below that for
+ * d < 2048; larger divisors fall back to dividing (m = 0).
+ */
+struct reciprocal {
+	uint32_t	m;
+	int		shift;
+};
+
+static void reciprocal_init(struct reciprocal *r, int d)
+{
+	int log2 = 0;
+
+	r->m = 0;
+	r->shift = 0;
+	if (d < 1 || d >= 2048)
+		return;
+
+	while (d >> (log2 + 1))
+		log2++;
+
+	r->shift = 31 + log2;
+	r->m = (uint32_t)(((uint64_t)1 << r->shift) / d + 1);
+}
+
+/* avg * (d - 1) / d */
+static inline int decay(const struct reciprocal *r, int avg, int d)
+{
+	if (r->m)
+		return (int)(((uint64_t)(uint32_t)(avg * (d - 1)) * r->m) >>
+			     r->shift);
+
+	return (avg * (d - 1)) / d;
+}
+
 static void threshold(struct quirc *q)
 {
 	int x, y;
@@ -308,6 +365,11 @@ static void threshold(struct quirc *q)
 	int avg_u = 0;
 	int threshold_s = q->w / THRESHOLD_S_DEN;
 	quirc_pixel_t *row = q->pixels;
+	struct reciprocal div_s;
+
+	if (threshold_s < 1)
+		threshold_s = 1;
+	reciprocal_init(&div_s, threshold_s);
 
 	for (y = 0; y < q->h; y++) {
 		int row_average[q->w];
@@ -325,51 +387,40 @@ static void threshold(struct quirc *q)
 				u = x;
 			}
 
-			avg_w = (avg_w * (threshold_s - 1)) /
-				threshold_s + row[w];
-			avg_u = (avg_u * (threshold_s - 1)) /
-				threshold_s + row[u];
+			avg_w = decay(&div_s, avg_w, threshold_s) + row[w];
+			avg_u = decay(&div_s, avg_u, threshold_s) + row[u];
 
 			row_average[w] += avg_w;
 			row_average[u] += avg_u;
 		}
 
-		for (x = 0; x < q->w; x++) {
-			if (row[x] < row_average[x] *
-			    (100 - THRESHOLD_T) / (200 * threshold_s))
-				row[x] = QUIRC_PIXEL_BLACK;
-			else
-				row[x] = QUIRC_PIXEL_WHITE;
-		}
+		/* black below (100 - THRESHOLD_T)% of the average */
+		quirc_kernels->threshold_row(row, row_average, q->w,
+					     100 - THRESHOLD_T,
+					     200 * threshold_s);
 
 		row += q->w;
 	}
 }
 
-static void area_count(void *user_data, int y, int left, int right)
-{
-	(void)y;
-	
-	((struct quirc_region *)user_data)->count += right - left + 1;
-}
-
 static int region_code(struct quirc *q, int x, int y)
 {
-	int pixel;
 	struct quirc_region *box;
+	struct quirc_run *root;
 	int region;
+	int run;
 
 	if (x < 0 || y < 0 || x >= q->w || y >= q->h)
 		return -1;
 
-	pixel = q->pixels[y * q->w + x];
-
-	if (pixel >= QUIRC_PIXEL_REGION)
-		return pixel;
-
-	if (pixel == QUIRC_PIXEL_WHITE)
+	run = run_at(q, x, y);
+	if (run < 0)
 		return -1;
 
+	root = &q->runs[q->runs[run].parent];
+	if (root->region >= 0)
+		return root->region;
+
 	if (q->num_regions >= QUIRC_MAX_REGIONS)
 		return -1;
 
@@ -381,8 +432,9 @@ static int region_code(struct quirc *q, int x, int y)
 	box->seed.x = x;
 	box->seed.y = y;
 	box->capstone = -1;
-
-	flood_fill_seed(q, x, y, pixel, region, area_count, box);
+	box->count = root->count;
+	box->run = q->runs[run].parent;
+	root->region = region;
 
 	return region;
 }
@@ -450,9 +502,7 @@ static void find_region_corners(struct quirc *q,
 
 	memcpy(&psd.ref, ref, sizeof(psd.ref));
 	psd.scores[0] = -1;
-	flood_fill_seed(q, region->seed.x, region->seed.y,
-			rcode, QUIRC_PIXEL_BLACK,
-			find_one_corner, &psd);
+	region_spans(q, rcode, find_one_corner, &psd);
 
 	psd.ref.x = psd.corners[0].x - psd.ref.x;
 	psd.ref.y = psd.corners[0].y - psd.ref.y;
@@ -468,9 +518,7 @@ static void find_region_corners(struct quirc *q,
 	psd.scores[1] = i;
 	psd.scores[3] = -i;
 
-	flood_fill_seed(q, region->seed.x, region->seed.y,
-			QUIRC_PIXEL_BLACK, rcode,
-			find_other_corners, &psd);
+	region_spans(q, rcode, find_other_corners, &psd);
 }
 
 static void record_capstone(struct quirc *q, int ring, int stone)
@@ -1081,12 +1129,8 @@ static void record_qr_grid(struct quirc *q, int a, int b, int c)
 			psd.scores[0] = -hd.y * qr->align.x +
 				hd.x * qr->align.y;
 
-			flood_fill_seed(q, reg->seed.x, reg->seed.y,
-					qr->align_region, QUIRC_PIXEL_BLACK,
-					NULL, NULL);
-			flood_fill_seed(q, reg->seed.x, reg->seed.y,
-					QUIRC_PIXEL_BLACK, qr->align_region,
-					find_leftmost_to_line, &psd);
+			region_spans(q, qr->align_region,
+				     find_leftmost_to_line, &psd);
 		}
 	}
 
@@ -1226,6 +1270,7 @@ void quirc_end(struct quirc *q)
 
 	pixels_setup(q);
 	threshold(q);
+	label_regions(q);
 
 	for (i = 0; i < q->h; i++)
 		finder_scan(q, i);
@@ -1234,6 +1279,39 @@ void quirc_end(struct quirc *q)
 		test_grouping(q, i);
 }
 
+int quirc_save_geometry(const struct quirc *q, int index,
+			struct quirc_geometry *geo)
+{
+	const struct quirc_grid *qr;
+
+	if (index < 0 || index >= q->num_grids)
+		return -1;
+
+	qr = &q->grids[index];
+	geo->grid_size = qr->grid_size;
+	memcpy(geo->c, qr->c, sizeof(geo->c));
+
+	return 0;
+}
+
+void quirc_end_with_geometry(struct quirc *q,
+			     const struct quirc_geometry *geo)
+{
+	struct quirc_grid *qr = &q->grids[0];
+
+	pixels_setup(q);
+	threshold(q);
+
+	memset(qr, 0, sizeof(*qr));
+	qr->caps[0] = qr->caps[1] = qr->caps[2] = -1;
+	qr->align_region = -1;
+	qr->grid_size = geo->grid_size;
+	memcpy(qr->c, geo->c, sizeof(qr->c));
+
+	q->num_capstones = 0;
+	q->num_grids = 1;
+}
+
 void quirc_extract(const struct quirc *q, int index,
 		   struct quirc_code *code)
 {
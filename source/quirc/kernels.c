@@ -0,0 +1,270 @@
+/* quirc -- QR-code recognition library
+ * Copyright (C) 2010-2012 Daniel Beer <dlbeer@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include "quirc_internal.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+
+/************************************************************************
+ * Scalar kernels
+ */
+
+static inline uint8_t rgb565_luma(uint16_t pixel)
+{
+	uint32_t r = (pixel >> 11) & 0x1f;
+	uint32_t g = (pixel >> 5) & 0x3f;
+	uint32_t b = pixel & 0x1f;
+
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+
+	return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+static void rgb565_to_luma_scalar(uint8_t *dst, const uint16_t *src,
+				  int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		dst[i] = rgb565_luma(src[i]);
+}
+
+/* A pixel is black when it is below num / den of its row average. The
+ * comparison is done as (pixel + 1) * den <= average * num, which is the
+ * same test for integers but needs no divide.
+ */
+static void threshold_row_scalar(quirc_pixel_t *row, const int *row_average,
+				 int w, int num, int den)
+{
+	int x;
+
+	for (x = 0; x < w; x++) {
+		if ((row[x] + 1) * den <= row_average[x] * num)
+			row[x] = QUIRC_PIXEL_BLACK;
+		else
+			row[x] = QUIRC_PIXEL_WHITE;
+	}
+}
+
+/************************************************************************
+ * SWAR kernels: two 16-bit lanes in a 32-bit word. Every lane product is
+ * below 65536, so lanes never carry into each other. This is the fast
+ * path on CPUs without vector units, such as the 3DS's ARM11.
+ */
+
+static void rgb565_to_luma_swar(uint8_t *dst, const uint16_t *src, int count)
+{
+	int i = 0;
+
+	for (; i + 2 <= count; i += 2) {
+		uint32_t p = src[i] | ((uint32_t)src[i + 1] << 16);
+		uint32_t r = (p >> 11) & 0x001f001f;
+		uint32_t g = (p >> 5) & 0x003f003f;
+		uint32_t b = p & 0x001f001f;
+		uint32_t y;
+
+		/* the right shifts pull bits over from the upper lane */
+		r = (r << 3) | ((r >> 2) & 0x00070007);
+		g = (g << 2) | ((g >> 4) & 0x00030003);
+		b = (b << 3) | ((b >> 2) & 0x00070007);
+
+		y = r * 77 + g * 150 + b * 29;
+		dst[i] = (y >> 8) & 0xff;
+		dst[i + 1] = y >> 24;
+	}
+
+	for (; i < count; i++)
+		dst[i] = rgb565_luma(src[i]);
+}
+
+/************************************************************************
+ * SSE2 kernels
+ */
+
+#ifdef HAVE_SSE2
+static void rgb565_to_luma_sse2(uint8_t *dst, const uint16_t *src, int count)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1f);
+	const __m128i mask6 = _mm_set1_epi16(0x3f);
+	const __m128i kr = _mm_set1_epi16(77);
+	const __m128i kg = _mm_set1_epi16(150);
+	const __m128i kb = _mm_set1_epi16(29);
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i y[2];
+		int k;
+
+		for (k = 0; k < 2; k++) {
+			__m128i p = _mm_loadu_si128((const __m128i *)(src + i + k * 8));
+			__m128i r = _mm_and_si128(_mm_srli_epi16(p, 11), mask5);
+			__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+			__m128i b = _mm_and_si128(p, mask5);
+
+			r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+			g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+			b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+			y[k] = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, kr),
+							   _mm_mullo_epi16(g, kg)),
+					     _mm_mullo_epi16(b, kb));
+			y[k] = _mm_srli_epi16(y[k], 8);
+		}
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(y[0], y[1]));
+	}
+
+	for (; i < count; i++)
+		dst[i] = rgb565_luma(src[i]);
+}
+
+/* The row average is at most 2 * 255 * threshold_s while den is
+ * 200 * threshold_s, so both sides of the comparison stay below
+ * 256 * den. While that is under 2^24 single precision floats hold them
+ * exactly; wider images use the scalar kernel.
+ */
+static void threshold_row_sse2(quirc_pixel_t *row, const int *row_average,
+			       int w, int num, int den)
+{
+	const __m128 fnum = _mm_set1_ps((float)num);
+	const __m128 fden = _mm_set1_ps((float)den);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i zero = _mm_setzero_si128();
+	int x = 0;
+
+	if (sizeof(*row) != 1 || (float)den * 256.0f >= 16777216.0f) {
+		threshold_row_scalar(row, row_average, w, num, den);
+		return;
+	}
+
+	for (; x + 16 <= w; x += 16) {
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i lo = _mm_unpacklo_epi8(pixels, zero);
+		__m128i hi = _mm_unpackhi_epi8(pixels, zero);
+		__m128i p[4];
+		__m128i black[4];
+		int k;
+
+		p[0] = _mm_unpacklo_epi16(lo, zero);
+		p[1] = _mm_unpackhi_epi16(lo, zero);
+		p[2] = _mm_unpacklo_epi16(hi, zero);
+		p[3] = _mm_unpackhi_epi16(hi, zero);
+
+		for (k = 0; k < 4; k++) {
+			__m128 lhs = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(p[k], one)), fden);
+			__m128i avg = _mm_loadu_si128((const __m128i *)(row_average + x + k * 4));
+			__m128 rhs = _mm_mul_ps(_mm_cvtepi32_ps(avg), fnum);
+
+			/* all ones where black, masked down to QUIRC_PIXEL_BLACK */
+			black[k] = _mm_and_si128(_mm_castps_si128(_mm_cmple_ps(lhs, rhs)), one);
+		}
+
+		_mm_storeu_si128((__m128i *)(row + x),
+				 _mm_packus_epi16(_mm_packs_epi32(black[0], black[1]),
+						  _mm_packs_epi32(black[2], black[3])));
+	}
+
+	threshold_row_scalar(row + x, row_average + x, w - x, num, den);
+}
+#endif
+
+/************************************************************************
+ * Kernel selection
+ */
+
+static const struct quirc_kernels scalar_kernels = {
+	QUIRC_KERNEL_SCALAR,
+	rgb565_to_luma_scalar,
+	threshold_row_scalar
+};
+
+static const struct quirc_kernels swar_kernels = {
+	QUIRC_KERNEL_SWAR,
+	rgb565_to_luma_swar,
+	threshold_row_scalar
+};
+
+#ifdef HAVE_SSE2
+static const struct quirc_kernels sse2_kernels = {
+	QUIRC_KERNEL_SSE2,
+	rgb565_to_luma_sse2,
+	threshold_row_sse2
+};
+#endif
+
+const struct quirc_kernels *quirc_kernels = &swar_kernels;
+static int kernel_chosen;
+
+static int cpu_has_sse2(void)
+{
+#if defined(HAVE_SSE2) && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#elif defined(HAVE_SSE2)
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+quirc_kernel_t quirc_select_kernel(quirc_kernel_t kernel)
+{
+	kernel_chosen = 1;
+
+	if (kernel == QUIRC_KERNEL_AUTO)
+		kernel = cpu_has_sse2() ? QUIRC_KERNEL_SSE2 :
+					  QUIRC_KERNEL_SWAR;
+
+	switch (kernel) {
+	case QUIRC_KERNEL_SCALAR:
+		quirc_kernels = &scalar_kernels;
+		break;
+
+	case QUIRC_KERNEL_SWAR:
+		quirc_kernels = &swar_kernels;
+		break;
+
+#ifdef HAVE_SSE2
+	case QUIRC_KERNEL_SSE2:
+		if (cpu_has_sse2())
+			quirc_kernels = &sse2_kernels;
+		break;
+#endif
+
+	default:
+		break;
+	}
+
+	return quirc_kernels->kernel;
+}
+
+void quirc_kernels_init(void)
+{
+	if (!kernel_chosen)
+		quirc_select_kernel(QUIRC_KERNEL_AUTO);
+}
+
+void quirc_rgb565_to_luma(uint8_t *dst, const uint16_t *src, int count)
+{
+	quirc_kernels_init();
+	quirc_kernels->rgb565_to_luma(dst, src, count);
+}
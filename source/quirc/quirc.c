@@ -31,6 +31,7 @@ struct quirc *quirc_new(void)
 		return NULL;
 
 	memset(q, 0, sizeof(*q));
+	quirc_kernels_init();
 	return q;
 }
 
@@ -40,6 +41,8 @@ void quirc_destroy(struct quirc *q)
 		free(q->image);
 	if (sizeof(*q->image) != sizeof(*q->pixels))
 		free(q->pixels);
+	free(q->runs);
+	free(q->row_runs);
 
 	free(q);
 }
@@ -47,9 +50,16 @@ void quirc_destroy(struct quirc *q)
 int quirc_resize(struct quirc *q, int w, int h)
 {
 	uint8_t *new_image = realloc(q->image, w * h);
+	int *new_row_runs;
 
 	if (!new_image)
 		return -1;
+	q->image = new_image;
+
+	new_row_runs = realloc(q->row_runs, (h + 1) * sizeof(int));
+	if (!new_row_runs)
+		return -1;
+	q->row_runs = new_row_runs;
 
 	if (sizeof(*q->image) != sizeof(*q->pixels)) {
 		size_t new_size = w * h * sizeof(quirc_pixel_t);
@@ -59,7 +69,6 @@ int quirc_resize(struct quirc *q, int w, int h)
 		q->pixels = new_pixels;
 	}
 
-	q->image = new_image;
 	q->w = w;
 	q->h = h;
 
@@ -0,0 +1,595 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "Bank.hpp"
+#include "FileSystem.hpp"
+#include "PK4.hpp"
+#include "PK5.hpp"
+#include "PK6.hpp"
+#include "PK7.hpp"
+#include "lz.h"
+#include <algorithm>
+
+namespace
+{
+    const char MAGIC[8] = { 'P', 'K', 'S', 'M', 'B', 'A', 'N', 'K' };
+    const char JOURNAL_MAGIC[8] = { 'P', 'K', 'S', 'M', 'J', 'R', 'N', 'L' };
+    constexpr u32 VERSION     = 1;
+    // u8 magic[8], u32 version, u32 boxes, u32 last checkpointed sequence, padded to a sector
+    constexpr u32 HEADER_SIZE = 0x200;
+    // char name[NAME_SIZE], u8 generation[SLOTS], then the slots
+    constexpr u32 GENERATIONS = Bank::NAME_SIZE;
+    constexpr u32 BOX_HEADER  = 0x80;
+    constexpr u32 BOX_SIZE    = 0x1C00;
+    // clean pages are dropped once this many boxes are held in memory
+    constexpr size_t CACHED_BOXES = 64;
+
+    // u8 magic[8], u32 version, u32 reserved
+    constexpr u32 JOURNAL_HEADER = 16;
+    // u32 sequence, u16 box, u8 slot, u8 generation, payload, u32 checksum of everything before it.
+    // The payload is a slot, or the box name when slot is NAME_RECORD.
+    constexpr u32 RECORD_HEADER = 8;
+    constexpr u8  NAME_RECORD   = 0xFF;
+    // edits appended before the journal is flushed
+    constexpr u32 BATCH = 16;
+    // a journal this long gets checkpointed on the next commit
+    constexpr u32 JOURNAL_LIMIT = 0x40000;
+
+    static_assert(GENERATIONS + Bank::SLOTS <= BOX_HEADER, "box header overflows");
+    static_assert(BOX_HEADER + Bank::SLOTS * Bank::SLOT_SIZE <= BOX_SIZE, "box page overflows");
+
+    u32 boxOffset(int box)
+    {
+        return HEADER_SIZE + box * BOX_SIZE;
+    }
+
+    u32 payloadSize(u8 slot)
+    {
+        return slot == NAME_RECORD ? Bank::NAME_SIZE : Bank::SLOT_SIZE;
+    }
+
+    void apply(u8* data, u8 slot, u8 generation, const u8* payload)
+    {
+        if (slot == NAME_RECORD)
+        {
+            std::copy(payload, payload + Bank::NAME_SIZE, data);
+        }
+        else
+        {
+            data[GENERATIONS + slot] = generation;
+            std::copy(payload, payload + Bank::SLOT_SIZE, data + BOX_HEADER + slot * Bank::SLOT_SIZE);
+        }
+    }
+}
+
+Bank::Bank(FS_Archive archive, const std::u16string& path, int boxes)
+    : mStream(archive, path, FS_OPEN_READ | FS_OPEN_WRITE | FS_OPEN_CREATE),
+      mJournal{FSStream(archive, path + u".journal0", FS_OPEN_READ | FS_OPEN_WRITE | FS_OPEN_CREATE),
+               FSStream(archive, path + u".journal1", FS_OPEN_READ | FS_OPEN_WRITE | FS_OPEN_CREATE)},
+      mBoxes(boxes), mResult(0), mGood(false), mHeaderDirty(false), mClosed(false), mFailed(false), mActive(0),
+      mJournalEnd{JOURNAL_HEADER, JOURNAL_HEADER}, mJournalLast{0, 0}, mPending(0), mSequence(0), mCheckpointed(0)
+{
+    if (!mStream.good() || !mJournal[0].good() || !mJournal[1].good())
+    {
+        for (FSStream* stream : {&mStream, &mJournal[0], &mJournal[1]})
+        {
+            if (stream->good())
+            {
+                stream->close();
+            }
+            else
+            {
+                mResult = stream->result();
+            }
+        }
+        mClosed = true;
+        return;
+    }
+    // checkpoints write dirty boxes in ascending order, neighbours reach the card as one write
+    mStream.buffer(FSStream::FLUSH_ON_DEMAND);
+    mJournal[0].buffer(FSStream::FLUSH_ON_DEMAND);
+    mJournal[1].buffer(FSStream::FLUSH_ON_DEMAND);
+
+    u8 header[20] = {0};
+    if (mStream.size() == 0)
+    {
+        mHeaderDirty = true;
+    }
+    else if (mStream.read(header, 20) != 20 || !std::equal(MAGIC, MAGIC + 8, header) || *(u32*)(header + 8) != VERSION)
+    {
+        // not ours, leave it alone
+        return;
+    }
+    else if (*(u32*)(header + 12) != (u32)boxes)
+    {
+        // boxes past the end of the file are empty, so resizing is just a new count
+        mHeaderDirty = true;
+    }
+    mCheckpointed = mSequence = *(u32*)(header + 16);
+
+    mGood = true;
+    // both can hold edits the bank file misses if a checkpoint was interrupted, the older goes first
+    u32 first0 = firstSequence(0);
+    u32 first1 = firstSequence(1);
+    int older = first1 != 0 && (first0 == 0 || first1 < first0) ? 1 : 0;
+    replay(older);
+    replay(older ^ 1);
+    mActive = older ^ 1;
+    trim();
+    if (dirty())
+    {
+        checkpoint();
+    }
+}
+
+Bank::~Bank(void)
+{
+    if (!mClosed)
+    {
+        close();
+    }
+}
+
+u32 Bank::firstSequence(int journal)
+{
+    u8 record[RECORD_HEADER];
+    mJournal[journal].seek(JOURNAL_HEADER);
+    if (mJournal[journal].read(record, RECORD_HEADER) != RECORD_HEADER)
+    {
+        return 0;
+    }
+    return *(u32*)record;
+}
+
+void Bank::replay(int journal)
+{
+    FSStream& stream = mJournal[journal];
+    u8 header[JOURNAL_HEADER] = {0};
+    stream.seek(0);
+    if (stream.size() < JOURNAL_HEADER || stream.read(header, JOURNAL_HEADER) != JOURNAL_HEADER ||
+        !std::equal(JOURNAL_MAGIC, JOURNAL_MAGIC + 8, header) || *(u32*)(header + 8) != VERSION)
+    {
+        // new, or too damaged to trust any of it
+        std::fill_n(header, JOURNAL_HEADER, 0);
+        std::copy(JOURNAL_MAGIC, JOURNAL_MAGIC + 8, header);
+        *(u32*)(header + 8) = VERSION;
+        stream.resize(JOURNAL_HEADER);
+        stream.seek(0);
+        stream.write(header, JOURNAL_HEADER);
+        stream.flush();
+        return;
+    }
+
+    u8 record[RECORD_HEADER + SLOT_SIZE + 4];
+    u32& end = mJournalEnd[journal];
+    while (true)
+    {
+        stream.seek(end);
+        if (stream.read(record, RECORD_HEADER) != RECORD_HEADER)
+        {
+            break;
+        }
+        u8 slot = record[6];
+        u32 length = payloadSize(slot);
+        if ((slot >= SLOTS && slot != NAME_RECORD) || stream.read(record + RECORD_HEADER, length + 4) != length + 4 ||
+            lz_checksum(record, RECORD_HEADER + length) != *(u32*)(record + RECORD_HEADER + length))
+        {
+            // torn by a crash mid-append, nothing after it made it either
+            break;
+        }
+
+        u32 sequence = *(u32*)record;
+        if (sequence > mCheckpointed)
+        {
+            int box = *(u16*)(record + 4);
+            apply(page(box), slot, record[7], record + RECORD_HEADER);
+            mPages[box].dirty = true;
+        }
+        mSequence = std::max(mSequence, sequence);
+        mJournalLast[journal] = sequence;
+        end += RECORD_HEADER + length + 4;
+    }
+
+    if (end < stream.size())
+    {
+        stream.resize(end);
+    }
+}
+
+u8* Bank::page(int box)
+{
+    io::CallSite site("Bank::page");
+    auto i = mPages.find(box);
+    if (i != mPages.end())
+    {
+        return i->second.data.get();
+    }
+
+    evict();
+    Page& page = mPages[box];
+    page.data = std::unique_ptr<u8[]>(new u8[BOX_SIZE]);
+    page.dirty = false;
+    mMutex.lock();
+    mStream.seek(boxOffset(box));
+    u32 read = mStream.eof() ? 0 : mStream.read(page.data.get(), BOX_SIZE);
+    mMutex.unlock();
+    std::fill(page.data.get() + read, page.data.get() + BOX_SIZE, 0);
+    return page.data.get();
+}
+
+void Bank::evict(void)
+{
+    // a page dropped now could be read back before the running checkpoint wrote it
+    if (mPages.size() < CACHED_BOXES || mCheckpoint)
+    {
+        return;
+    }
+    for (auto i = mPages.begin(); i != mPages.end();)
+    {
+        if (i->second.dirty)
+        {
+            ++i;
+        }
+        else
+        {
+            i = mPages.erase(i);
+        }
+    }
+}
+
+void Bank::append(int box, u8 slot, u8 generation, const u8* payload)
+{
+    io::CallSite site("Bank::append");
+    u8* data = page(box);
+    apply(data, slot, generation, payload);
+    mPages[box].dirty = true;
+    if (mIndex && slot != NAME_RECORD)
+    {
+        mIndex->update(box * SLOTS + slot, pkm(box, slot).get());
+    }
+    if (!mGood)
+    {
+        return;
+    }
+
+    u32 length = payloadSize(slot);
+    u8 record[RECORD_HEADER + SLOT_SIZE + 4];
+    *(u32*)record = ++mSequence;
+    *(u16*)(record + 4) = box;
+    record[6] = slot;
+    record[7] = generation;
+    std::copy(payload, payload + length, record + RECORD_HEADER);
+    *(u32*)(record + RECORD_HEADER + length) = lz_checksum(record, RECORD_HEADER + length);
+
+    FSStream& journal = mJournal[mActive];
+    journal.seek(mJournalEnd[mActive]);
+    if (journal.write(record, RECORD_HEADER + length + 4) != RECORD_HEADER + length + 4)
+    {
+        mResult = journal.result();
+        return;
+    }
+    mJournalEnd[mActive] += RECORD_HEADER + length + 4;
+    mJournalLast[mActive] = mSequence;
+    if (++mPending >= BATCH)
+    {
+        commit();
+    }
+}
+
+std::unique_ptr<PKX> Bank::pkm(int box, int slot)
+{
+    u8* data = page(box);
+    u8* pk = data + BOX_HEADER + slot * SLOT_SIZE;
+    switch (data[GENERATIONS + slot])
+    {
+        case 4:
+            return std::unique_ptr<PKX>(new PK4(pk));
+        case 5:
+            return std::unique_ptr<PKX>(new PK5(pk));
+        case 6:
+            return std::unique_ptr<PKX>(new PK6(pk));
+        case 7:
+            return std::unique_ptr<PKX>(new PK7(pk));
+    }
+    return nullptr;
+}
+
+void Bank::pkm(const PKX& pk, int box, int slot)
+{
+    if (pk.species() == 0)
+    {
+        clear(box, slot);
+        return;
+    }
+
+    u8 data[SLOT_SIZE] = {0};
+    std::copy(pk.rawData(), pk.rawData() + pk.rawLength(), data);
+    append(box, slot, pk.generation(), data);
+}
+
+void Bank::clear(int box, int slot)
+{
+    if (generation(box, slot) != 0)
+    {
+        u8 data[SLOT_SIZE] = {0};
+        append(box, slot, 0, data);
+    }
+}
+
+u8 Bank::generation(int box, int slot)
+{
+    return page(box)[GENERATIONS + slot];
+}
+
+const u8* Bank::slotData(int box, int slot)
+{
+    return page(box) + BOX_HEADER + slot * SLOT_SIZE;
+}
+
+std::string Bank::boxName(int box)
+{
+    const char* name = (const char*)page(box);
+    return std::string(name, std::find(name, name + NAME_SIZE, '\0'));
+}
+
+void Bank::boxName(int box, const std::string& name)
+{
+    u8 data[NAME_SIZE] = {0};
+    std::copy(name.begin(), name.begin() + std::min(name.size(), (size_t)NAME_SIZE - 1), data);
+    append(box, NAME_RECORD, 0, data);
+}
+
+const BankIndex& Bank::index(void)
+{
+    if (!mIndex)
+    {
+        mIndex = std::unique_ptr<BankIndex>(new BankIndex);
+        for (int box = 0; box < mBoxes; box++)
+        {
+            for (u32 slot = 0; slot < SLOTS; slot++)
+            {
+                if (generation(box, slot) != 0)
+                {
+                    mIndex->update(box * SLOTS + slot, pkm(box, slot).get());
+                }
+            }
+        }
+    }
+    return *mIndex;
+}
+
+std::vector<u32> Bank::find(const BankIndex::Query& query)
+{
+    std::vector<u32> ret = index().find(query);
+    if (!query.otName.empty() && query.TID != BankIndex::Query::ANY)
+    {
+        ret.erase(std::remove_if(ret.begin(), ret.end(), [&](u32 slot) {
+            return pkm(slot / SLOTS, slot % SLOTS)->otName() != query.otName;
+        }), ret.end());
+    }
+    return ret;
+}
+
+bool Bank::dirty(void) const
+{
+    if (mHeaderDirty || mSequence != mCheckpointed)
+    {
+        return true;
+    }
+    for (auto& page : mPages)
+    {
+        if (page.second.dirty)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Result Bank::commit(void)
+{
+    io::CallSite site("Bank::commit");
+    if (!mGood)
+    {
+        return mResult;
+    }
+
+    Result res = mJournal[mActive].flush();
+    if (R_FAILED(res))
+    {
+        return mResult = res;
+    }
+    mPending = 0;
+    if (mJournalEnd[mActive] >= JOURNAL_LIMIT)
+    {
+        checkpoint();
+    }
+    return res;
+}
+
+void Bank::checkpoint(void)
+{
+    if (!mGood || !finishCheckpoint(false) || mFailed)
+    {
+        return;
+    }
+
+    std::shared_ptr<Snapshot> snapshot(new Snapshot);
+    for (auto& page : mPages)
+    {
+        if (page.second.dirty)
+        {
+            std::unique_ptr<u8[]> copy(new u8[BOX_SIZE]);
+            std::copy(page.second.data.get(), page.second.data.get() + BOX_SIZE, copy.get());
+            snapshot->pages.emplace_back(page.first, std::move(copy));
+            page.second.dirty = false;
+        }
+    }
+    if (snapshot->pages.empty() && !mHeaderDirty)
+    {
+        trim();
+        return;
+    }
+    std::sort(snapshot->pages.begin(), snapshot->pages.end(),
+        [](const std::pair<int, std::unique_ptr<u8[]>>& a, const std::pair<int, std::unique_ptr<u8[]>>& b) { return a.first < b.first; });
+    snapshot->sequence = mSequence;
+    snapshot->boxes = mBoxes;
+    mHeaderDirty = false;
+
+    // should the checkpoint fail, the journal is all that's left of these edits
+    Result res = mJournal[mActive].flush();
+    if (R_FAILED(res))
+    {
+        mResult = res;
+    }
+    mPending = 0;
+    // later edits go to the other journal if it's free, so this one can be emptied when the checkpoint is done.
+    // Otherwise they stay where they are until a checkpoint covers both.
+    if (mJournalEnd[mActive ^ 1] == JOURNAL_HEADER)
+    {
+        mActive ^= 1;
+    }
+
+    mSnapshot = snapshot;
+    mCheckpoint = Threads::submit([this, snapshot](Threads::Job&) { snapshot->result = write(*snapshot); }, Threads::Priority::LOW);
+}
+
+bool Bank::finishCheckpoint(bool wait)
+{
+    if (!mCheckpoint)
+    {
+        return true;
+    }
+    if (wait)
+    {
+        mCheckpoint->wait();
+    }
+    else if (!mCheckpoint->done())
+    {
+        return false;
+    }
+
+    if (R_FAILED(mSnapshot->result))
+    {
+        mFailed = true;
+        mResult = mSnapshot->result;
+        // bank.bnk still holds the old bytes, so these pages mustn't be evicted and read back from it
+        for (auto& page : mSnapshot->pages)
+        {
+            auto cached = mPages.find(page.first);
+            if (cached == mPages.end())
+            {
+                mPages[page.first].data = std::move(page.second);
+                cached = mPages.find(page.first);
+            }
+            cached->second.dirty = true;
+        }
+        mHeaderDirty = true;
+    }
+    else
+    {
+        mCheckpointed = mSnapshot->sequence;
+    }
+    mCheckpoint = nullptr;
+    mSnapshot = nullptr;
+    trim();
+    return true;
+}
+
+void Bank::trim(void)
+{
+    io::CallSite site("Bank::trim");
+    for (int journal = 0; journal < 2; journal++)
+    {
+        if (mJournalEnd[journal] != JOURNAL_HEADER && mJournalLast[journal] <= mCheckpointed &&
+            R_SUCCEEDED(mJournal[journal].resize(JOURNAL_HEADER)))
+        {
+            mJournalEnd[journal] = JOURNAL_HEADER;
+            if (journal == mActive)
+            {
+                mPending = 0;
+            }
+        }
+    }
+}
+
+Result Bank::write(const Snapshot& snapshot)
+{
+    io::CallSite site("Bank::checkpoint");
+    // the caller only blocks on the stream for a page at a time
+    for (auto& page : snapshot.pages)
+    {
+        mMutex.lock();
+        mStream.seek(boxOffset(page.first));
+        u32 written = mStream.write(page.second.get(), BOX_SIZE);
+        Result res = mStream.result();
+        mMutex.unlock();
+        if (written != BOX_SIZE)
+        {
+            return R_FAILED(res) ? res : -1;
+        }
+    }
+
+    // the header may only claim the pages once they're on the card
+    mMutex.lock();
+    Result res = mStream.flush();
+    if (R_SUCCEEDED(res))
+    {
+        u8 header[HEADER_SIZE] = {0};
+        std::copy(MAGIC, MAGIC + 8, header);
+        *(u32*)(header + 8) = VERSION;
+        *(u32*)(header + 12) = snapshot.boxes;
+        *(u32*)(header + 16) = snapshot.sequence;
+        mStream.seek(0);
+        res = mStream.write(header, HEADER_SIZE) == HEADER_SIZE ? mStream.flush() : -1;
+    }
+    mMutex.unlock();
+    return res;
+}
+
+Result Bank::save(void)
+{
+    Result res = commit();
+    checkpoint();
+    return res;
+}
+
+Result Bank::close(void)
+{
+    io::CallSite site("Bank::close");
+    Result res = commit();
+    finishCheckpoint(true);
+    for (FSStream* stream : {&mStream, &mJournal[0], &mJournal[1]})
+    {
+        Result closed = stream->close();
+        if (R_SUCCEEDED(res))
+        {
+            res = closed;
+        }
+    }
+    mClosed = true;
+    return res;
+}
@@ -0,0 +1,256 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "BankIndex.hpp"
+#include <algorithm>
+
+namespace
+{
+    enum Flags : u8
+    {
+        SHINY = 1 << 0,
+        EGG   = 1 << 1
+    };
+
+    // ANDs mask, or its complement, into words; mask is zero past its end
+    void intersect(std::vector<u32>& words, const std::vector<u32>& mask, bool complement)
+    {
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            u32 m = i < mask.size() ? mask[i] : 0;
+            words[i] &= complement ? ~m : m;
+        }
+    }
+}
+
+void BankIndex::Bitmap::set(u32 bit, bool v)
+{
+    if (bit / 32 >= mWords.size())
+    {
+        if (!v)
+        {
+            return;
+        }
+        mWords.resize(bit / 32 + 1, 0);
+    }
+    if (v)
+    {
+        mWords[bit / 32] |= 1u << (bit % 32);
+    }
+    else
+    {
+        mWords[bit / 32] &= ~(1u << (bit % 32));
+    }
+}
+
+void BankIndex::insert(std::vector<u32>& list, u32 slot)
+{
+    // slots are mostly indexed in order, appending is the common case
+    if (list.empty() || list.back() < slot)
+    {
+        list.push_back(slot);
+    }
+    else
+    {
+        auto i = std::lower_bound(list.begin(), list.end(), slot);
+        if (i == list.end() || *i != slot)
+        {
+            list.insert(i, slot);
+        }
+    }
+}
+
+void BankIndex::erase(std::vector<u32>& list, u32 slot)
+{
+    auto i = std::lower_bound(list.begin(), list.end(), slot);
+    if (i != list.end() && *i == slot)
+    {
+        list.erase(i);
+    }
+}
+
+u32 BankIndex::trainer(const std::string& otName, u16 TID)
+{
+    // FNV-1a; a collision only costs the caller a slot it has to check
+    u32 hash = 2166136261u;
+    for (char c : otName)
+    {
+        hash = (hash ^ (u8)c) * 16777619u;
+    }
+    hash = (hash ^ (TID & 0xFF)) * 16777619u;
+    return (hash ^ (TID >> 8)) * 16777619u;
+}
+
+void BankIndex::index(u32 slot, const Entry& entry, bool v)
+{
+    Postings* postings[] = { &mSpecies, &mAbilities, &mTrainers };
+    u32 keys[] = { entry.species, entry.ability, entry.trainer };
+    for (int i = 0; i < 3; i++)
+    {
+        std::vector<u32>& list = (*postings[i])[keys[i]];
+        if (v)
+        {
+            insert(list, slot);
+        }
+        else
+        {
+            erase(list, slot);
+            if (list.empty())
+            {
+                postings[i]->erase(keys[i]);
+            }
+        }
+    }
+
+    mOccupied.set(slot, v);
+    mShiny.set(slot, v && (entry.flags & SHINY));
+    mEgg.set(slot, v && (entry.flags & EGG));
+    mBalls[entry.ball].set(slot, v);
+    mGenders[entry.gender].set(slot, v);
+    mGenerations[entry.generation].set(slot, v);
+}
+
+void BankIndex::update(u32 slot, PKX* pk)
+{
+    if (slot >= mEntries.size())
+    {
+        mEntries.resize(slot + 1, Entry{});
+    }
+    if (mEntries[slot].generation != 0)
+    {
+        index(slot, mEntries[slot], false);
+    }
+
+    Entry entry = {};
+    if (pk && pk->species() != 0)
+    {
+        entry.trainer    = trainer(pk->otName(), pk->TID());
+        entry.species    = pk->species();
+        entry.ability    = pk->ability();
+        entry.ball       = pk->ball();
+        entry.gender     = pk->gender();
+        entry.generation = pk->generation();
+        entry.flags      = (pk->shiny() ? SHINY : 0) | (pk->egg() ? EGG : 0);
+        index(slot, entry, true);
+    }
+    mEntries[slot] = entry;
+}
+
+const BankIndex::Bitmap* BankIndex::bitmap(const std::unordered_map<int, Bitmap>& bitmaps, int value) const
+{
+    auto i = bitmaps.find(value);
+    return i == bitmaps.end() ? nullptr : &i->second;
+}
+
+std::vector<u32> BankIndex::find(const Query& query) const
+{
+    std::vector<u32> ret;
+    const bool byTrainer = !query.otName.empty() && query.TID != Query::ANY;
+    const u32 trainerKey = byTrainer ? trainer(query.otName, query.TID) : 0;
+
+    // the shortest posting list that applies bounds the candidates
+    const std::vector<u32>* candidates = nullptr;
+    const Postings* postings[] = { &mSpecies, &mAbilities, &mTrainers };
+    const bool used[] = { query.species != Query::ANY, query.ability != Query::ANY, byTrainer };
+    const u32 keys[] = { (u32)query.species, (u32)query.ability, trainerKey };
+    for (int i = 0; i < 3; i++)
+    {
+        if (!used[i])
+        {
+            continue;
+        }
+        auto list = postings[i]->find(keys[i]);
+        if (list == postings[i]->end())
+        {
+            return ret;
+        }
+        if (!candidates || list->second.size() < candidates->size())
+        {
+            candidates = &list->second;
+        }
+    }
+
+    const Bitmap* ball = query.ball != Query::ANY ? bitmap(mBalls, query.ball) : nullptr;
+    const Bitmap* gender = query.gender != Query::ANY ? bitmap(mGenders, query.gender) : nullptr;
+    const Bitmap* generation = query.generation != Query::ANY ? bitmap(mGenerations, query.generation) : nullptr;
+    if ((query.ball != Query::ANY && !ball) || (query.gender != Query::ANY && !gender) ||
+        (query.generation != Query::ANY && !generation))
+    {
+        return ret;
+    }
+
+    if (candidates)
+    {
+        // the other lists are checked through the entries, the bitmaps directly
+        for (u32 slot : *candidates)
+        {
+            const Entry& entry = mEntries[slot];
+            if ((used[0] && entry.species != keys[0]) || (used[1] && entry.ability != keys[1]) ||
+                (used[2] && entry.trainer != keys[2]) || (ball && !ball->test(slot)) ||
+                (gender && !gender->test(slot)) || (generation && !generation->test(slot)) ||
+                (query.shiny != Query::ANY && mShiny.test(slot) != (query.shiny != 0)) ||
+                (query.egg != Query::ANY && mEgg.test(slot) != (query.egg != 0)))
+            {
+                continue;
+            }
+            ret.push_back(slot);
+        }
+        return ret;
+    }
+
+    // bitmaps only: AND them a word at a time, then walk the bits left
+    std::vector<u32> words = mOccupied.words();
+    if (ball)
+    {
+        intersect(words, ball->words(), false);
+    }
+    if (gender)
+    {
+        intersect(words, gender->words(), false);
+    }
+    if (generation)
+    {
+        intersect(words, generation->words(), false);
+    }
+    if (query.shiny != Query::ANY)
+    {
+        intersect(words, mShiny.words(), query.shiny == 0);
+    }
+    if (query.egg != Query::ANY)
+    {
+        intersect(words, mEgg.words(), query.egg == 0);
+    }
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        u32 word = words[i];
+        while (word)
+        {
+            ret.push_back(i * 32 + __builtin_ctz(word));
+            word &= word - 1;
+        }
+    }
+    return ret;
+}
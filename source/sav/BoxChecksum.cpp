@@ -0,0 +1,129 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "BoxChecksum.hpp"
+
+namespace
+{
+    constexpr u32 MULT = 0x41C64E6D;
+    constexpr u32 ADD  = 0x6073;
+
+    // Re-keys a gen 4/5 record: its checksum is the seed of its own XOR stream
+    void rekey(u8* record, u32 words, u16 checksum)
+    {
+        u32 oldSeed = *(u16*)(record + 0x06);
+        u32 newSeed = checksum;
+        for (u32 i = 0; i < words; i++)
+        {
+            oldSeed = oldSeed * MULT + ADD;
+            newSeed = newSeed * MULT + ADD;
+            *(u16*)(record + 0x08 + i * 2) ^= (oldSeed >> 16) ^ (newSeed >> 16);
+        }
+        *(u16*)(record + 0x06) = checksum;
+    }
+}
+
+void BoxChecksum::scan(Report& report, u8* data, u32 stride, u8 generation, int count, bool encrypted, bool repair, u32 first)
+{
+    if (generation < 4 || generation > 7 || count <= 0)
+    {
+        return;
+    }
+    if (count > MAX_SLOTS)
+    {
+        count = MAX_SLOTS;
+    }
+
+    // words after the 8 byte header, stored boxes don't hold the party stats
+    const u32 words = generation >= 6 ? (232 - 8) / 2 : (136 - 8) / 2;
+    u32 seed[MAX_SLOTS];
+    u32 sum[MAX_SLOTS];
+    u32 any[MAX_SLOTS];
+
+    for (int slot = 0; slot < count; slot++)
+    {
+        const u8* record = data + slot * stride;
+        // gen 6/7 are keyed by the encryption constant, gen 4/5 by the checksum itself
+        seed[slot] = generation >= 6 ? *(u32*)record : *(u16*)(record + 0x06);
+        sum[slot]  = 0;
+        any[slot]  = *(u32*)record | *(u32*)(record + 0x04);
+    }
+
+    for (u32 i = 0; i < words; i++)
+    {
+        const u32 offset = 0x08 + i * 2;
+        if (encrypted)
+        {
+            for (int slot = 0; slot < count; slot++)
+            {
+                u16 word = *(u16*)(data + slot * stride + offset);
+                seed[slot] = seed[slot] * MULT + ADD;
+                sum[slot] += word ^ (seed[slot] >> 16);
+                any[slot] |= word;
+            }
+        }
+        else
+        {
+            for (int slot = 0; slot < count; slot++)
+            {
+                u16 word = *(u16*)(data + slot * stride + offset);
+                sum[slot] += word;
+                any[slot] |= word;
+            }
+        }
+    }
+
+    for (int slot = 0; slot < count; slot++)
+    {
+        report.scanned++;
+        if (!any[slot])
+        {
+            report.empty++;
+            continue;
+        }
+
+        u8* record = data + slot * stride;
+        u16 checksum = sum[slot];
+        if (*(u16*)(record + 0x06) == checksum)
+        {
+            continue;
+        }
+
+        report.corrupt.push_back(first + slot);
+        if (repair)
+        {
+            if (encrypted && generation <= 5)
+            {
+                rekey(record, words, checksum);
+            }
+            else
+            {
+                *(u16*)(record + 0x06) = checksum;
+            }
+            report.repaired++;
+        }
+    }
+}
@@ -0,0 +1,183 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "PatchPlan.hpp"
+#include <algorithm>
+#include <cstring>
+
+static const char* MAGIC = "PKSMSCRIPT";
+// a replicated write is only expanded into a literal to merge it when it stays this small
+static constexpr u32 MERGE_LIMIT = 0x1000;
+
+// pattern may already sit at dst, as when a merged write widens its own pool entry
+static void replicate(u8* dst, const u8* pattern, u32 patternLength, u32 length)
+{
+    if (dst != pattern)
+    {
+        std::copy(pattern, pattern + patternLength, dst);
+    }
+    u32 filled = patternLength;
+    while (filled < length)
+    {
+        u32 chunk = std::min(filled, length - filled);
+        std::copy(dst, dst + chunk, dst + filled);
+        filled += chunk;
+    }
+}
+
+PatchPlan::PatchPlan(const u8* script, size_t size, const Sav& save)
+{
+    mStatus = OK;
+    const size_t magicLength = strlen(MAGIC);
+    if (size < magicLength || memcmp(script, MAGIC, magicLength) != 0)
+    {
+        mStatus = BAD_MAGIC;
+        return;
+    }
+
+    // gen 4 scripts address the storage partition relative to sbo and everything else relative to gbo
+    const bool relocate = save.generation() == 4;
+    const u32 sbo = save.storageOffset();
+    const u32 gbo = save.generalOffset();
+    const u32 storageStart = relocate ? save.boxOffset(0, 0) - sbo : 0;
+    const u32 storageEnd = relocate ? save.boxOffset(save.boxes, 0) - sbo : 0;
+
+    size_t index = magicLength;
+    while (index < size)
+    {
+        if (size - index < 8)
+        {
+            mStatus = TRUNCATED;
+            break;
+        }
+        u32 offset = *(u32*)(script + index);
+        u32 length = *(u32*)(script + index + 4);
+        if (size - index - 8 < (u64)length + 4)
+        {
+            mStatus = TRUNCATED;
+            break;
+        }
+        const u8* payload = script + index + 8;
+        u32 repeat = *(u32*)(payload + length);
+        index += 12 + length;
+
+        if (relocate)
+        {
+            offset += storageStart <= offset && storageEnd >= offset ? sbo : gbo;
+        }
+
+        if ((u64)offset + (u64)length * repeat > save.length)
+        {
+            mStatus = OUT_OF_BOUNDS;
+            break;
+        }
+        if (length != 0 && repeat != 0)
+        {
+            push(offset, payload, length, repeat);
+        }
+    }
+
+    if (mStatus != OK)
+    {
+        mWrites.clear();
+        mPool.clear();
+        return;
+    }
+    markDirty(save);
+}
+
+void PatchPlan::push(u32 offset, const u8* payload, u32 length, u32 repeat)
+{
+    const u32 total = length * repeat;
+    if (!mWrites.empty())
+    {
+        // the previous write's pattern is always the tail of the pool, so it can grow in place
+        Write& last = mWrites.back();
+        const u32 lastEnd = last.offset + last.length;
+        const u32 end = std::max(lastEnd, offset + total);
+        const bool literal = last.pattern == last.length && repeat == 1;
+        if (offset >= last.offset && offset <= lastEnd && (literal || end - last.offset <= MERGE_LIMIT))
+        {
+            mPool.resize(last.payload + (end - last.offset));
+            if (last.pattern != last.length)
+            {
+                replicate(mPool.data() + last.payload, mPool.data() + last.payload, last.pattern, last.length);
+            }
+            replicate(mPool.data() + last.payload + (offset - last.offset), payload, length, total);
+            last.length = last.pattern = end - last.offset;
+            return;
+        }
+    }
+
+    mWrites.push_back({offset, total, (u32)mPool.size(), length});
+    mPool.insert(mPool.end(), payload, payload + length);
+}
+
+void PatchPlan::markDirty(const Sav& save)
+{
+    // collapse the writes into disjoint sorted ranges, then look each block up in them
+    std::vector<std::pair<u32, u32>> ranges;
+    for (auto& write : mWrites)
+    {
+        ranges.push_back(std::make_pair(write.offset, write.offset + write.length));
+    }
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<u32, u32>> merged;
+    for (auto& range : ranges)
+    {
+        if (!merged.empty() && range.first <= merged.back().second)
+        {
+            merged.back().second = std::max(merged.back().second, range.second);
+        }
+        else
+        {
+            merged.push_back(range);
+        }
+    }
+
+    std::vector<Sav::Block> blocks = save.blocks();
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        const u32 start = blocks[i].offset;
+        const u32 end = blocks[i].offset + blocks[i].length;
+        // first range ending after the block starts
+        auto it = std::upper_bound(merged.begin(), merged.end(), start, [](u32 value, const std::pair<u32, u32>& range) {
+            return value < range.second;
+        });
+        if (it != merged.end() && it->first < end)
+        {
+            mDirty.push_back(i);
+        }
+    }
+}
+
+void PatchPlan::apply(Sav& save) const
+{
+    for (auto& write : mWrites)
+    {
+        replicate(save.data + write.offset, mPool.data() + write.payload, write.pattern, write.length);
+    }
+}
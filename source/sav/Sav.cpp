@@ -34,6 +34,8 @@
 #include "SavSUMO.hpp"
 #include "SavUSUM.hpp"
 #include "SavXY.hpp"
+#include "Schema.hpp"
+#include <numeric>
 
 const u16 Sav::crc16[256] = {
         0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
@@ -89,6 +91,37 @@ u16 Sav::ccitt16(const u8* buf, u32 len)
     return crc;
 }
 
+void Sav::resign(void)
+{
+    std::vector<size_t> all(blocks().size());
+    std::iota(all.begin(), all.end(), 0);
+    resignBlocks(all);
+}
+
+void Sav::resign(const std::vector<size_t>& dirty)
+{
+    std::vector<Block> all = blocks();
+    std::vector<size_t> pending = dirty;
+    // a valid layout has no cycles, so this settles within one pass per block
+    for (size_t pass = 0; pass < all.size() && !pending.empty(); pass++)
+    {
+        resignBlocks(pending);
+        std::vector<size_t> holders;
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            for (size_t j : pending)
+            {
+                if (i != j && all[j].checksum >= all[i].offset && all[j].checksum < all[i].offset + all[i].length)
+                {
+                    holders.push_back(i);
+                    break;
+                }
+            }
+        }
+        pending = holders;
+    }
+}
+
 std::unique_ptr<Sav> Sav::getSave(u8* dt, size_t length)
 {
     switch (length)
@@ -201,4 +234,33 @@ bool Sav::validSequence(u8* dt, u8* pattern, int shift)
         if (dt[i + ofs] != pattern[i])
             return false;
     return true;
+}
+
+BoxChecksum::Report Sav::verifyBoxes(bool repair)
+{
+    BoxChecksum::Report report;
+    u32 stride = boxOffset(0, 1) - boxOffset(0, 0);
+    for (u8 box = 0; box < boxes; box++)
+    {
+        BoxChecksum::scan(report, data + boxOffset(box, 0), stride, generation(), 30, true, repair, box * 30);
+    }
+    return report;
+}
+
+std::string Sav::boxesCsv(void) const
+{
+    std::string out;
+    u32 stride = boxOffset(0, 1) - boxOffset(0, 0);
+    for (u8 box = 0; box < boxes; box++)
+    {
+        Schema::csv(out, data + boxOffset(box, 0), stride, generation(), 30, box * 30, box == 0);
+    }
+    return out;
+}
+
+BoxSummary Sav::boxSummary(u8 box) const
+{
+    BoxSummary summary;
+    summary.compute(data + boxOffset(box, 0), boxOffset(0, 1) - boxOffset(0, 0), generation());
+    return summary;
 }
\ No newline at end of file
@@ -25,6 +25,7 @@
 */
 
 #include "SavBW.hpp"
+#include "Transfer.hpp"
 
 SavBW::SavBW(u8* dt)
 {
@@ -35,21 +36,41 @@ SavBW::SavBW(u8* dt)
     std::copy(dt, dt + length, data);
 }
 
-void SavBW::resign(void)
+void SavBW::resignBlocks(const std::vector<size_t>& dirty)
 {
-    const u8 blockCount = 70;
-    u8* tmp = new u8[*std::max_element(lengths, lengths + blockCount)];
-    u16 cs;
+    // every checksum is mirrored into the last block, so that one goes stale with any of them
+    const size_t last = 70 - 1;
+    std::vector<size_t> order;
+    for (size_t i : dirty)
+    {
+        if (i != last)
+        {
+            order.push_back(i);
+        }
+    }
+    if (!dirty.empty())
+    {
+        order.push_back(last);
+    }
 
-    for (u8 i = 0; i < blockCount; i++)
+    for (size_t i : order)
     {
-        std::copy(data + blockOfs[i], data + blockOfs[i] + lengths[i], tmp);
-        cs = ccitt16(tmp, lengths[i]);
+        u16 cs = ccitt16(data + blockOfs[i], lengths[i]);
         *(u16*)(data + chkMirror[i]) = cs;
         *(u16*)(data + chkofs[i]) = cs;
     }
 }
 
+std::vector<Sav::Block> SavBW::blocks(void) const
+{
+    std::vector<Block> ret(70);
+    for (size_t i = 0; i < ret.size(); i++)
+    {
+        ret[i] = {blockOfs[i], lengths[i], chkofs[i]};
+    }
+    return ret;
+}
+
 u16 SavBW::TID(void) const { return *(u16*)(data + 0x19414); }
 void SavBW::TID(u16 v) { *(u16*)(data + 0x19414) = v; }
 
@@ -112,10 +133,17 @@ std::unique_ptr<PKX> SavBW::pkm(u8 box, u8 slot, bool ekx) const
     return std::unique_ptr<PKX>(new PK5(buf, ekx));
 }
 
-void SavBW::pkm(PKX& pk, u8 box, u8 slot)
+bool SavBW::pkm(PKX& pk, u8 box, u8 slot)
 {
-    PK5* pk5 = (PK5*)&pk;
+    Transfer transfer(5);
+    Transfer::Status status;
+    PK5* pk5 = (PK5*)transfer.convert(pk, status);
+    if (pk5 == nullptr)
+    {
+        return false;
+    }
     std::copy(pk5->data, pk5->data + 136, data + boxOffset(box, slot));
+    return true;
 }
 
 void SavBW::cryptBoxData(bool crypted)
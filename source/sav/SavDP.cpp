@@ -25,6 +25,7 @@
 */
 
 #include "SavDP.hpp"
+#include "Transfer.hpp"
 #include "PGT.hpp"
 
 SavDP::SavDP(u8* dt)
@@ -84,21 +85,22 @@ void SavDP::SBO(void)
     sbo = (c1 >= c2) ? 0 : 0x40000;
 }
 
-void SavDP::resign(void)
+void SavDP::resignBlocks(const std::vector<size_t>& dirty)
 {
-    u8* tmp = new u8[0x12300];
-    u16 cs;
-    // start, end, chkoffset
-    int general[3] = {0x0000, 0xC0EC, 0xC0FE};
-    int storage[3] = {0xC100, 0x1E2CC, 0x1E2DE};
-    
-    std::copy(data + gbo + general[0], data + gbo + general[1] - general[0], tmp);
-    cs = ccitt16(tmp, general[1] - general[0]);
-    *(u16*)(data + gbo + general[2]) = cs;
+    // the active general and storage partitions, see blocks()
+    std::vector<Block> all = blocks();
+    for (size_t i : dirty)
+    {
+        *(u16*)(data + all[i].checksum) = ccitt16(data + all[i].offset, all[i].length);
+    }
+}
 
-    std::copy(data + sbo + storage[0], data + sbo + storage[1] - storage[0], tmp);
-    cs = ccitt16(tmp, storage[1] - storage[0]);
-    *(u16*)(data + sbo + storage[2]) = cs;
+std::vector<Sav::Block> SavDP::blocks(void) const
+{
+    return {
+        {(u32)gbo, 0xC0EC, (u32)gbo + 0xC0FE},
+        {(u32)sbo + 0xC100, 0x121CC, (u32)sbo + 0x1E2DE}
+    };
 }
 
 u16 SavDP::TID(void) const { return *(u16*)(data + gbo + 0x74); }
@@ -162,10 +164,17 @@ std::unique_ptr<PKX> SavDP::pkm(u8 box, u8 slot, bool ekx) const
     return std::unique_ptr<PKX>(new PK4(buf, ekx));
 }
 
-void SavDP::pkm(PKX& pk, u8 box, u8 slot)
+bool SavDP::pkm(PKX& pk, u8 box, u8 slot)
 {
-    PK4* pk4 = (PK4*)&pk;
+    Transfer transfer(4);
+    Transfer::Status status;
+    PK4* pk4 = (PK4*)transfer.convert(pk, status);
+    if (pk4 == nullptr)
+    {
+        return false;
+    }
     std::copy(pk4->data, pk4->data + 136, data + boxOffset(box, slot));
+    return true;
 }
 
 void SavDP::cryptBoxData(bool crypted)
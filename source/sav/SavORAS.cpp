@@ -25,6 +25,7 @@
 */
 
 #include "SavORAS.hpp"
+#include "Transfer.hpp"
 
 SavORAS::SavORAS(u8* dt)
 {
@@ -35,19 +36,26 @@ SavORAS::SavORAS(u8* dt)
     std::copy(dt, dt + length, data);
 }
 
-void SavORAS::resign(void)
+void SavORAS::resignBlocks(const std::vector<size_t>& dirty)
 {
-    const u8 blockCount = 58;
-    u8* tmp = new u8[*std::max_element(chklen, chklen + blockCount)];
     const u32 csoff = 0x75E1A;
 
-    for (u8 i = 0; i < blockCount; i++)
+    for (size_t i : dirty)
     {
-        std::copy(data + chkofs[i], data + chkofs[i] + chklen[i], tmp);
-        *(u16*)(data + csoff + i*8) =  ccitt16(tmp, chklen[i]);
+        *(u16*)(data + csoff + i*8) = ccitt16(data + chkofs[i], chklen[i]);
     }
 }
 
+std::vector<Sav::Block> SavORAS::blocks(void) const
+{
+    std::vector<Block> ret(58);
+    for (size_t i = 0; i < ret.size(); i++)
+    {
+        ret[i] = {chkofs[i], chklen[i], 0x75E1A + (u32)i*8};
+    }
+    return ret;
+}
+
 u16 SavORAS::TID(void) const { return *(u16*)(data + 0x14000); }
 void SavORAS::TID(u16 v) { *(u16*)(data + 0x14000) = v; }
 
@@ -110,10 +118,17 @@ std::unique_ptr<PKX> SavORAS::pkm(u8 box, u8 slot, bool ekx) const
     return std::unique_ptr<PKX>(new PK6(tmp, ekx));
 }
 
-void SavORAS::pkm(PKX& pk, u8 box, u8 slot)
+bool SavORAS::pkm(PKX& pk, u8 box, u8 slot)
 {
-    PK6* pk6 = (PK6*)&pk;
+    Transfer transfer(6);
+    Transfer::Status status;
+    PK6* pk6 = (PK6*)transfer.convert(pk, status);
+    if (pk6 == nullptr)
+    {
+        return false;
+    }
     std::copy(pk6->data, pk6->data + 232, data + boxOffset(box, slot));
+    return true;
 }
 
 void SavORAS::cryptBoxData(bool crypted)
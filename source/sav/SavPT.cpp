@@ -25,6 +25,7 @@
 */
 
 #include "SavPT.hpp"
+#include "Transfer.hpp"
 #include "PGT.hpp"
 
 SavPT::SavPT(u8* dt)
@@ -84,21 +85,22 @@ void SavPT::SBO(void)
     sbo = (c1 >= c2) ? 0 : 0x40000;
 }
 
-void SavPT::resign(void)
+void SavPT::resignBlocks(const std::vector<size_t>& dirty)
 {
-    u8* tmp = new u8[0x12300];
-    u16 cs;
-    // start, end, chkoffset
-    int general[3] = {0x0000, 0xCF18, 0xCF2A};
-    int storage[3] = {0xCF2C, 0x1F0FC, 0x1F10E};
-    
-    std::copy(data + gbo + general[0], data + gbo + general[1] - general[0], tmp);
-    cs = ccitt16(tmp, general[1] - general[0]);
-    *(u16*)(data + gbo + general[2]) = cs;
+    // the active general and storage partitions, see blocks()
+    std::vector<Block> all = blocks();
+    for (size_t i : dirty)
+    {
+        *(u16*)(data + all[i].checksum) = ccitt16(data + all[i].offset, all[i].length);
+    }
+}
 
-    std::copy(data + sbo + storage[0], data + sbo + storage[1] - storage[0], tmp);
-    cs = ccitt16(tmp, storage[1] - storage[0]);
-    *(u16*)(data + sbo + storage[2]) = cs;
+std::vector<Sav::Block> SavPT::blocks(void) const
+{
+    return {
+        {(u32)gbo, 0xCF18, (u32)gbo + 0xCF2A},
+        {(u32)sbo + 0xCF2C, 0x121D0, (u32)sbo + 0x1F10E}
+    };
 }
 
 u16 SavPT::TID(void) const { return *(u16*)(data + gbo + 0x78); }
@@ -162,10 +164,17 @@ std::unique_ptr<PKX> SavPT::pkm(u8 box, u8 slot, bool ekx) const
     return std::unique_ptr<PKX>(new PK4(buf, ekx));
 }
 
-void SavPT::pkm(PKX& pk, u8 box, u8 slot)
+bool SavPT::pkm(PKX& pk, u8 box, u8 slot)
 {
-    PK4* pk4 = (PK4*)&pk;
+    Transfer transfer(4);
+    Transfer::Status status;
+    PK4* pk4 = (PK4*)transfer.convert(pk, status);
+    if (pk4 == nullptr)
+    {
+        return false;
+    }
     std::copy(pk4->data, pk4->data + 136, data + boxOffset(box, slot));
+    return true;
 }
 
 void SavPT::cryptBoxData(bool crypted)
@@ -25,6 +25,7 @@
 */
 
 #include "SavUSUM.hpp"
+#include "Transfer.hpp"
 
 SavUSUM::SavUSUM(u8* dt)
 {
@@ -51,13 +52,19 @@ u16 SavUSUM::check16(u8* buf, u32 blockID, u32 len) const
     return ~chk;
 }
 
-void SavUSUM::resign(void)
+void SavUSUM::resignBlocks(const std::vector<size_t>& dirty)
 {
+    // the signature only covers the checksum table, which is untouched if no block is
+    if (dirty.empty())
+    {
+        return;
+    }
+
     const u8 blockCount = 39;
     u8* tmp = new u8[*std::max_element(chklen, chklen + blockCount)];
     const u32 csoff = 0x6CA1A;
 
-    for (u8 i = 0; i < blockCount; i++)
+    for (size_t i : dirty)
     {
         std::copy(data + chkofs[i], data + chkofs[i] + chklen[i], tmp);
         *(u16*)(data + csoff + i*8) = check16(tmp, *(u16*)(data + csoff + i*8 - 2), chklen[i]);
@@ -86,6 +93,16 @@ void SavUSUM::resign(void)
     std::copy(currentSignature, currentSignature + 0x80, data + memecryptoOffset);
 }
 
+std::vector<Sav::Block> SavUSUM::blocks(void) const
+{
+    std::vector<Block> ret(39);
+    for (size_t i = 0; i < ret.size(); i++)
+    {
+        ret[i] = {chkofs[i], chklen[i], 0x6CA1A + (u32)i*8};
+    }
+    return ret;
+}
+
 u16 SavUSUM::TID(void) const { return *(u16*)(data + 0x1400); }
 void SavUSUM::TID(u16 v) { *(u16*)(data + 0x1400) = v; }
 
@@ -149,11 +166,17 @@ std::unique_ptr<PKX> SavUSUM::pkm(u8 box, u8 slot, bool ekx) const
     return std::unique_ptr<PKX>(new PK7(buf, ekx));
 }
 
-void SavUSUM::pkm(PKX& pk, u8 box, u8 slot)
+bool SavUSUM::pkm(PKX& pk, u8 box, u8 slot)
 {
-    // TODO: trade logic
-    PK7* pk7 = (PK7*)&pk;
+    Transfer transfer(7);
+    Transfer::Status status;
+    PK7* pk7 = (PK7*)transfer.convert(pk, status);
+    if (pk7 == nullptr)
+    {
+        return false;
+    }
     std::copy(pk7->data, pk7->data + 232, data + boxOffset(box, slot));
+    return true;
 }
 
 void SavUSUM::cryptBoxData(bool crypted)
@@ -0,0 +1,229 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "SaveDiff.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr u32 STRIDE = 64;
+    constexpr u32 NONE = 0xFFFFFFFF;
+
+    // a full stride compared as words, OR-ing the differences so there's no branch per word
+    // and the loop can be vectorised
+    bool strideDiffers(const u8* a, const u8* b)
+    {
+        u32 diff = 0;
+        for (u32 i = 0; i < STRIDE; i += 4)
+        {
+            u32 x, y;
+            memcpy(&x, a + i, 4);
+            memcpy(&y, b + i, 4);
+            diff |= x ^ y;
+        }
+        return diff != 0;
+    }
+}
+
+SaveDiff::SaveDiff(const Sav& current, const Sav& previous, bool trustChecksums)
+{
+    mStatus = OK;
+    mBlocks = current.blocks();
+    std::vector<Sav::Block> other = previous.blocks();
+    bool same = current.generation() == previous.generation() && current.length == previous.length &&
+        current.boxes == previous.boxes && mBlocks.size() == other.size();
+    for (size_t i = 0; same && i < mBlocks.size(); i++)
+    {
+        same = mBlocks[i].length == other[i].length;
+    }
+    if (!same)
+    {
+        mBlocks.clear();
+        mStatus = MISMATCH;
+        return;
+    }
+    // XY's last block is listed as running past the end of the save
+    for (size_t i = 0; i < mBlocks.size(); i++)
+    {
+        mBlocks[i].length = std::min(mBlocks[i].length, current.length - std::max(mBlocks[i].offset, other[i].offset));
+    }
+
+    compareBlocks(current, previous, other, trustChecksums);
+    compareSlots(current, previous);
+    compareTrainer(current, previous);
+}
+
+void SaveDiff::compareBlocks(const Sav& current, const Sav& previous, const std::vector<Sav::Block>& other, bool trustChecksums)
+{
+    mFirstStride.assign(mBlocks.size(), NONE);
+    for (size_t i = 0; i < mBlocks.size(); i++)
+    {
+        const u8* a = current.data + mBlocks[i].offset;
+        const u8* b = previous.data + other[i].offset;
+        if (trustChecksums && *(u16*)(current.data + mBlocks[i].checksum) == *(u16*)(previous.data + other[i].checksum))
+        {
+            continue;
+        }
+
+        // most blocks match, and those are settled fastest by memcmp itself
+        const u32 length = mBlocks[i].length;
+        if (memcmp(a, b, length) == 0)
+        {
+            continue;
+        }
+
+        const u32 first = mStrides.size();
+        mStrides.resize(first + (length + STRIDE - 1) / STRIDE);
+        u8* flags = mStrides.data() + first;
+        u32 stride = 0;
+        for (; (stride + 1) * STRIDE <= length; stride++)
+        {
+            flags[stride] = strideDiffers(a + stride * STRIDE, b + stride * STRIDE);
+        }
+        if (stride * STRIDE < length)
+        {
+            flags[stride] = memcmp(a + stride * STRIDE, b + stride * STRIDE, length - stride * STRIDE) != 0;
+        }
+
+        mFirstStride[i] = first;
+
+        // one change per run of changed strides
+        const u32 count = mStrides.size() - first;
+        for (u32 start = 0; start < count; start++)
+        {
+            if (!flags[start])
+            {
+                continue;
+            }
+            u32 end = start + 1;
+            while (end < count && flags[end])
+            {
+                end++;
+            }
+            const u32 offset = start * STRIDE;
+            mChanges.push_back({BLOCK, (u16)i, mBlocks[i].offset + offset, std::min(end * STRIDE, length) - offset});
+            start = end;
+        }
+    }
+
+    mOrder.resize(mBlocks.size());
+    for (size_t i = 0; i < mOrder.size(); i++)
+    {
+        mOrder[i] = i;
+    }
+    std::sort(mOrder.begin(), mOrder.end(), [this](size_t x, size_t y) { return mBlocks[x].offset < mBlocks[y].offset; });
+}
+
+bool SaveDiff::touched(u32 offset, u32 length) const
+{
+    const u32 end = offset + length;
+    while (offset < end)
+    {
+        // last block starting at or before offset
+        auto it = std::upper_bound(mOrder.begin(), mOrder.end(), offset, [this](u32 value, size_t index) {
+            return value < mBlocks[index].offset;
+        });
+        if (it == mOrder.begin())
+        {
+            return true;
+        }
+        const Sav::Block& block = mBlocks[*--it];
+        const u32 blockEnd = block.offset + block.length;
+        if (offset >= blockEnd)
+        {
+            // not covered by a checksum, so nothing to go on but the bytes themselves
+            return true;
+        }
+        if (mFirstStride[*it] != NONE)
+        {
+            const u8* flags = mStrides.data() + mFirstStride[*it];
+            const u32 last = (std::min(end, blockEnd) - 1 - block.offset) / STRIDE;
+            for (u32 stride = (offset - block.offset) / STRIDE; stride <= last; stride++)
+            {
+                if (flags[stride])
+                {
+                    return true;
+                }
+            }
+        }
+        offset = blockEnd;
+    }
+    return false;
+}
+
+void SaveDiff::compareSlots(const Sav& current, const Sav& previous)
+{
+    const u32 boxSize = current.boxOffset(0, 1) - current.boxOffset(0, 0);
+    for (u8 box = 0; box < current.boxes; box++)
+    {
+        for (u8 slot = 0; slot < 30; slot++)
+        {
+            const u32 offset = current.boxOffset(box, slot);
+            if (touched(offset, boxSize) && memcmp(current.data + offset, previous.data + previous.boxOffset(box, slot), boxSize) != 0)
+            {
+                mChanges.push_back({BOX, (u16)(box * 30 + slot), offset, boxSize});
+            }
+        }
+    }
+
+    const u32 partySize = current.partyOffset(1) - current.partyOffset(0);
+    for (u8 slot = 0; slot < 6; slot++)
+    {
+        const u32 offset = current.partyOffset(slot);
+        if (touched(offset, partySize) && memcmp(current.data + offset, previous.data + previous.partyOffset(slot), partySize) != 0)
+        {
+            mChanges.push_back({PARTY, slot, offset, partySize});
+        }
+    }
+}
+
+void SaveDiff::compareTrainer(const Sav& current, const Sav& previous)
+{
+    const bool changed[] = {
+        current.TID() != previous.TID(),
+        current.SID() != previous.SID(),
+        current.otName() != previous.otName(),
+        current.gender() != previous.gender(),
+        current.version() != previous.version(),
+        current.language() != previous.language(),
+        current.country() != previous.country(),
+        current.subRegion() != previous.subRegion(),
+        current.consoleRegion() != previous.consoleRegion(),
+        current.money() != previous.money(),
+        current.BP() != previous.BP(),
+        current.playedHours() != previous.playedHours() || current.playedMinutes() != previous.playedMinutes() ||
+            current.playedSeconds() != previous.playedSeconds(),
+        current.currentBox() != previous.currentBox()
+    };
+    for (u16 field = 0; field < sizeof(changed); field++)
+    {
+        if (changed[field])
+        {
+            mChanges.push_back({TRAINER, field, 0, 0});
+        }
+    }
+}
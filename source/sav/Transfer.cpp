@@ -0,0 +1,191 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "Transfer.hpp"
+#include <algorithm>
+
+namespace
+{
+    // highest national dex number of generations 4 to 7
+    constexpr u16 MAX_SPECIES[4] = { 493, 649, 721, 807 };
+}
+
+PKX* Transfer::target(u8 generation)
+{
+    switch (generation)
+    {
+        case 4:
+            return &mPK4;
+        case 5:
+            return &mPK5;
+        case 6:
+            return &mPK6;
+        case 7:
+            return &mPK7;
+    }
+    return nullptr;
+}
+
+PKX* Transfer::load(const u8* data, u8 generation)
+{
+    PKX* pk = target(generation);
+    if (pk != nullptr)
+    {
+        std::copy(data, data + pk->length, raw(*pk));
+    }
+    return pk;
+}
+
+PKX* Transfer::convert(PKX& pk, Status& status, bool refresh)
+{
+    if (pk.generation() == mGeneration)
+    {
+        status = OK;
+        return &pk;
+    }
+    if (target(mGeneration) == nullptr || target(pk.generation()) == nullptr)
+    {
+        status = UNSUPPORTED;
+        return nullptr;
+    }
+    if (pk.species() == 0)
+    {
+        status = EMPTY;
+        return nullptr;
+    }
+    if (pk.species() > MAX_SPECIES[mGeneration - 4])
+    {
+        status = SPECIES;
+        return nullptr;
+    }
+
+    // Each step only writes the object of a newer (or older) generation than the one it reads,
+    // so pk may be one of ours
+    PKX* out = &pk;
+    while (out->generation() < mGeneration)
+    {
+        switch (out->generation())
+        {
+            case 4:
+                static_cast<PK4*>(out)->next(mPK5);
+                out = &mPK5;
+                break;
+            case 5:
+                static_cast<PK5*>(out)->next(mPK6);
+                out = &mPK6;
+                break;
+            case 6:
+                static_cast<PK6*>(out)->next(mPK7);
+                out = &mPK7;
+                break;
+        }
+    }
+    while (out->generation() > mGeneration)
+    {
+        std::unique_ptr<PKX> previous;
+        switch (out->generation())
+        {
+            case 5:
+                previous = static_cast<PK5*>(out)->previous();
+                break;
+            case 6:
+                previous = static_cast<PK6*>(out)->previous();
+                break;
+            case 7:
+                previous = static_cast<PK7*>(out)->previous();
+                break;
+        }
+        out = load(raw(*previous), previous->generation());
+    }
+
+    if (refresh)
+    {
+        out->refreshChecksum();
+    }
+    status = OK;
+    return out;
+}
+
+std::vector<Transfer::Status> Transfer::convert(Bank& bank, u32 first, u32 last)
+{
+    std::vector<Status> status(last - first, OK);
+    // length of each staged Pokémon, 0 where there's nothing to write
+    std::vector<u8> lengths(last - first, 0);
+    mStaging.resize((last - first) * Bank::SLOT_SIZE);
+
+    for (u32 i = first; i < last; i++)
+    {
+        int box = i / Bank::SLOTS;
+        int slot = i % Bank::SLOTS;
+        u8 generation = bank.generation(box, slot);
+        if (generation == 0)
+        {
+            status[i - first] = EMPTY;
+            continue;
+        }
+        if (generation == mGeneration)
+        {
+            continue;
+        }
+
+        PKX* pk = load(bank.slotData(box, slot), generation);
+        if (pk == nullptr)
+        {
+            status[i - first] = UNSUPPORTED;
+            continue;
+        }
+        PKX* out = convert(*pk, status[i - first], false);
+        if (out != nullptr)
+        {
+            std::copy(raw(*out), raw(*out) + out->length, mStaging.data() + (i - first) * Bank::SLOT_SIZE);
+            lengths[i - first] = out->length;
+        }
+    }
+
+    // Every format from 4 to 7 sums the words after the header into 0x06
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        u8* pk = mStaging.data() + i * Bank::SLOT_SIZE;
+        u16 chk = 0;
+        for (u8 j = 8; j < lengths[i]; j += 2)
+        {
+            chk += *(u16*)(pk + j);
+        }
+        *(u16*)(pk + 0x06) = chk;
+    }
+
+    PKX* out = target(mGeneration);
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        if (lengths[i] != 0)
+        {
+            std::copy(mStaging.data() + i * Bank::SLOT_SIZE, mStaging.data() + i * Bank::SLOT_SIZE + lengths[i], raw(*out));
+            bank.pkm(*out, (first + i) / Bank::SLOTS, (first + i) % Bank::SLOTS);
+        }
+    }
+
+    return status;
+}
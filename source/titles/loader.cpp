@@ -28,6 +28,10 @@
 #include "Configuration.hpp"
 #include "Directory.hpp"
 #include "FSStream.hpp"
+#include "FileSystem.hpp"
+#include "Pack.hpp"
+#include "archive.hpp"
+#include "io.hpp"
 #include <ctime>
 
 static constexpr char langIds[8] = {
@@ -58,9 +62,15 @@ std::vector<std::shared_ptr<Title>> TitleLoader::nandTitles;
 std::shared_ptr<Title> TitleLoader::cardTitle = nullptr;
 std::unordered_map<std::string, std::vector<std::string>> TitleLoader::sdSaves;
 std::shared_ptr<Sav> TitleLoader::save;
+std::shared_ptr<SaveDiff> TitleLoader::sinceBackup = nullptr;
+
+static std::shared_ptr<Threads::Job> backupJob = nullptr;
+// file the loaded save came from, backups are kept apart per save file
+static std::string loadedPath;
 
 void TitleLoader::scan(void)
 {
+    io::CallSite site("TitleLoader::scan");
     // known 3ds title ids
     static const std::vector<unsigned long long> ctrTitleIds = {
         0x0004000000055D00, // X
@@ -182,68 +192,69 @@ void TitleLoader::scan(void)
         return l->name() < r->name();
     });
 
-    std::u16string chkpntDir = StringUtils::UTF8toUTF16("/3ds/Checkpoint/saves");
-    Directory checkpoint(Archive::sd(), chkpntDir);
-    std::u16string sSeparator = StringUtils::UTF8toUTF16("/");
+    // Every id we care about gets a bucket up front, so the Checkpoint folder only has to be
+    // walked once: each game folder is matched by its prefix against the buckets, and only
+    // the matching ones are opened. 3DS folders start with the 7 character "0x%05X" unique
+    // id, DS folders with the 4 character game code.
+    std::unordered_map<std::string, std::vector<std::string>> saves;
     for (size_t i = 0; i < ctrTitleIds.size(); i++)
     {
         u32 uniqueId = (u32) ctrTitleIds[i] >> 8;
-        std::string id = StringUtils::format("0x%05X", uniqueId);
-        std::vector<std::string> saves;
-        for (size_t j = 0; j < checkpoint.count(); j++)
+        saves[StringUtils::format("0x%05X", uniqueId)];
+    }
+    for (size_t game = 0; game < 9; game++)
+    {
+        for (size_t lang = 0; lang < 8; lang++)
         {
-            if (checkpoint.folder(j))
-            {
-                std::u16string fileName = checkpoint.item(j);
-                if (fileName.substr(0, 7) == StringUtils::UTF8toUTF16(id.c_str()))
-                {
-                    Directory subdir(Archive::sd(), chkpntDir + sSeparator + fileName);
-                    for (size_t k = 0; k < subdir.count(); k++)
-                    {
-                        if (subdir.folder(k))
-                        {
-                            std::u16string savePath = chkpntDir + sSeparator + fileName + sSeparator + subdir.item(k)
-                                                      + StringUtils::UTF8toUTF16("/main");
-                            saves.push_back(StringUtils::UTF16toUTF8(savePath));
-                        }
-                    }
-                }
-            }
+            saves[std::string(dsIds[game]) + langIds[lang]];
         }
-        sdSaves[id] = saves;
     }
 
-    for (size_t game = 0; game < 9; game++)
+    std::u16string chkpntDir = StringUtils::UTF8toUTF16("/3ds/Checkpoint/saves");
+    Directory checkpoint(Archive::sd(), chkpntDir);
+    std::u16string sSeparator = StringUtils::UTF8toUTF16("/");
+    for (size_t i = 0; i < checkpoint.count(); i++)
     {
-        for (size_t lang = 0; lang < 8; lang++)
+        if (!checkpoint.folder(i))
         {
-            std::string id = std::string(dsIds[game]) + langIds[lang];
-            std::vector<std::string> saves;
-            for (size_t i = 0; i < checkpoint.count(); i++)
+            continue;
+        }
+
+        std::u16string fileName = checkpoint.item(i);
+        std::string name = StringUtils::UTF16toUTF8(fileName);
+        bool ds = false;
+        auto bucket = saves.find(name.substr(0, 7));
+        if (bucket == saves.end())
+        {
+            bucket = saves.find(name.substr(0, 4));
+            ds = true;
+        }
+        if (bucket == saves.end())
+        {
+            continue;
+        }
+
+        std::u16string gameDir = chkpntDir + sSeparator + fileName;
+        Directory subdir(Archive::sd(), gameDir);
+        for (size_t j = 0; j < subdir.count(); j++)
+        {
+            if (subdir.folder(j))
             {
-                if (checkpoint.folder(i))
+                std::u16string savePath = gameDir + sSeparator + subdir.item(j);
+                if (ds)
+                {
+                    savePath += sSeparator + subdir.item(j).substr(5) + StringUtils::UTF8toUTF16(".sav");
+                }
+                else
                 {
-                    std::u16string fileName = checkpoint.item(i);
-                    if (StringUtils::UTF16toUTF8(fileName).substr(0, 7) == id)
-                    {
-                        Directory subdir(Archive::sd(), chkpntDir + sSeparator + fileName);
-                        {
-                            for(size_t j = 0; j < subdir.count(); j++)
-                            {
-                                if (subdir.folder(j))
-                                {
-                                    std::u16string savePath = chkpntDir + sSeparator + fileName + sSeparator + subdir.item(j) + sSeparator
-                                                              + subdir.item(j).substr(5) + StringUtils::UTF8toUTF16(".sav");
-                                    saves.push_back(StringUtils::UTF16toUTF8(savePath));
-                                }
-                            }
-                        }
-                    }
+                    savePath += StringUtils::UTF8toUTF16("/main");
                 }
+                bucket->second.push_back(StringUtils::UTF16toUTF8(savePath));
             }
-            sdSaves[id] = saves;
         }
     }
+
+    sdSaves = saves;
 }
 
 static std::string folderPrefix()
@@ -356,27 +367,104 @@ static std::string backupName()
 
 void TitleLoader::backupSave()
 {
+    io::CallSite site("TitleLoader::backupSave");
     char stringTime[15] = {0};
     time_t unixTime = time(NULL);
     struct tm* timeStruct = gmtime((const time_t *)&unixTime);
     std::strftime(stringTime, 14,"%Y%m%d%H%M%S", timeStruct);
-    std::string gameFolder = "/3ds/PKSM/backups/" + folderPrefix();
-    mkdir(gameFolder.c_str(), 777);
-    std::string folderName = gameFolder + '/' + stringTime;
-    mkdir(folderName.c_str(), 777);
-    std::string filePath = folderName + '/' + backupName();
-    FSStream out = FSStream(Archive::sd(), StringUtils::UTF8toUTF16(filePath), FS_OPEN_WRITE | FS_OPEN_CREATE, TitleLoader::save->length);
-    if (out.good())
+    // every backup of a game lives in a single pack, one entry per backup named after the save file it
+    // came from, so several saves of one game never restore each other
+    std::string packPath = "/3ds/PKSM/backups/" + folderPrefix() + ".pack";
+    Pack::Writer out(Archive::sd(), StringUtils::UTF8toUTF16(packPath));
+    if (!out.good())
     {
-        out.write(TitleLoader::save->data, TitleLoader::save->length);
+        Gui::warn("Could not open backup file!");
     }
-    else
+    else if (!out.add(loadedPath + '/' + stringTime + '/' + backupName(), TitleLoader::save->data, TitleLoader::save->length))
     {
-        Gui::warn("Could not open backup file!");
+        Gui::warn("Could not write backup file!");
     }
     out.close();
 }
 
+static std::u16string packPath()
+{
+    return StringUtils::UTF8toUTF16("/3ds/PKSM/backups/" + folderPrefix() + ".pack");
+}
+
+std::unique_ptr<Sav> TitleLoader::latestBackup(void)
+{
+    Pack::Reader in(Archive::sd(), packPath());
+    if (!in.good())
+    {
+        return nullptr;
+    }
+    const std::string prefix = loadedPath + '/';
+    for (size_t i = in.count(); i-- > 0;)
+    {
+        const Pack::Entry& entry = in.entry(i);
+        if (entry.name.compare(0, prefix.size(), prefix) != 0)
+        {
+            continue;
+        }
+        std::unique_ptr<u8[]> data(new u8[entry.rawSize]);
+        if (!in.extract(i, data.get()))
+        {
+            return nullptr;
+        }
+        return Sav::getSave(data.get(), entry.rawSize);
+    }
+    return nullptr;
+}
+
+bool TitleLoader::restoreBackup(const std::string& savePath)
+{
+    io::CallSite site("TitleLoader::restoreBackup");
+    // a running backup appends to the pack this reads from
+    if (backupJob)
+    {
+        backupJob->wait();
+        backupJob = nullptr;
+    }
+
+    // an earlier restore may have been cut off halfway through swapping the file
+    io::recoverFile(Archive::sd(), StringUtils::UTF8toUTF16(savePath));
+    FSStream in(Archive::sd(), StringUtils::UTF8toUTF16(savePath), FS_OPEN_READ);
+    if (!in.good())
+    {
+        return false;
+    }
+    u32 size = in.size();
+    std::unique_ptr<u8[]> saveData(new u8[size]);
+    bool read = in.read(saveData.get(), size) == size;
+    in.close();
+    if (!read)
+    {
+        return false;
+    }
+    save = Sav::getSave(saveData.get(), size);
+    if (!save)
+    {
+        return false;
+    }
+    loadedPath = savePath;
+
+    std::unique_ptr<Sav> backup = latestBackup();
+    if (!backup || backup->length != save->length)
+    {
+        return false;
+    }
+    // the save being replaced becomes the newest backup, so the restore can be undone the same way
+    backupSave();
+    if (R_FAILED(io::replaceFile(Archive::sd(), StringUtils::UTF8toUTF16(savePath), backup->data, backup->length)))
+    {
+        return false;
+    }
+    save = std::move(backup);
+    sinceBackup = nullptr;
+    return true;
+}
+
 void TitleLoader::load(std::shared_ptr<Title> title)
 {
     return;
@@ -384,20 +472,48 @@ void TitleLoader::load(std::shared_ptr<Title> title)
 
 void TitleLoader::load(std::string savePath)
 {
+    io::recoverFile(Archive::sd(), StringUtils::UTF8toUTF16(savePath));
     FSStream in(Archive::sd(), StringUtils::UTF8toUTF16(savePath), FS_OPEN_READ);
     u32 size = in.size();
     u8* saveData = new u8[size];
-    in.read(saveData, size);
+    bool read = in.good() && in.read(saveData, size) == size;
     in.close();
-    save = Sav::getSave(saveData, size);
+    // the previous backup reads the current save, let it finish before replacing it
+    if (backupJob)
+    {
+        backupJob->wait();
+    }
+    save = read ? Sav::getSave(saveData, size) : nullptr;
+    delete[] saveData;
+    if (!save)
+    {
+        return;
+    }
+    loadedPath = savePath;
+    // the boxes are still as stored here, which is what the scan expects
+    BoxChecksum::Report report = save->verifyBoxes(false);
+    if (!report.corrupt.empty())
+    {
+        Gui::warn(StringUtils::format("%i box slots have a bad checksum!", (int)report.corrupt.size()), std::string("The game shows them as bad eggs."));
+    }
+    // has to come before this load's own backup becomes the latest one
+    std::unique_ptr<Sav> backup = latestBackup();
+    sinceBackup = backup ? std::make_shared<SaveDiff>(*save, *backup, true) : nullptr;
     if (Configuration::getInstance().autoBackup())
     {
-        Threads::create((ThreadFunc)&TitleLoader::backupSave);
+        backupJob = Threads::submit([](Threads::Job&) { TitleLoader::backupSave(); }, Threads::Priority::LOW);
     }
 }
 
 void TitleLoader::exit()
 {
+    if (backupJob)
+    {
+        backupJob->wait();
+        backupJob = nullptr;
+    }
     nandTitles.clear();
     cardTitle = nullptr;
+    sinceBackup = nullptr;
+    loadedPath.clear();
 }
\ No newline at end of file
@@ -40,25 +40,29 @@ static char *decoding_table = NULL;
 
 unsigned char *base64_decode(const char *data, size_t input_length, size_t *output_length)
 {
-    decoding_table = malloc(256);
+    if (input_length == 0 || input_length % 4 != 0) return NULL;
+
+    decoding_table = calloc(256, 1);
+    if (decoding_table == NULL) return NULL;
     for (int i = 0; i < 64; i++)
         decoding_table[(unsigned char) encoding_table[i]] = i;
 
-    if (input_length % 4 != 0) return NULL;
-
     *output_length = input_length / 4 * 3;
     if (data[input_length - 1] == '=') (*output_length)--;
     if (data[input_length - 2] == '=') (*output_length)--;
 
     unsigned char *decoded_data = malloc(*output_length);
-    if (decoded_data == NULL) return NULL;
+    if (decoded_data == NULL) {
+        free(decoding_table);
+        return NULL;
+    }
 
     for (size_t i = 0, j = 0; i < input_length;) {
 
-        uint32_t sextet_a = data[i] == '=' ? 0 & i++ : decoding_table[(size_t)data[i++]];
-        uint32_t sextet_b = data[i] == '=' ? 0 & i++ : decoding_table[(size_t)data[i++]];
-        uint32_t sextet_c = data[i] == '=' ? 0 & i++ : decoding_table[(size_t)data[i++]];
-        uint32_t sextet_d = data[i] == '=' ? 0 & i++ : decoding_table[(size_t)data[i++]];
+        uint32_t sextet_a = data[i] == '=' ? 0 & i++ : decoding_table[(unsigned char)data[i++]];
+        uint32_t sextet_b = data[i] == '=' ? 0 & i++ : decoding_table[(unsigned char)data[i++]];
+        uint32_t sextet_c = data[i] == '=' ? 0 & i++ : decoding_table[(unsigned char)data[i++]];
+        uint32_t sextet_d = data[i] == '=' ? 0 & i++ : decoding_table[(unsigned char)data[i++]];
 
         uint32_t triple = (sextet_a << 3 * 6)
         + (sextet_b << 2 * 6)
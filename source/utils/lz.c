@@ -0,0 +1,210 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "lz.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 0xFFFF
+#define LZ_RUN_MASK 15
+
+static uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_write_length(uint8_t *op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t *lz_write_literals(uint8_t *op, uint8_t *token, const uint8_t *literals, size_t length)
+{
+    *token = (uint8_t)((length >= LZ_RUN_MASK ? LZ_RUN_MASK : length) << 4);
+    if (length >= LZ_RUN_MASK)
+    {
+        op = lz_write_length(op, length - LZ_RUN_MASK);
+    }
+    memcpy(op, literals, length);
+    return op + length;
+}
+
+size_t lz_compress_bound(size_t len)
+{
+    return len + len / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t *src, size_t src_length, uint8_t *dst, size_t dst_capacity)
+{
+    if (dst_capacity < lz_compress_bound(src_length))
+        return 0;
+
+    // positions are stored relative to src; a stale or zero entry is harmless
+    // since every candidate is verified before use
+    uint32_t *table = calloc(1 << LZ_HASH_BITS, sizeof(uint32_t));
+    if (table == NULL)
+        return 0;
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + src_length;
+    uint8_t *op = dst;
+
+    while (end - ip >= LZ_MIN_MATCH)
+    {
+        uint32_t sequence = lz_read32(ip);
+        uint32_t h = lz_hash(sequence);
+        const uint8_t *ref = src + table[h];
+        table[h] = (uint32_t)(ip - src);
+
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != sequence)
+        {
+            ip++;
+            continue;
+        }
+
+        size_t match = LZ_MIN_MATCH;
+        while (ip + match < end && ref[match] == ip[match])
+            match++;
+
+        uint8_t *token = op++;
+        op = lz_write_literals(op, token, anchor, ip - anchor);
+
+        uint16_t offset = (uint16_t)(ip - ref);
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+
+        size_t extra = match - LZ_MIN_MATCH;
+        *token |= (uint8_t)(extra >= LZ_RUN_MASK ? LZ_RUN_MASK : extra);
+        if (extra >= LZ_RUN_MASK)
+            op = lz_write_length(op, extra - LZ_RUN_MASK);
+
+        ip += match;
+        anchor = ip;
+    }
+
+    // the last sequence only carries literals, possibly none
+    uint8_t *token = op++;
+    op = lz_write_literals(op, token, anchor, end - anchor);
+
+    free(table);
+    return op - dst;
+}
+
+size_t lz_decompress(const uint8_t *src, size_t src_length, uint8_t *dst, size_t dst_capacity)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_length;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_capacity;
+
+    while (ip < iend)
+    {
+        uint8_t token = *ip++;
+        size_t length = token >> 4;
+        if (length == LZ_RUN_MASK)
+        {
+            uint8_t b;
+            do {
+                if (ip >= iend)
+                    return 0;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+
+        if (length > (size_t)(iend - ip) || length > (size_t)(oend - op))
+            return 0;
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return 0;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return 0;
+
+        length = token & LZ_RUN_MASK;
+        if (length == LZ_RUN_MASK)
+        {
+            uint8_t b;
+            do {
+                if (ip >= iend)
+                    return 0;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        length += LZ_MIN_MATCH;
+        if (length > (size_t)(oend - op))
+            return 0;
+
+        // matches may overlap their own output, so copy forward byte by byte
+        const uint8_t *ref = op - offset;
+        while (length--)
+            *op++ = *ref++;
+    }
+
+    return op - dst;
+}
+
+uint32_t lz_checksum(const uint8_t *data, size_t length)
+{
+    uint32_t a = 1, b = 0;
+    while (length > 0)
+    {
+        // 5552 is the largest block for which b cannot overflow before the modulo
+        size_t block = length < 5552 ? length : 5552;
+        length -= block;
+        while (block--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
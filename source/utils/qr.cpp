@@ -0,0 +1,632 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "qr.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "PGT.hpp"
+#include "PGF.hpp"
+#include "WC6.hpp"
+#include "WC7.hpp"
+extern "C" {
+#include "base64.h"
+#include "quirc.h"
+}
+
+namespace
+{
+    // WC6::lengthFull and WC7::lengthFull, which aren't static
+    constexpr size_t FULL_LENGTH = 784;
+
+    // Reads one whitespace-separated number of a PGM header, skipping comments
+    bool pgmNumber(FILE* in, int& value)
+    {
+        int c = fgetc(in);
+        while (c == '#' || isspace(c))
+        {
+            if (c == '#')
+            {
+                while (c != '\n' && c != EOF)
+                {
+                    c = fgetc(in);
+                }
+            }
+            c = fgetc(in);
+        }
+
+        value = 0;
+        if (!isdigit(c))
+        {
+            return false;
+        }
+        while (isdigit(c))
+        {
+            value = value * 10 + (c - '0');
+            c = fgetc(in);
+        }
+        // c is the single whitespace byte which ends the number
+        return isspace(c);
+    }
+
+#ifdef _3DS
+    uint64_t ticks(void) { return svcGetSystemTick(); }
+#else
+    uint64_t ticks(void)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#endif
+}
+
+#ifdef _3DS
+QR::CameraSource::CameraSource(void) : mRaw(WIDTH * HEIGHT), mGray(WIDTH * HEIGHT), mTransferUnit(0), mGood(false)
+{
+    if (R_FAILED(camInit()))
+    {
+        return;
+    }
+
+    CAMU_SetSize(SELECT_OUT1, SIZE_CTR_TOP_LCD, CONTEXT_A);
+    CAMU_SetOutputFormat(SELECT_OUT1, OUTPUT_RGB_565, CONTEXT_A);
+    CAMU_SetFrameRate(SELECT_OUT1, FRAME_RATE_30);
+    CAMU_SetNoiseFilter(SELECT_OUT1, true);
+    CAMU_SetAutoExposure(SELECT_OUT1, true);
+    CAMU_SetAutoWhiteBalance(SELECT_OUT1, true);
+    CAMU_SetTrimming(PORT_CAM1, false);
+    CAMU_GetMaxBytes(&mTransferUnit, WIDTH, HEIGHT);
+    CAMU_SetTransferBytes(PORT_CAM1, mTransferUnit, WIDTH, HEIGHT);
+    CAMU_Activate(SELECT_OUT1);
+    CAMU_ClearBuffer(PORT_CAM1);
+    mGood = R_SUCCEEDED(CAMU_StartCapture(PORT_CAM1));
+}
+
+QR::CameraSource::~CameraSource(void)
+{
+    CAMU_StopCapture(PORT_CAM1);
+    CAMU_Activate(SELECT_NONE);
+    camExit();
+}
+
+bool QR::CameraSource::next(Frame& frame)
+{
+    if (!mGood)
+    {
+        return false;
+    }
+
+    Handle event = 0;
+    if (R_FAILED(CAMU_SetReceiving(&event, mRaw.data(), PORT_CAM1, WIDTH * HEIGHT * sizeof(u16), (s16)mTransferUnit)))
+    {
+        return false;
+    }
+    Result res = svcWaitSynchronization(event, 300000000);
+    svcCloseHandle(event);
+    if (R_FAILED(res))
+    {
+        return false;
+    }
+
+    quirc_rgb565_to_luma(mGray.data(), mRaw.data(), mGray.size());
+    frame.pixels = mGray.data();
+    frame.width  = WIDTH;
+    frame.height = HEIGHT;
+    return true;
+}
+#endif
+
+bool QR::ImageSource::next(Frame& frame)
+{
+    while (mIndex < mFiles.size())
+    {
+        FILE* in = fopen(mFiles[mIndex++].c_str(), "rb");
+        if (in == NULL)
+        {
+            continue;
+        }
+
+        int width, height, maxValue;
+        bool ok = fgetc(in) == 'P' && fgetc(in) == '5' && pgmNumber(in, width) && pgmNumber(in, height) && pgmNumber(in, maxValue) &&
+                  width > 0 && height > 0 && maxValue > 0 && maxValue < 256;
+        if (ok)
+        {
+            mPixels.resize(width * height);
+            ok = fread(mPixels.data(), 1, mPixels.size(), in) == mPixels.size();
+        }
+        fclose(in);
+
+        if (ok)
+        {
+            frame.pixels = mPixels.data();
+            frame.width  = width;
+            frame.height = height;
+            return true;
+        }
+    }
+    return false;
+}
+
+QR::Reader::Reader(int votes)
+    : mQuirc(quirc_new()),
+      mCode(new quirc_code),
+      mData(new quirc_data),
+      mStats(new quirc_decode_stats()),
+      mGeometry(new quirc_geometry),
+      mTracking(false),
+      mVotes(votes < 1 ? 1 : votes),
+      mFrames(0),
+      mTrackedFrames(0),
+      mFound(0),
+      mTotal(0),
+      mParity(-1)
+{
+    mStats->clock = ticks;
+}
+
+QR::Reader::~Reader(void)
+{
+    if (mQuirc)
+    {
+        quirc_destroy(mQuirc);
+    }
+}
+
+bool QR::Reader::feed(const Frame& frame)
+{
+    if (mQuirc == nullptr)
+    {
+        return false;
+    }
+
+    int width, height;
+    quirc_begin(mQuirc, &width, &height);
+    if (width != frame.width || height != frame.height)
+    {
+        if (quirc_resize(mQuirc, frame.width, frame.height) < 0)
+        {
+            return false;
+        }
+        mTracking = false;
+    }
+
+    mFrames++;
+    size_t size = frame.width * frame.height;
+
+    // Thresholding happens in place, so a failed attempt needs a fresh copy
+    if (mTracking)
+    {
+        memcpy(quirc_begin(mQuirc, nullptr, nullptr), frame.pixels, size);
+        quirc_end_with_geometry(mQuirc, mGeometry.get());
+        if (decodeAll() > 0)
+        {
+            mTrackedFrames++;
+            return complete();
+        }
+        mTracking = false;
+    }
+
+    memcpy(quirc_begin(mQuirc, nullptr, nullptr), frame.pixels, size);
+    quirc_end(mQuirc);
+    // Only a lone code is worth following into the next frame
+    mTracking = decodeAll() == 1 && quirc_count(mQuirc) == 1 && quirc_save_geometry(mQuirc, 0, mGeometry.get()) == 0;
+
+    return complete();
+}
+
+int QR::Reader::decodeAll(void)
+{
+    int decoded = 0;
+    for (int i = 0; i < quirc_count(mQuirc); i++)
+    {
+        quirc_extract(mQuirc, i, mCode.get());
+        if (quirc_decode_with_stats(mCode.get(), mData.get(), mStats.get()) == QUIRC_SUCCESS)
+        {
+            decoded++;
+            vote();
+        }
+    }
+    return decoded;
+}
+
+void QR::Reader::vote(void)
+{
+    // Bounds how many misreads are remembered
+    constexpr size_t MAX_CANDIDATES = 8;
+
+    const u8* data = mData->payload;
+    int length     = mData->payload_len;
+    int index      = mData->sa_index;
+    int total      = mData->sa_size;
+    int parity     = total > 0 ? mData->sa_parity : -1;
+
+    Candidate* candidate = nullptr;
+    for (auto& c : mCandidates)
+    {
+        if (c.index == index && c.total == total && c.parity == parity && (int)c.data.size() == length &&
+            std::equal(c.data.begin(), c.data.end(), data))
+        {
+            candidate = &c;
+            break;
+        }
+    }
+
+    if (candidate == nullptr)
+    {
+        if (mCandidates.size() >= MAX_CANDIDATES)
+        {
+            auto oldest = std::min_element(mCandidates.begin(), mCandidates.end(),
+                [](const Candidate& a, const Candidate& b) { return a.lastFrame < b.lastFrame; });
+            mCandidates.erase(oldest);
+        }
+        mCandidates.push_back(Candidate{std::vector<u8>(data, data + length), index, total, parity, 1, mFrames});
+        candidate = &mCandidates.back();
+    }
+    // The same code twice in one frame is still one vote
+    else if (candidate->lastFrame != mFrames)
+    {
+        candidate->votes++;
+        candidate->lastFrame = mFrames;
+    }
+
+    if (candidate->votes >= mVotes)
+    {
+        add(data, length, index, total, parity);
+    }
+}
+
+void QR::Reader::add(const u8* data, int length, int index, int total, int parity)
+{
+    if (total == 0)
+    {
+        total = 1;
+        index = 0;
+    }
+
+    // A code from another message starts over
+    if (total != mTotal || parity != mParity)
+    {
+        restart();
+        mTotal  = total;
+        mParity = parity;
+        mParts.resize(total);
+        mHave.resize(total, false);
+    }
+
+    if (index >= total || mHave[index])
+    {
+        return;
+    }
+    mParts[index].assign(data, data + length);
+    mHave[index] = true;
+    mFound++;
+
+    if (complete() && mParity >= 0)
+    {
+        u8 check = 0;
+        for (auto& part : mParts)
+        {
+            for (u8 byte : part)
+            {
+                check ^= byte;
+            }
+        }
+        if (check != mParity)
+        {
+            restart();
+        }
+    }
+}
+
+std::vector<u8> QR::Reader::message(void) const
+{
+    std::vector<u8> ret;
+    for (auto& part : mParts)
+    {
+        ret.insert(ret.end(), part.begin(), part.end());
+    }
+    return ret;
+}
+
+void QR::Reader::restart(void)
+{
+    mParts.clear();
+    mHave.clear();
+    mFound  = 0;
+    mTotal  = 0;
+    mParity = -1;
+}
+
+void QR::Reader::reset(void)
+{
+    restart();
+    mCandidates.clear();
+    mTracking = false;
+}
+
+QR::Scanner::Scanner(int votes)
+    : mReader(votes),
+      mJob(nullptr),
+      mPendingWidth(0),
+      mPendingHeight(0),
+      mHavePending(false),
+      mRunning(false),
+      mResetting(false),
+      mComplete(false),
+      mFound(0),
+      mTotal(0),
+      mDropped(0)
+{
+}
+
+QR::Scanner::~Scanner(void)
+{
+    mLock.lock();
+    mHavePending = false;
+    std::shared_ptr<Threads::Job> job = mJob;
+    mLock.unlock();
+
+    if (job)
+    {
+        job->cancel();
+        job->wait();
+    }
+}
+
+bool QR::Scanner::offer(const Frame& frame)
+{
+    mLock.lock();
+    bool replaced = mHavePending;
+    mPending.assign(frame.pixels, frame.pixels + frame.width * frame.height);
+    mPendingWidth  = frame.width;
+    mPendingHeight = frame.height;
+    mHavePending   = true;
+    if (replaced)
+    {
+        mDropped++;
+    }
+
+    // One job reads frames until none is waiting, then hands the worker back
+    if (!mRunning)
+    {
+        mRunning = true;
+        mJob     = Threads::submit([this](Threads::Job& job) { work(job); });
+        // Only the pool shutting down runs a job before work() could take the lock
+        if (mJob->done())
+        {
+            mRunning = false;
+        }
+    }
+    mLock.unlock();
+
+    return !replaced;
+}
+
+void QR::Scanner::work(Threads::Job& job)
+{
+    while (!job.cancelled())
+    {
+        mLock.lock();
+        if (!mHavePending)
+        {
+            mRunning = false;
+            mLock.unlock();
+            return;
+        }
+        mWorking.swap(mPending);
+        Frame frame = {mWorking.data(), mPendingWidth, mPendingHeight};
+        mHavePending = false;
+        if (mResetting)
+        {
+            mReader.reset();
+            mResetting = false;
+        }
+        mLock.unlock();
+
+        mReader.feed(frame);
+
+        mLock.lock();
+        // A reset asked for while this frame was read applies to it too
+        if (!mResetting)
+        {
+            mComplete = mReader.complete();
+            mFound    = mReader.found();
+            mTotal    = mReader.total();
+            if (mComplete && mMessage.empty())
+            {
+                mMessage = mReader.message();
+            }
+        }
+        mLock.unlock();
+    }
+}
+
+void QR::Scanner::wait(void)
+{
+    mLock.lock();
+    std::shared_ptr<Threads::Job> job = mJob;
+    mLock.unlock();
+
+    if (job)
+    {
+        job->wait();
+    }
+}
+
+bool QR::Scanner::complete(void)
+{
+    mLock.lock();
+    bool ret = mComplete;
+    mLock.unlock();
+    return ret;
+}
+
+int QR::Scanner::found(void)
+{
+    mLock.lock();
+    int ret = mFound;
+    mLock.unlock();
+    return ret;
+}
+
+int QR::Scanner::total(void)
+{
+    mLock.lock();
+    int ret = mTotal;
+    mLock.unlock();
+    return ret;
+}
+
+std::vector<u8> QR::Scanner::message(void)
+{
+    mLock.lock();
+    std::vector<u8> ret = mMessage;
+    mLock.unlock();
+    return ret;
+}
+
+void QR::Scanner::reset(void)
+{
+    mLock.lock();
+    mResetting = true;
+    mComplete  = false;
+    mFound     = 0;
+    mTotal     = 0;
+    mMessage.clear();
+    mLock.unlock();
+}
+
+int QR::Scanner::dropped(void)
+{
+    mLock.lock();
+    int ret = mDropped;
+    mLock.unlock();
+    return ret;
+}
+
+std::vector<u8> QR::payload(const std::vector<u8>& message)
+{
+    std::string text(message.begin(), message.end());
+    size_t start = text.find_last_of('#');
+    start = start == std::string::npos ? 0 : start + 1;
+
+    std::string encoded;
+    for (size_t i = start; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (isspace((unsigned char)c))
+        {
+            continue;
+        }
+        // URL-safe alphabet
+        else if (c == '-')
+        {
+            c = '+';
+        }
+        else if (c == '_')
+        {
+            c = '/';
+        }
+        else if (!isalnum((unsigned char)c) && c != '+' && c != '/' && c != '=')
+        {
+            return {};
+        }
+        encoded += c;
+    }
+
+    if (encoded.empty() || encoded.size() % 4 == 1)
+    {
+        return {};
+    }
+    while (encoded.size() % 4 != 0)
+    {
+        encoded += '=';
+    }
+
+    size_t length;
+    unsigned char* decoded = base64_decode(encoded.data(), encoded.size(), &length);
+    if (decoded == NULL)
+    {
+        return {};
+    }
+    std::vector<u8> ret(decoded, decoded + length);
+    free(decoded);
+    return ret;
+}
+
+std::unique_ptr<WCX> QR::wondercard(const std::vector<u8>& data, u8 generation)
+{
+    u8* raw = (u8*)data.data();
+    switch (generation)
+    {
+        case 4:
+            if (data.size() == PGT::length)
+            {
+                return std::unique_ptr<WCX>(new PGT(raw));
+            }
+            break;
+        case 5:
+            if (data.size() == PGF::length)
+            {
+                return std::unique_ptr<WCX>(new PGF(raw));
+            }
+            break;
+        case 6:
+            if (data.size() == WC6::length || data.size() == FULL_LENGTH)
+            {
+                return std::unique_ptr<WCX>(new WC6(raw, data.size() == FULL_LENGTH));
+            }
+            break;
+        case 7:
+            if (data.size() == WC7::length || data.size() == FULL_LENGTH)
+            {
+                return std::unique_ptr<WCX>(new WC7(raw, data.size() == FULL_LENGTH));
+            }
+            break;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<WCX> QR::scan(FrameSource& source, u8 generation, int votes)
+{
+    Reader reader(votes);
+    Frame frame;
+    while (source.next(frame))
+    {
+        if (reader.feed(frame))
+        {
+            std::unique_ptr<WCX> card = wondercard(payload(reader.message()), generation);
+            if (card)
+            {
+                return card;
+            }
+            // Not a gift for this game, keep looking
+            reader.reset();
+        }
+    }
+    return nullptr;
+}
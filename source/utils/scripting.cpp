@@ -0,0 +1,225 @@
+/*
+*   This file is part of PKSM
+*   Copyright (C) 2016-2018 Bernardo Giordano, Admiral Fish, piepie62
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "scripting.hpp"
+#include "PatchPlan.hpp"
+#include <chrono>
+#include <cstdio>
+extern "C" {
+#include "picoc.h"
+}
+
+#define SCRIPT_STACK_SIZE (128*1024)
+#define SCRIPT_ARENA_SIZE (64*1024)
+
+namespace
+{
+    Sav* running = nullptr;
+    bool decrypted = false;
+    long highWater = 0;
+
+    // picoc leaves through longjmp, so nothing with a destructor may live in this frame
+    int execute(const char* file, int argc, char** argv, bool interpretOnly = false)
+    {
+        Picoc* pc = new Picoc;
+        PicocInitialiseArena(pc, SCRIPT_STACK_SIZE, SCRIPT_ARENA_SIZE);
+#ifndef NO_EXPRESSION_CACHE
+        pc->ExpressionCacheOff = interpretOnly;
+#endif
+        if (PicocPlatformSetExitPoint(pc))
+        {
+            int ret = pc->PicocExitValue;
+            highWater = pc->ArenaHighWater;
+            PicocCleanup(pc);
+            delete pc;
+            return ret;
+        }
+
+        PicocPlatformScanFile(pc, file);
+        PicocCallMain(pc, argc, argv);
+        int ret = pc->PicocExitValue;
+        highWater = pc->ArenaHighWater;
+        PicocCleanup(pc);
+        delete pc;
+        return ret;
+    }
+
+    u64 microseconds(void)
+    {
+#ifdef _3DS
+        return svcGetSystemTick() / (SYSCLOCK_ARM11 / 1000000.0);
+#else
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+}
+
+Sav* Scripting::current(void)
+{
+    return running;
+}
+
+bool Scripting::boxesDecrypted(void)
+{
+    return decrypted;
+}
+
+void Scripting::cryptBoxes(bool decrypt)
+{
+    if (running != nullptr && decrypt != decrypted)
+    {
+        running->cryptBoxData(decrypt);
+        decrypted = decrypt;
+    }
+}
+
+long Scripting::heapHighWater(void)
+{
+    return highWater;
+}
+
+int Scripting::run(Sav& save, const std::string& file, const std::vector<std::string>& args)
+{
+    std::vector<char*> argv;
+    argv.push_back((char*)file.c_str());
+    for (auto& arg : args)
+    {
+        argv.push_back((char*)arg.c_str());
+    }
+
+    std::vector<u8> original(save.data, save.data + save.length);
+    running = &save;
+    cryptBoxes(true);
+    int ret = execute(file.c_str(), argv.size(), argv.data());
+    if (ret != 0)
+    {
+        std::copy(original.begin(), original.end(), save.data);
+        decrypted = false;
+    }
+    cryptBoxes(false);
+    running = nullptr;
+    return ret;
+}
+
+Scripting::Timing Scripting::benchmark(Sav& save, const std::string& file, const std::vector<std::string>& args)
+{
+    std::vector<char*> argv;
+    argv.push_back((char*)file.c_str());
+    for (auto& arg : args)
+    {
+        argv.push_back((char*)arg.c_str());
+    }
+
+    Timing timing;
+    std::vector<u8> original(save.data, save.data + save.length);
+    running = &save;
+    for (int interpretOnly = 1; interpretOnly >= 0; interpretOnly--)
+    {
+        cryptBoxes(true);
+        u64 start = microseconds();
+        int ret = execute(file.c_str(), argv.size(), argv.data(), interpretOnly);
+        u64 time = microseconds() - start;
+        std::copy(original.begin(), original.end(), save.data);
+        decrypted = false;
+        if (interpretOnly)
+        {
+            timing.interpretedRet = ret;
+            timing.interpreted = time;
+        }
+        else
+        {
+            timing.compiledRet = ret;
+            timing.compiled = time;
+        }
+    }
+    running = nullptr;
+    return timing;
+}
+
+int Scripting::process(const std::string& saveFile, const std::string& file, const std::vector<std::string>& args)
+{
+    FILE* in = fopen(saveFile.c_str(), "rb");
+    if (in == NULL)
+    {
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    size_t size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    std::vector<u8> data(size);
+    size_t read = fread(data.data(), 1, size, in);
+    fclose(in);
+
+    std::unique_ptr<Sav> save = read == size ? Sav::getSave(data.data(), size) : nullptr;
+    if (!save)
+    {
+        return 1;
+    }
+
+    if (file.size() > 2 && file.substr(file.size() - 2) == ".c")
+    {
+        int ret = run(*save, file, args);
+        // run() already undid a failed script's edits, don't touch the file at all
+        if (ret != 0)
+        {
+            return ret;
+        }
+        // a slot the script wrote without refreshing its checksum would be a bad egg in game
+        save->verifyBoxes(true);
+        save->resign();
+    }
+    else
+    {
+        FILE* script = fopen(file.c_str(), "rb");
+        if (script == NULL)
+        {
+            return 1;
+        }
+        fseek(script, 0, SEEK_END);
+        std::vector<u8> records(ftell(script));
+        fseek(script, 0, SEEK_SET);
+        read = fread(records.data(), 1, records.size(), script);
+        fclose(script);
+
+        PatchPlan plan(records.data(), records.size(), *save);
+        if (read != records.size() || plan.status() != PatchPlan::OK)
+        {
+            return 1;
+        }
+        // a PKSMSCRIPT writes raw bytes, so only the checksum blocks its writes land in change
+        plan.apply(*save);
+        save->resign(plan.dirtyBlocks());
+    }
+
+    FILE* out = fopen(saveFile.c_str(), "r+b");
+    if (out == NULL)
+    {
+        return 1;
+    }
+    size_t written = fwrite(save->data, 1, save->length, out);
+    fclose(out);
+    return written == save->length ? 0 : 1;
+}
@@ -25,22 +25,384 @@
 */
 
 #include "thread.hpp"
+#include <deque>
 
-static std::vector<Thread> threads;
+namespace
+{
+    constexpr u32 WORKER_STACK = 0x8000;
+    // what init() starts by default
+    constexpr size_t DEFAULT_WORKERS = 2;
+
+#ifdef _3DS
+    typedef Thread NativeThread;
+
+    class Semaphore
+    {
+    public:
+        Semaphore(void) { LightSemaphore_Init(&mSemaphore, 0, 0x7FFF); }
+        void post(s32 count = 1) { LightSemaphore_Release(&mSemaphore, count); }
+        void wait(void) { LightSemaphore_Acquire(&mSemaphore, 1); }
+    private:
+        LightSemaphore mSemaphore;
+    };
+
+    bool spawn(NativeThread* thread, void (*entrypoint)(void*), void* arg, u32 stackSize, bool detached)
+    {
+        // lower value means higher priority: keep workers below the UI thread
+        s32 prio = 0;
+        svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+        *thread = threadCreate(entrypoint, arg, stackSize, prio + 1, -2, detached);
+        return *thread != NULL;
+    }
+
+    void join(NativeThread thread)
+    {
+        threadJoin(thread, U64_MAX);
+        threadFree(thread);
+    }
+#else
+    typedef pthread_t NativeThread;
+
+    class Semaphore
+    {
+    public:
+        Semaphore(void) : mCount(0) { pthread_mutex_init(&mMutex, NULL); pthread_cond_init(&mCond, NULL); }
+        ~Semaphore(void) { pthread_cond_destroy(&mCond); pthread_mutex_destroy(&mMutex); }
+        void post(s32 count = 1)
+        {
+            pthread_mutex_lock(&mMutex);
+            mCount += count;
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mMutex);
+        }
+        void wait(void)
+        {
+            pthread_mutex_lock(&mMutex);
+            while (mCount == 0)
+            {
+                pthread_cond_wait(&mCond, &mMutex);
+            }
+            mCount--;
+            pthread_mutex_unlock(&mMutex);
+        }
+    private:
+        pthread_mutex_t mMutex;
+        pthread_cond_t mCond;
+        s32 mCount;
+    };
+
+    struct Trampoline
+    {
+        void (*entrypoint)(void*);
+        void* arg;
+    };
+
+    void* trampoline(void* arg)
+    {
+        Trampoline t = *(Trampoline*)arg;
+        delete (Trampoline*)arg;
+        t.entrypoint(t.arg);
+        return NULL;
+    }
+
+    bool spawn(NativeThread* thread, void (*entrypoint)(void*), void* arg, u32 stackSize, bool detached)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, stackSize < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : stackSize);
+        pthread_attr_setdetachstate(&attr, detached ? PTHREAD_CREATE_DETACHED : PTHREAD_CREATE_JOINABLE);
+        Trampoline* t = new Trampoline{entrypoint, arg};
+        bool ok = pthread_create(thread, &attr, &trampoline, t) == 0;
+        if (!ok)
+        {
+            delete t;
+        }
+        pthread_attr_destroy(&attr);
+        return ok;
+    }
+
+    void join(NativeThread thread)
+    {
+        pthread_join(thread, NULL);
+    }
+#endif
+}
+
+namespace Threads
+{
+    class Scheduler
+    {
+    public:
+        static std::shared_ptr<Job> make(std::function<void(Job&)>& work, std::function<void(Job&)>& callback)
+        {
+            return std::shared_ptr<Job>(new Job(work, callback));
+        }
+        static void run(Job& job) { job.run(); }
+    };
+}
+
+static Threads::Mutex lock;
+static Semaphore pending;
+static std::deque<std::shared_ptr<Threads::Job>> queues[3];
+static std::vector<NativeThread> workers;
+static std::vector<std::shared_ptr<Threads::Job>> dedicated;
+static bool stopping = false;
+
+// highest priority first, FIFO within a priority
+static std::shared_ptr<Threads::Job> pop(void)
+{
+    std::shared_ptr<Threads::Job> job = nullptr;
+    lock.lock();
+    for (int i = 2; i >= 0; i--)
+    {
+        if (!queues[i].empty())
+        {
+            job = queues[i].front();
+            queues[i].pop_front();
+            break;
+        }
+    }
+    lock.unlock();
+    return job;
+}
+
+static void worker(void*)
+{
+    while (true)
+    {
+        pending.wait();
+        std::shared_ptr<Threads::Job> job = pop();
+        if (!job)
+        {
+            // one token per worker is posted by destroy() once the queues are empty
+            return;
+        }
+        Threads::Scheduler::run(*job);
+    }
+}
+
+static void dedicatedEntry(void* arg)
+{
+    // the thread owns a reference so the job outlives it no matter who else lets go
+    std::shared_ptr<Threads::Job>* job = (std::shared_ptr<Threads::Job>*)arg;
+    Threads::Scheduler::run(**job);
+    delete job;
+}
+
+Threads::Mutex::Mutex(void)
+{
+#ifdef _3DS
+    LightLock_Init(&mLock);
+#else
+    pthread_mutex_init(&mMutex, NULL);
+#endif
+}
+
+Threads::Mutex::~Mutex(void)
+{
+#ifndef _3DS
+    pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+void Threads::Mutex::lock(void)
+{
+#ifdef _3DS
+    LightLock_Lock(&mLock);
+#else
+    pthread_mutex_lock(&mMutex);
+#endif
+}
+
+void Threads::Mutex::unlock(void)
+{
+#ifdef _3DS
+    LightLock_Unlock(&mLock);
+#else
+    pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+Threads::Event::Event(void)
+{
+#ifdef _3DS
+    LightEvent_Init(&mEvent, RESET_STICKY);
+#else
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+    mSet = false;
+#endif
+}
+
+Threads::Event::~Event(void)
+{
+#ifndef _3DS
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+void Threads::Event::set(void)
+{
+#ifdef _3DS
+    LightEvent_Signal(&mEvent);
+#else
+    pthread_mutex_lock(&mMutex);
+    mSet = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+void Threads::Event::wait(void)
+{
+#ifdef _3DS
+    LightEvent_Wait(&mEvent);
+#else
+    pthread_mutex_lock(&mMutex);
+    while (!mSet)
+    {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+bool Threads::Event::isSet(void)
+{
+#ifdef _3DS
+    return LightEvent_TryWait(&mEvent);
+#else
+    pthread_mutex_lock(&mMutex);
+    bool ret = mSet;
+    pthread_mutex_unlock(&mMutex);
+    return ret;
+#endif
+}
+
+Threads::Job::Job(std::function<void(Job&)> work, std::function<void(Job&)> callback)
+    : mWork(work), mCallback(callback), mCancelled(false)
+{
+}
+
+void Threads::Job::run(void)
+{
+    if (!mCancelled)
+    {
+        mWork(*this);
+    }
+    if (mCallback)
+    {
+        mCallback(*this);
+    }
+    // release captured state before waking anyone up
+    mWork = nullptr;
+    mCallback = nullptr;
+    mFinished.set();
+}
+
+// lock must be held
+static void startWorkers(size_t count)
+{
+    stopping = false;
+    while (workers.size() < count)
+    {
+        NativeThread thread;
+        if (!spawn(&thread, &worker, NULL, WORKER_STACK, false))
+        {
+            break;
+        }
+        workers.push_back(thread);
+    }
+}
+
+void Threads::init(size_t count)
+{
+    lock.lock();
+    startWorkers(count);
+    lock.unlock();
+}
+
+std::shared_ptr<Threads::Job> Threads::submit(std::function<void(Job&)> work, Priority priority, u32 stackSize, std::function<void(Job&)> callback)
+{
+    std::shared_ptr<Job> job = Scheduler::make(work, callback);
+
+    lock.lock();
+    // destroy() empties workers before it's done stopping, so a stopping pool isn't restarted
+    if (workers.empty() && !stopping)
+    {
+        startWorkers(DEFAULT_WORKERS);
+    }
+
+    bool refused = stopping;
+    if (!refused && stackSize > WORKER_STACK)
+    {
+        // forget the ones that already finished
+        for (size_t i = dedicated.size(); i > 0; i--)
+        {
+            if (dedicated[i - 1]->done())
+            {
+                dedicated.erase(dedicated.begin() + i - 1);
+            }
+        }
+        NativeThread thread;
+        std::shared_ptr<Job>* ref = new std::shared_ptr<Job>(job);
+        if (spawn(&thread, &dedicatedEntry, ref, stackSize, true))
+        {
+            dedicated.push_back(job);
+            lock.unlock();
+            return job;
+        }
+        delete ref;
+        // a worker's stack is too small for it
+        refused = true;
+    }
+    // nothing would ever take it off the queue
+    refused = refused || workers.empty();
+
+    if (refused)
+    {
+        lock.unlock();
+        job->cancel();
+        Scheduler::run(*job);
+        return job;
+    }
+
+    queues[(int)priority].push_back(job);
+    lock.unlock();
+    pending.post();
+    return job;
+}
 
 void Threads::create(ThreadFunc entrypoint)
 {
-    s32 prio = 0;
-    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-    Thread thread = threadCreate((ThreadFunc)entrypoint, NULL, 4*1024, prio-1, -2, false);
-    threads.push_back(thread);
+    submit([entrypoint](Job&) { entrypoint(NULL); });
 }
 
 void Threads::destroy(void)
 {
-    for (u32 i = 0; i < threads.size(); i++)
+    // take the threads out under the lock so submit() never sees them half gone
+    std::vector<NativeThread> stopped;
+    std::vector<std::shared_ptr<Job>> running;
+    lock.lock();
+    stopping = true;
+    stopped.swap(workers);
+    running.swap(dedicated);
+    lock.unlock();
+
+    pending.post(stopped.size());
+    for (size_t i = 0; i < stopped.size(); i++)
     {
-        threadJoin(threads.at(i), U64_MAX);
-        threadFree(threads.at(i));
+        join(stopped[i]);
     }
-}
+
+    for (size_t i = 0; i < running.size(); i++)
+    {
+        running[i]->wait();
+    }
+
+    // later submits start a new pool, as they did before
+    lock.lock();
+    stopping = false;
+    lock.unlock();
+}
\ No newline at end of file